@@ -0,0 +1,472 @@
+/************************************************************************************************************
+Mech 7171 Engineering Programing, Fall 2021
+Capstone Project - 2D Conductive Heat Transfer on a Uniform Flat Plate
+
+Purpose: Benchmark of the plate solver.  Times initialize, SetBoundaryConditions, the solver loop (per
+		 iteration and to convergence), the three analytical solutions and printSolution on the cases of
+		 simulations.in and on square synthetic plates, and writes the results as JSON.  It compiles the
+		 solver source itself with HTS_LIBRARY defined, so it measures exactly the code the program runs:
+
+			 cl /O2 /std:c++17 /EHsc HeatTransferBenchmark.cpp
+			 HeatTransferBenchmark [-solver GS|SOR|MG|PCG|DST|CHOLESKY|LINE|ADI] [-set KEY value]... [-sizes 65,129,...]
+								   [-iters n] [-min seconds] [-converge] [-nofile] [-o results.json]
+
+		 The JSON goes to HeatTransferBenchmark.json unless -o names another file (the solver itself
+		 prints to the console, so stdout is no place for it); progress goes to stderr.  The output phase
+		 writes its solution files into a private directory under the system temporary directory, with
+		 the console lines of printSolution held back, and deletes them and the directory again, so the
+		 files of real runs in the current directory are never touched.
+		 Every result has the best and mean time of its repeats, ns per node, MLUPS (million node updates
+		 per second) and GB/s.  GB/s is the modelled minimum memory traffic of the phase (see phaseBytes),
+		 not a hardware counter, so it compares runs rather than measuring the bus.
+
+Author(s):     Muneer Almasyabi, Nathan Binner, Alex Sung
+Student ID(s): A01061394, A01159743, A01163512
+************************************************************************************************************/
+
+#define HTS_LIBRARY  // the solver without its main()
+#include "HeatTransferSim.cpp"
+
+//------- BENCHMARK CONSTANTS -------------------------------------------------------------------------------
+const int DEFAULT_SIZES[] = { 65, 129, 257, 513, 1025 }; // nodes per side of the synthetic plates
+const int MAX_SIZES = 16;                 // most synthetic plates
+const int DEFAULT_BENCH_ITERS = 20;       // iterations of the per-iteration solve
+const double DEFAULT_MIN_SECONDS = 0.2;   // repeat a phase until it has run this long
+const int MAX_REPEATS = 1000;             // ... or this many times
+const char* BENCH_JSON_FILE = "HeatTransferBenchmark.json"; // default results file
+const char* BENCH_USAGE = "usage: HeatTransferBenchmark [-solver GS|SOR|MG|PCG|DST|CHOLESKY|LINE|ADI] [-set KEY value]... [-sizes n,n,...] "
+	"[-iters n] [-min seconds] [-converge] [-nofile] [-o results.json]";
+
+const int PHASE_INITIALIZE = 0;      // initialize: allocate and zero the three planes
+const int PHASE_BOUNDARY = 1;        // SetBoundaryConditions
+const int PHASE_ITERATION = 2;       // SolvePlate limited to -iters iterations, reported per iteration
+const int PHASE_CONVERGENCE = 3;     // SolvePlate to MAX_RESIDUAL
+const int PHASE_ANALYTICAL_A = 4;    // GetCaseAAnalyticalSolution
+const int PHASE_ANALYTICAL_B = 5;    // GetCaseBAnalyticalSolution
+const int PHASE_ANALYTICAL_C = 6;    // GetCaseCAnalyticalSolution
+const int PHASE_OUTPUT = 7;          // printSolution
+const int NUM_PHASES = 8;
+const char* PHASE_NAMES[] = { "initialize", "boundary_conditions", "solve_iteration", "solve_convergence",
+	"analytical_A", "analytical_B", "analytical_C", "print_solution" };
+
+//------- BENCHMARK STRUCTURES ------------------------------------------------------------------------------
+typedef struct BENCH_OPTIONS  // command line of the benchmark
+{
+	SOLVER_DATA solver;        // settings applied on top of every case (-solver, -set)
+	bool bOverride;            // -solver or -set was given, so the file cases use solver too
+	int sizes[MAX_SIZES];      // synthetic plates
+	int nSizes;                // number of synthetic plates
+	int nIters;                // iterations of the per-iteration solve
+	double minSeconds;         // minimum time per phase
+	bool bConvergeSynthetic;   // also solve the synthetic plates to convergence
+	bool bFileCases;           // include the simulations.in cases
+	FILE* fJson;               // where the JSON goes
+	bool bFirstResult;         // no result written yet (for the commas)
+	char strOutputDir[MAX_BUFF_SIZE]; // private directory the output phase writes in, "" = none
+}
+BENCH_OPTIONS;
+
+typedef struct BENCH_TIMING  // one phase on one grid
+{
+	double best, total;        // fastest repeat and sum of all repeats in seconds
+	int nRepeats;              // repeats done
+	int iter;                  // solver iterations of one repeat (solve phases)
+	double bytes;              // bytes written by printSolution (output phase)
+}
+BENCH_TIMING;
+
+//------- BENCHMARK PROTOTYPES ------------------------------------------------------------------------------
+bool parseBenchOptions(int, char**, BENCH_OPTIONS*);             // reads the command line
+void makeSyntheticPlate(int, SIMULATION_DATA*);                   // square plate with a sine on top
+void benchGrid(SIMULATION_DATA*, BENCH_OPTIONS*, bool);           // all phases on one grid
+bool timePhase(SIMULATION_DATA*, int, const BENCH_OPTIONS*, BENCH_TIMING*); // repeats one phase
+double phaseBytes(const SIMULATION_DATA*, const PLATEGRID*, int, const BENCH_TIMING*); // modelled traffic
+void writeResult(BENCH_OPTIONS*, const SIMULATION_DATA*, const PLATEGRID*, int, const BENCH_TIMING*); // one JSON object
+void removeSolutionFiles(const SIMULATION_DATA*);                 // deletes what printSolution wrote
+bool createOutputDirectory(BENCH_OPTIONS*);                       // private directory of the output phase
+
+
+//-----------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	BENCH_OPTIONS opt = {};          // command line
+	SIMULATION_DATA* SD = NULL;      // the simulations.in cases
+	SIMULATION_DATA S;               // a synthetic plate
+	int NS = 0, n;                   // number of cases, counter
+	std::error_code ec;              // filesystem errors
+
+	if (!parseBenchOptions(argc, argv, &opt))
+	{
+		fprintf(stderr, "%s\n", BENCH_USAGE);
+		return EXIT_USAGE;
+	}
+	if (opt.bFileCases)
+	{
+		SD = GetSimulationData(SD, &NS);
+		if (SD != NULL) GetSolverSettings(SD, NS);
+	}
+
+	if (!createOutputDirectory(&opt)) fprintf(stderr, "Cannot create a temporary directory, %s is skipped\n",
+		PHASE_NAMES[PHASE_OUTPUT]);
+	fprintf(opt.fJson, "{\n  \"benchmark\": \"HeatTransferSim\",\n  \"kernels\": \"%s\",\n  \"hardware_threads\": %u,\n",
+		GetStencilKernels(opt.solver.nSimd)->strName, std::thread::hardware_concurrency());
+	fprintf(opt.fJson, "  \"iterations_per_sample\": %d,\n  \"results\": [", opt.nIters);
+	opt.bFirstResult = true;
+	for (n = 0; n < NS; n++) benchGrid(&SD[n], &opt, true);
+	for (n = 0; n < opt.nSizes; n++)
+	{
+		makeSyntheticPlate(opt.sizes[n], &S);
+		S.solver = opt.solver;
+		benchGrid(&S, &opt, opt.bConvergeSynthetic);
+	}
+	fprintf(opt.fJson, "\n  ]\n}\n");
+
+	fclose(opt.fJson);
+	if (opt.strOutputDir[0] != '\0') std::filesystem::remove(opt.strOutputDir, ec); // empty, every repeat deleted its files
+	FreeMemory(NULL, SD);
+	hts_release_caches();
+	return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Reads the command line.  -solver and -set change the solver settings of every grid (the
+//               simulations.in cases otherwise keep their own), -sizes replaces the synthetic plates
+//               (0 for none), -nofile leaves out the simulations.in cases
+// ARGUMENTS:    argc, argv: the command line
+//               opt:        returns the options
+// RETURN VALUE: false for bad arguments
+bool parseBenchOptions(int argc, char* argv[], BENCH_OPTIONS* opt)
+{
+	char* pGarbage, * tok, * nextToken = NULL; // end of a number, size list tokens
+	errno_t err;
+	int n;                                      // counter
+
+	opt->nSizes = (int)(sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]));
+	for (n = 0; n < opt->nSizes; n++) opt->sizes[n] = DEFAULT_SIZES[n];
+	opt->nIters = DEFAULT_BENCH_ITERS;
+	opt->minSeconds = DEFAULT_MIN_SECONDS;
+	opt->bFileCases = true;
+	for (n = 1; n < argc; n++)
+	{
+		if (strcmp(argv[n], "-converge") == 0) opt->bConvergeSynthetic = true;
+		else if (strcmp(argv[n], "-nofile") == 0) opt->bFileCases = false;
+		else if (n + 1 >= argc) return false; // the rest take a value
+		else if (strcmp(argv[n], "-solver") == 0)
+		{
+			if (!setSolverOption(&opt->solver, "SOLVER", argv[++n])) return false;
+			opt->bOverride = true;
+		}
+		else if (strcmp(argv[n], "-set") == 0)
+		{
+			if (n + 2 >= argc || !setSolverOption(&opt->solver, argv[n + 1], argv[n + 2])) return false;
+			opt->bOverride = true;
+			n += 2;
+		}
+		else if (strcmp(argv[n], "-iters") == 0)
+		{
+			opt->nIters = (int)strtol(argv[++n], &pGarbage, 10);
+			if (opt->nIters < 1 || *pGarbage != '\0') return false;
+		}
+		else if (strcmp(argv[n], "-min") == 0)
+		{
+			opt->minSeconds = strtod(argv[++n], &pGarbage);
+			if (opt->minSeconds < 0.0 || *pGarbage != '\0') return false;
+		}
+		else if (strcmp(argv[n], "-sizes") == 0)
+		{
+			opt->nSizes = 0;
+			for (tok = strtok_s(argv[++n], ",", &nextToken); tok != NULL; tok = strtok_s(NULL, ",", &nextToken))
+			{
+				int size = (int)strtol(tok, &pGarbage, 10);
+				if (*pGarbage != '\0' || size < 0 || opt->nSizes >= MAX_SIZES) return false;
+				if (size >= 3) opt->sizes[opt->nSizes++] = size;
+			}
+		}
+		else if (strcmp(argv[n], "-o") == 0)
+		{
+			if (opt->fJson != NULL) fclose(opt->fJson);
+			err = fopen_s(&opt->fJson, argv[++n], "w");
+			if (err != 0 || opt->fJson == NULL)
+			{
+				fprintf(stderr, "Cannot open \"%s\" for writing\n", argv[n]);
+				return false;
+			}
+		}
+		else return false;
+	}
+	if (opt->fJson == NULL && (fopen_s(&opt->fJson, BENCH_JSON_FILE, "w") != 0 || opt->fJson == NULL))
+	{
+		fprintf(stderr, "Cannot open \"%s\" for writing\n", BENCH_JSON_FILE);
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  A unit square plate with n x n nodes, one sine period on the top wall and the other walls
+//               at T0, so every analytical solution has something to evaluate
+// ARGUMENTS:    n: nodes per side
+//               S: returns the plate
+// RETURN VALUE: none
+void makeSyntheticPlate(int n, SIMULATION_DATA* S)
+{
+	int m; // wall counter
+
+	memset(S, 0, sizeof(SIMULATION_DATA));
+	sprintf_s(S->strCase, MAX_CASE_NAME_SIZE, "bench-%dx%d", n, n);
+	S->w = S->h = 1.0;
+	S->dx = S->dy = 1.0 / (n - 1);
+	S->iCoarser = -1;
+	for (m = 0; m < NUM_WALLS; m++)
+	{
+		S->bc[m].nType = BC_TYPE_CONST;
+		S->bc[m].Ta = T0;
+		S->bc[m].zb = 1.0;
+	}
+	S->bc[TOP].nType = BC_TYPE_SINE;
+	S->bc[TOP].Ta = 300.0;
+	S->bc[TOP].k = 1.0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Times every phase on one grid and writes a JSON result for each
+// ARGUMENTS:    S:         the grid (a simulations.in case or a synthetic plate)
+//               opt:       the options
+//               bConverge: also time the solve to convergence
+// RETURN VALUE: none
+void benchGrid(SIMULATION_DATA* S, BENCH_OPTIONS* opt, bool bConverge)
+{
+	BENCH_TIMING t;        // timing of a phase
+	PLATEGRID* G;          // a grid of the case, for the sizes in the results
+	int nPhase;            // phase counter
+	bool bOk;              // the phase ran
+	std::filesystem::path cwd; // working directory, restored after the output phase
+	std::error_code ec;    // filesystem errors
+
+	if (opt->bOverride) S->solver = opt->solver;
+	G = initialize(0, S, NULL);
+	if (G == NULL)
+	{
+		fprintf(stderr, "Cannot allocate \"%s\", skipped\n", S->strCase);
+		return;
+	}
+	fprintf(stderr, "%s: %zu x %zu nodes\n", S->strCase, G->I, G->J);
+	for (nPhase = 0; nPhase < NUM_PHASES; nPhase++)
+	{
+		if (nPhase == PHASE_CONVERGENCE && !bConverge) continue;
+		if (nPhase == PHASE_OUTPUT) // printSolution writes to the working directory, make it the private one
+		{
+			if (opt->strOutputDir[0] == '\0') continue;
+			cwd = std::filesystem::current_path(ec);
+			if (!ec) std::filesystem::current_path(opt->strOutputDir, ec);
+			if (ec)
+			{
+				fprintf(stderr, "  %s skipped, cannot enter \"%s\"\n", PHASE_NAMES[nPhase], opt->strOutputDir);
+				continue;
+			}
+		}
+		bOk = timePhase(S, nPhase, opt, &t);
+		if (nPhase == PHASE_OUTPUT) std::filesystem::current_path(cwd, ec);
+		if (!bOk)
+		{
+			fprintf(stderr, "  %s failed\n", PHASE_NAMES[nPhase]);
+			continue;
+		}
+		fprintf(stderr, "  %-20s %12.6lf s\n", PHASE_NAMES[nPhase], t.best);
+		writeResult(opt, S, G, nPhase, &t);
+	}
+	FreeMemory(G, NULL);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Repeats one phase until it has run opt->minSeconds (at least once, at most MAX_REPEATS
+//               times; the solve to convergence runs once).  Every repeat starts from the state the
+//               program would have at that point, e.g. a solve starts from the zeroed grid with its
+//               boundary conditions, and only the phase itself is inside the timed region
+// ARGUMENTS:    S:      the grid
+//               nPhase: the phase
+//               opt:    the options
+//               t:      returns the timing
+// RETURN VALUE: false if out of memory or the output could not be written
+bool timePhase(SIMULATION_DATA* S, int nPhase, const BENCH_OPTIONS* opt, BENCH_TIMING* t)
+{
+	std::string quiet;          // console lines of printSolution, held back so the output time has no console I/O
+	SIMULATION_DATA run = *S;   // the case with the iteration limit of the phase
+	PLATEGRID* G = NULL;        // the grid of a repeat
+	SOLVE_INFO info;            // convergence of a solve
+	std::chrono::steady_clock::time_point start; // start of the timed region
+	double seconds;             // time of a repeat
+	bool bOk = true;            // the phase ran
+
+	memset(t, 0, sizeof(BENCH_TIMING));
+	run.solver.bCache = false; // always solve, never load
+	run.solver.nWarmStart = WARM_START_NONE;
+	if (nPhase == PHASE_ITERATION) run.solver.nMaxIter = opt->nIters - 1; // the loop runs nMaxIter + 1 times
+	do
+	{
+		if (nPhase != PHASE_INITIALIZE) // untimed set-up of a fresh grid
+		{
+			G = initialize(0, &run, NULL);
+			if (G == NULL) return false;
+			if (nPhase != PHASE_BOUNDARY) G = SetBoundaryConditions(G, &run, 0);
+			if (nPhase == PHASE_OUTPUT) // a solved field, so the files have their real content
+			{
+				info = {};
+				run.solver.nMaxIter = opt->nIters - 1;
+				SolvePlate(G, &run, NULL, NULL, &info);
+				GetAnalyticalSolution(G, &run);
+			}
+		}
+		info = {};
+		start = std::chrono::steady_clock::now();
+		if (nPhase == PHASE_INITIALIZE) G = initialize(0, &run, NULL);
+		else if (nPhase == PHASE_BOUNDARY) G = SetBoundaryConditions(G, &run, 0);
+		else if (nPhase == PHASE_ITERATION || nPhase == PHASE_CONVERGENCE)
+			bOk = SolvePlate(G, &run, NULL, NULL, &info) != HTS_ERROR_MEMORY;
+		else if (nPhase == PHASE_ANALYTICAL_A) GetCaseAAnalyticalSolution(G, &run);
+		else if (nPhase == PHASE_ANALYTICAL_B) GetCaseBAnalyticalSolution(G, &run);
+		else if (nPhase == PHASE_ANALYTICAL_C) GetCaseCAnalyticalSolution(G, &run);
+		else if (nPhase == PHASE_OUTPUT)
+		{
+			quiet.clear();
+			pCaseReport = &quiet; // reportf appends to it instead of printing
+			bOk = printSolution(G, &run);
+			pCaseReport = NULL;
+		}
+		seconds = secondsSince(start);
+		if (G == NULL) return false;
+
+		if (nPhase == PHASE_OUTPUT) // count the bytes written, then clean up (benchGrid made the private directory current)
+		{
+			char strFile[MAX_BUFF_SIZE];   // an output file
+			const char* suffixes[] = { "Analytical.dat", "Finite Difference.dat", "Residual.dat", "Solution.hts" };
+			std::error_code ec;
+			for (const char* suffix : suffixes)
+			{
+				sprintf_s(strFile, MAX_BUFF_SIZE, "%s %s", run.strCase, suffix);
+				uintmax_t size = std::filesystem::file_size(strFile, ec);
+				if (!ec && bOk && t->nRepeats == 0) t->bytes += (double)size;
+			}
+			removeSolutionFiles(&run);
+		}
+		FreeMemory(G, NULL);
+		G = NULL;
+		if (!bOk) return false;
+
+		if (t->nRepeats == 0 || seconds < t->best) t->best = seconds;
+		t->total += seconds;
+		t->iter = info.iter;
+		t->nRepeats++;
+	} while (nPhase != PHASE_CONVERGENCE && t->total < opt->minSeconds && t->nRepeats < MAX_REPEATS);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Modelled minimum memory traffic of one repeat of a phase, for GB/s.  A grid sweep reads and
+//               writes T_fd once (16 bytes per node, the neighbours come from cache) and a separate
+//               residual pass reads T_fd and writes res (16 more); multigrid and PCG are charged the same
+//               per iteration, so their GB/s is a lower bound.  PRECISION MIXED sweeps a float32 plane (8
+//               bytes per node, more during the corrections).  initialize zeroes three planes, the
+//               boundary conditions write the edge nodes, an analytical solution writes T_a, and the
+//               output is the size of the files written
+// ARGUMENTS:    S:      the grid
+//               G:      a grid of the case (for I, J and stride)
+//               nPhase: the phase
+//               t:      its timing
+// RETURN VALUE: bytes of one repeat
+double phaseBytes(const SIMULATION_DATA* S, const PLATEGRID* G, int nPhase, const BENCH_TIMING* t)
+{
+	double nodes = (double)G->I * (double)G->J; // nodes of the grid
+	bool bSweeps = S->solver.nSolver == SOLVER_GS || S->solver.nSolver == SOLVER_SOR; // GS or SOR
+	bool bFused = S->solver.bFused && bSweeps;
+
+	if (nPhase == PHASE_INITIALIZE) return 3.0 * (double)G->stride * (double)G->J * sizeof(double);
+	if (nPhase == PHASE_BOUNDARY) return 2.0 * ((double)G->I + (double)G->J) * sizeof(double);
+	if ((nPhase == PHASE_ITERATION || nPhase == PHASE_CONVERGENCE) && S->solver.bMixed && bSweeps) return 8.0 * nodes * t->iter;
+	if (nPhase == PHASE_ITERATION || nPhase == PHASE_CONVERGENCE) return (bFused ? 16.0 : 32.0) * nodes * t->iter;
+	if (nPhase == PHASE_OUTPUT) return t->bytes;
+	return nodes * sizeof(double); // analytical solutions
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Writes one result object.  ns_per_node and mlups count node updates: nodes times
+//               iterations for the solve phases, nodes otherwise; the solve per iteration is reported
+//               per iteration
+// ARGUMENTS:    opt:    the options (JSON file and comma state)
+//               S:      the grid
+//               G:      a grid of the case
+//               nPhase: the phase
+//               t:      its timing
+// RETURN VALUE: none
+void writeResult(BENCH_OPTIONS* opt, const SIMULATION_DATA* S, const PLATEGRID* G, int nPhase, const BENCH_TIMING* t)
+{
+	double nodes = (double)G->I * (double)G->J; // nodes of the grid
+	double updates = nodes;                      // node updates of one repeat
+	double scale = 1.0;                          // repeats are reported per iteration for PHASE_ITERATION
+	double best, mean;                           // reported times
+
+	if ((nPhase == PHASE_ITERATION || nPhase == PHASE_CONVERGENCE) && t->iter > 0) updates = nodes * t->iter;
+	if (nPhase == PHASE_ITERATION && t->iter > 0) scale = 1.0 / t->iter;
+	best = t->best * scale;
+	mean = t->total / t->nRepeats * scale;
+
+	fprintf(opt->fJson, "%s\n    { \"grid\": \"%s\", \"I\": %zu, \"J\": %zu, \"nodes\": %.0lf, \"phase\": \"%s\", ",
+		opt->bFirstResult ? "" : ",", S->strCase, G->I, G->J, nodes, PHASE_NAMES[nPhase]);
+	fprintf(opt->fJson, "\"solver\": \"%s\", \"precision\": \"%s\", \"threads\": %d, \"repeats\": %d, \"iterations\": %d, ",
+		SOLVER_NAMES[S->solver.nSolver],
+		S->solver.bMixed ? "mixed" : "double", S->solver.nThreads > 1 ? S->solver.nThreads : 1, t->nRepeats, t->iter);
+	fprintf(opt->fJson, "\"best_s\": %.9le, \"mean_s\": %.9le, \"ns_per_node\": %.6lf, \"mlups\": %.3lf, \"gbps\": %.3lf }",
+		best, mean, t->best * 1e9 / updates, t->best > 0.0 ? updates / t->best * 1e-6 : 0.0,
+		t->best > 0.0 ? phaseBytes(S, G, nPhase, t) / t->best * 1e-9 : 0.0);
+	opt->bFirstResult = false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Deletes the files printSolution wrote for a grid (from the working directory, which is the
+//               private output directory while the output phase runs)
+// ARGUMENTS:    S: the grid
+// RETURN VALUE: none
+void removeSolutionFiles(const SIMULATION_DATA* S)
+{
+	const char* suffixes[] = { "Analytical.dat", "Finite Difference.dat", "Residual.dat", "Solution.hts" };
+	char strFile[MAX_BUFF_SIZE]; // an output file
+
+	for (const char* suffix : suffixes)
+	{
+		sprintf_s(strFile, MAX_BUFF_SIZE, "%s %s", S->strCase, suffix);
+		remove(strFile);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Creates a new, empty directory under the system temporary directory for the files of the
+//               output phase.  The name carries the clock, and a directory that already exists is never
+//               used, so nothing the benchmark deletes can belong to another run
+// ARGUMENTS:    opt: returns the directory in strOutputDir (left "" on failure)
+// RETURN VALUE: false if no directory could be created
+bool createOutputDirectory(BENCH_OPTIONS* opt)
+{
+	std::error_code ec;              // filesystem errors
+	std::filesystem::path dir;       // a candidate
+	std::filesystem::path temp = std::filesystem::temp_directory_path(ec); // where it goes
+	char strName[MAX_BUFF_SIZE];     // its name
+	int n;                           // attempt counter
+
+	opt->strOutputDir[0] = '\0';
+	if (ec) return false;
+	for (n = 0; n < 16; n++)
+	{
+		sprintf_s(strName, MAX_BUFF_SIZE, "HeatTransferBenchmark-%llx-%d",
+			(unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count(), n);
+		dir = temp / strName;
+		if (!std::filesystem::create_directory(dir, ec) || ec) continue; // exists already, or cannot be made
+		if (dir.string().size() >= MAX_BUFF_SIZE)
+		{
+			std::filesystem::remove(dir, ec);
+			return false;
+		}
+		strcpy_s(opt->strOutputDir, MAX_BUFF_SIZE, dir.string().c_str());
+		return true;
+	}
+	return false;
+}
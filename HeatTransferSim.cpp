@@ -21,16 +21,61 @@ Date Created: 2021-11-22
 #include <string.h>
 #include <ctype.h>
 #include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <new>
+#include <system_error>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <complex>
+#include <atomic>
+#include "HeatTransferSim.h"
+
+#if defined(_M_X64) || defined(__x86_64__)   // explicit SIMD kernels, picked at run time by GetStencilKernels
+#define HTS_X86_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2     // MSVC accepts AVX intrinsics in any function
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2"), optimize("fp-contract=off")))     // no fused multiply-adds,
+#define TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off"))) // same rounding as scalar
+#endif
+#endif
+
+#if !defined(_WIN32) && !defined(HTS_LIBRARY) // TRANSPORT SHM: ranks run as worker processes of the program
+#define HTS_POSIX_SHM 1                         // itself, sharing a named POSIX shared memory object
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+extern char** environ;
+#endif
 
 //------- GLOBAL CONSTANTS ----------------------------------------------------------------------------------
 const double T0 = 0.0;     // normal background wall temperature (for initializing!)
+const size_t GRID_ALIGNMENT = 64;  // byte alignment of every grid plane and row (one cache line)
 
 const char* SIMULATION_DATA_FILE_HEADER1 = "Simulation    w      h      dx      dy";
 const char* SIMULATION_DATA_FILE_HEADER2 = "Boundary Conditions";
+const char* SIMULATION_DATA_FILE_HEADER3 = "Solver Settings";  // optional section, "<case|ALL> <KEY> <value>"
+const char* ALL_CASES = "ALL";                                 // solver settings name that matches every case
 const char* ENDMESSAGE = "Thank you for running this program!";
 const char* DASHES = "--------";
 const char* SIMULATIONS_INPUT_DATA_FILE = "simulations.in";
 const char* SIMULATION_CHOICE = "Select Simulation Case:";
+const char* BATCH_USAGE = "usage: HeatTransferSim [-j workers] <ALL | case | pattern>...   (pattern: * and ? wildcards)";
 
 const int CASE_TYPE_A = 0;
 const int CASE_TYPE_B = 1;
@@ -53,11 +98,115 @@ const int BC_TYPE_INSULATED = 2;
 const int BC_TYPE_POLY = 3;
 const int BC_TYPE_SINE = 4;
 
+const int SOLVER_GS = 0;   // lexicographic Gauss-Seidel (the default)
+const int SOLVER_SOR = 1;  // red-black successive over-relaxation
+const int SOLVER_MG = 2;   // geometric multigrid V-cycles after a full-multigrid start
+const int SOLVER_PCG = 3;  // matrix-free preconditioned conjugate gradient
+const int SOLVER_DST = 4;  // direct solve with a sine transform in x, SOR if the plate does not allow it
+const int SOLVER_CHOLESKY = 5; // direct solve with a cached banded Cholesky factor, DST if it is too big
+const int SOLVER_LINE = 6;     // line Gauss-Seidel, whole rows and/or columns solved with the Thomas algorithm
+const int SOLVER_ADI = 7;      // Peaceman-Rachford alternating direction implicit iteration
+const char* SOLVER_NAMES[] = { "GS", "SOR", "MG", "PCG", "DST", "CHOLESKY", "LINE", "ADI" }; // SOLVER setting values
+
+const int LINES_AUTO = 0;       // SOLVER LINE: x-lines if lamda < 1, y-lines if lamda > 1, else alternate
+const int LINES_X = 1;          // rows solved implicitly (coupling along x is the stronger)
+const int LINES_Y = 2;          // columns solved implicitly (coupling along y is the stronger)
+const int LINES_ALTERNATE = 3;  // rows then columns in every iteration
+const int MAX_ADI_SHIFTS = 32;        // most shifts in one ADI cycle
+const double ADI_SHIFT_RATIO = 5.0;   // ratio of neighbouring ADI shifts, sets how many the cycle has
+
+const int PRECOND_JACOBI = 0;  // PCG preconditioner: diagonal scaling
+const int PRECOND_SGS = 1;     // PCG preconditioner: symmetric Gauss-Seidel
+const int PRECOND_IC = 2;      // PCG preconditioner: incomplete Cholesky, no fill-in
+
+const int MAX_THREADS = 256;       // largest thread pool for the parallel sweeps
+
+const int MAX_PROCESSES = 64;      // most ranks of a decomposed SOR solve
+const int TRANSPORT_THREADS = 0;   // decomposed solve: threads of this process (the default, the only choice on Windows)
+const int TRANSPORT_SHM = 1;       // decomposed solve: worker processes, halos in shared memory (the program only)
+const char DD_WORKER_OPTION[] = "--subdomain-worker"; // argv[1] of a TRANSPORT SHM worker: <option> <region> <rank>
+const unsigned long DD_SPINS_PER_YIELD = 64;     // barrier polls between yields of the processor
+const unsigned long DD_SPINS_PER_CHECK = 65536;  // barrier polls between checks that every worker is alive
+
+const int EXIT_USAGE = 2;          // batch exit status for bad arguments or no matching case
+
+const int SIMD_AUTO = 0;     // stencil kernels: widest instruction set the CPU supports
+const int SIMD_SCALAR = 1;   // stencil kernels: plain C
+const int SIMD_AVX2 = 2;     // stencil kernels: 4 doubles per instruction
+const int SIMD_AVX512 = 3;   // stencil kernels: 8 doubles per instruction
+
+const int OUTPUT_BOTH = 0;    // output files: text .dat files and the binary solution file
+const int OUTPUT_TEXT = 1;    // output files: only the text .dat files
+const int OUTPUT_BINARY = 2;  // output files: only the binary solution file
+
+const char RESULT_FILE_MAGIC[8] = { 'H', 'T', 'S', 'P', 'L', 'A', 'T', 'E' }; // first bytes of a solution file
+const uint32_t RESULT_FILE_VERSION = 1;    // layout of RESULT_FILE_HEADER
+const uint32_t RESULT_HAS_ANALYTICAL = 1;  // RESULT_FILE_HEADER flags: the T_a plane holds a solution
+const size_t RESULT_HEADER_SIZE = 512;     // bytes before the first plane (a whole number of cache lines)
+
+const size_t CONVERGENCE_BLOCK = 4096;    // convergence records handed to the output thread at a time
+const int OUTPUT_TASK_CONVERGENCE = 0;    // output task: write a block of convergence records
+const int OUTPUT_TASK_SOLUTION = 1;       // output task: print the solution files of a case and free its grid
+
+const char CHECKPOINT_FILE_MAGIC[8] = { 'H', 'T', 'S', 'C', 'H', 'K', 'P', 'T' }; // first bytes of a checkpoint
+const uint32_t CHECKPOINT_FILE_VERSION = 2; // layout of CHECKPOINT_HEADER and CONVERGENCE_RECORD
+
+const int WARM_START_NONE = 0;      // every case starts from T0
+const int WARM_START_BILINEAR = 1;  // start from the coarser cases of the plate, bilinear interpolation
+const int WARM_START_BICUBIC = 2;   // start from the coarser cases of the plate, Catmull-Rom interpolation
+const int MAX_WARM_LEVELS = 8;      // most grids in one warm start, the case included
+
+const char* SOLUTION_CACHE_DIR = "hts_cache";  // directory of the solution cache (CACHE setting)
+const char CACHE_FILE_MAGIC[8] = { 'H', 'T', 'S', 'C', 'A', 'C', 'H', 'E' }; // first bytes of a cache entry
+const uint32_t CACHE_FILE_VERSION = 5;  // layout of CACHE_FILE_HEADER and CONVERGENCE_RECORD
+const int DEFAULT_CACHE_MB = 256;       // size limit of the solution cache unless CACHE_MB says otherwise
+const int TEMP_SUFFIX_SIZE = 40;        // ".<16 hex digits>.<16 hex digits>.tmp" of a cache entry being written
+
+const char FACTOR_FILE_MAGIC[8] = { 'H', 'T', 'S', 'F', 'A', 'C', 'T', 'R' }; // first bytes of a cached factor
+const uint32_t FACTOR_FILE_VERSION = 1; // layout of FACTOR_FILE_HEADER
+const int FACTOR_MAX_MB = 512;          // largest factor SOLVER CHOLESKY builds, bigger plates use DST
+const int FACTOR_MEMORY_MB = 1024;      // factors kept in memory between solves
+const int FACTOR_COMPUTED = 0;          // the operator was factored for this solve
+const int FACTOR_FROM_MEMORY = 1;       // ... found in the in-memory factor cache
+const int FACTOR_FROM_DISK = 2;         // ... read from SOLUTION_CACHE_DIR
+
+const int MIXED_CYCLE_SWEEPS = 256;         // most float32 sweeps on one correction before it is added to T_fd
+const double MIXED_CYCLE_REDUCTION = 1e-4;  // ... or once its residual estimate has fallen by this factor
+const double MIXED_SWITCH_ULPS = 64.0;      // float32 sweeps of T stop at this many ulps of the largest |T|
+
+const int TRANSIENT_NONE = 0;     // steady solve only (the default)
+const int TRANSIENT_EULER = 1;    // march with backward Euler steps first (L-stable, damps every mode)
+const int TRANSIENT_CN = 2;       // march with Crank-Nicolson steps first (second order in time)
+const char TRANSIENT_FILE_MAGIC[8] = { 'H', 'T', 'S', 'F', 'R', 'A', 'M', 'E' }; // first bytes of a frame file
+const uint32_t TRANSIENT_FILE_VERSION = 1;  // layout of the frame records after the header
+const double TRANSIENT_STEP_ERROR = 1e-3;   // local error allowed per step, relative to the hottest wall
+const double TRANSIENT_FIRST_STEP = 1e-3;   // default first step, in diffusion times of one cell (it is not checked)
+const double TRANSIENT_REJECT = 2.0;        // a step estimated this many allowances wrong is redone
+const double TRANSIENT_SAFETY = 0.9;        // new step = SAFETY * the step the error estimate asks for
+const double TRANSIENT_MAX_GROWTH = 2.0;    // largest ratio of a step to the one before
+const double TRANSIENT_MIN_SHRINK = 0.2;    // smallest ratio of a step to the one before
+const int TRANSIENT_MAX_REJECTS = 8;        // redone attempts of one step before it is taken anyway
+const int TRANSIENT_MAX_CYCLES = 30;        // multigrid V-cycles of one step
+
+const int MAX_AMR_LEVELS = 12;              // largest AMR_LEVELS (root cells 4096 case cells wide)
+const double AMR_TOLERANCE = 1e-2;          // default error estimate a quadtree leaf may keep, in kelvin
+const double AMR_PASS_RESIDUAL = 1e-3;      // composite grids that are refined further are relaxed to this times it
+
+const int MAX_MG_LEVELS = 16;      // deepest multigrid hierarchy
+const size_t MG_MIN_CELLS = 4;     // stop coarsening when a level has this few cells in x or y
+const int MG_PRE_SWEEPS = 2;       // red-black Gauss-Seidel sweeps before the coarse-grid correction
+const int MG_POST_SWEEPS = 2;      // red-black Gauss-Seidel sweeps after the coarse-grid correction
+const int MG_COARSE_SWEEPS = 50;   // sweeps that stand in for a direct solve on the coarsest level
+const int MG_FMG_CYCLES = 1;       // V-cycles on each level during the full-multigrid start
+
 const double PI = 3.141592653589793;
 const int MAX_BUFF_SIZE = 1024;              // for reading lines from a file
 const int MAX_ITER = 1000000;                // maximum iterations for F-D
 const double MAX_RESIDUAL = 1.0e-8;          // solution accuracy
-const double MAX_TRANSIENT_RESIDUAL = 0.01;  // transient solution accuracy
+const double MAX_TRANSIENT_RESIDUAL = 0.01;  // a transient march has settled once its steady residual is below this
+const int TRANSIENT_MAX_STEPS = 100000;      // most time steps of a transient march
+const int CASE_A_TERMS = 50;                 // odd terms n = 1 .. 99 of the case A series
+const double ANALYTIC_TOLERANCE = 1.0e-13;   // default series truncation error, relative to the first coefficient
 
 //--- Table Border Characters
 const unsigned char HL = 196;  // horizontal border line
@@ -72,16 +221,29 @@ const unsigned char BL = 192;  // bottom left border symbol
 const unsigned char BC = 193;  // bottom center border symbol
 const unsigned char BR = 217;  // bottom right border symbol
 
+//------- GLOBAL VARIABLES ----------------------------------------------------------------------------------
+// signal number of a SIGINT/SIGTERM that asked the solvers to save a checkpoint and stop, 0 = keep going.
+// Only set once installStopHandlers has run, i.e. when some case is checkpointing
+volatile sig_atomic_t nStopSignal = 0;
+// batch mode: console report of the case running on this thread, printed as one block by printCaseReport
+// once the case ends so the reports of concurrent cases do not interleave, NULL = print directly
+thread_local std::string* pCaseReport = NULL;
+// argv[0] of main: TRANSPORT SHM starts its workers from it where there is no /proc/self/exe
+const char* strProgram = NULL;
+
 
 //------- STRUCTURE DEFINITIONS -----------------------------------------------------------------------------
-typedef struct PLATEPOINT
+typedef struct PLATEGRID  // contiguous structure-of-arrays grid, node (i, j) lives at j * stride + i
 {
-	double x, y;   // grid node physical position on the plate
-	double T_a;    // grid node temperature (analytic solution)
-	double T_fd;   // grid node temperature (finite-difference solution)
-	double res;    // grid node residual for finite-difference solution
+	size_t I, J;     // number of nodes in x and y directions
+	size_t stride;   // row length in doubles (I rounded up to a whole cache line)
+	double dx, dy;   // x, y cell sizes (node positions are computed from the indices)
+	double* T_a;     // plane of grid node temperatures (analytic solution)
+	double* T_fd;    // plane of grid node temperatures (finite-difference solution)
+	double* res;     // plane of grid node residuals for finite-difference solution
+	void* block;     // the single allocation that backs all three planes
 }
-PLATEPOINT;
+PLATEGRID;
 
 typedef struct BOUNDARY_CONDITION_DATA
 {
@@ -93,6 +255,170 @@ typedef struct BOUNDARY_CONDITION_DATA
 }
 BOUNDARY_CONDITION_DATA;
 
+typedef struct MG_LEVEL  // one grid of the multigrid hierarchy, same row layout as PLATEGRID
+{
+	size_t I, J;       // number of nodes in x and y directions
+	size_t stride;     // row length in doubles
+	double dx, dy;     // cell sizes of this level
+	double lamda;      // (dx/dy)^2 of this level
+	double shift;      // a in a u - laplacian(u) = f: 0 for the plate, 1/(alpha theta dt) for a transient step
+	double* u;         // solution (level 0 is the plate's T_fd) or coarse-grid correction
+	double* f;         // right-hand side of a u - laplacian(u) = f
+	double* r;         // residual f - a u + laplacian(u), also scratch for restriction weights
+	void* block;       // allocation backing u, f and r (NULL for level 0's u)
+}
+MG_LEVEL;
+
+typedef struct MULTIGRID  // hierarchy of successively coarser grids, level 0 is the plate
+{
+	int nLevels;                   // number of levels in use
+	bool bInsulated;               // right wall is insulated (its column is unknown on every level)
+	MG_LEVEL level[MAX_MG_LEVELS]; // level 0 = finest
+}
+MULTIGRID;
+
+typedef struct PCG_DATA  // conjugate gradient work planes, same row layout as PLATEGRID
+{
+	size_t I, J, stride;  // grid dimensions
+	size_t iLast;         // last unknown column (I - 2, or I - 1 with an insulated right wall)
+	double lamda;         // (dx/dy)^2
+	int nPrecond;         // PRECOND_JACOBI, PRECOND_SGS, PRECOND_IC
+	double* r;            // residual b - A x
+	double* z;            // preconditioned residual
+	double* p;            // search direction
+	double* q;            // A p
+	double* d;            // preconditioner diagonal (A's diagonal, or the IC pivots)
+	double rz;            // r . z from the previous step
+	void* block;          // allocation backing the five planes
+}
+PCG_DATA;
+
+typedef struct LINE_DATA  // work space of line relaxation and ADI, same row layout as PLATEGRID
+{
+	size_t I, J, stride;  // grid dimensions
+	size_t iLast;         // last unknown column (I - 2, or I - 1 with an insulated right wall)
+	bool bInsulated;      // right wall is insulated
+	double lamda;         // (dx/dy)^2
+	bool bADI;            // Peaceman-Rachford ADI instead of line Gauss-Seidel
+	int nLines;           // line Gauss-Seidel: LINES_X, LINES_Y or LINES_ALTERNATE (AUTO resolved)
+	int nShifts;          // ADI shifts in one cycle
+	double shift[MAX_ADI_SHIFTS]; // ADI shifts, smallest first
+	int nStep;            // ADI iterations done, picks the shift
+	double* Tstar;        // ADI: the field after the x half (walls as in T_fd)
+	double* x;            // right-hand side, then solution, of one line
+	double* c;            // Thomas factors of one line
+	void* block;          // allocation backing the planes
+}
+LINE_DATA;
+
+typedef void (*POOL_JOB)(void* pArgs, int iThread, int nThreads); // work run by every thread of a pool
+
+typedef struct THREAD_POOL  // persistent helper threads; the calling thread takes part as thread 0
+{
+	int nThreads;                   // threads per job, including the caller
+	std::thread* workers;           // the nThreads - 1 helpers
+	std::mutex lock;                // guards everything below
+	std::condition_variable wake;   // signals a new job (or quit) to the helpers
+	std::condition_variable done;   // signals the caller that every helper finished
+	POOL_JOB job;                   // current job
+	void* pArgs;                    // its arguments
+	unsigned long generation;       // incremented for every job
+	int nBusy;                      // helpers still running the current job
+	bool bQuit;                     // helpers should exit
+}
+THREAD_POOL;
+
+typedef struct alignas(64) RESIDUAL_PARTIAL  // one thread's share of the residual, on its own cache line
+{
+	double rmax;   // largest residual in the thread's rows
+	double sumSq;  // sum of squared residuals in the thread's rows
+}
+RESIDUAL_PARTIAL;
+
+typedef struct STENCIL_KERNELS  // row kernels for one instruction set, see GetStencilKernels
+{
+	const char* strName;  // instruction set name for the console
+	// over-relaxes the nodes 1 <= i < I-1 with i % 2 == parity of row T
+	void (*relaxRow)(double* T, const double* Tn, const double* Ts, size_t I, int parity, double lamda, double omega);
+	// relaxRow that also folds the pre-update residuals of the relaxed nodes into *rmax and *sumSq
+	void (*relaxResidualRow)(double* T, const double* Tn, const double* Ts, size_t I, int parity, double lamda,
+		double omega, double* rmax, double* sumSq);
+	// fills R for 1 <= i < I-1 and folds the residuals into *rmax and *sumSq
+	void (*residualRow)(const double* T, const double* Tn, const double* Ts, double* R, size_t I, double lamda,
+		double* rmax, double* sumSq);
+	// relaxResidualRow in float32 with an optional right-hand side F (NULL = none), for PRECISION MIXED
+	void (*relaxRowFloat)(float* E, const float* En, const float* Es, const float* F, size_t I, int parity,
+		float lamda, float omega, double* rmax, double* sumSq);
+}
+STENCIL_KERNELS;
+
+typedef struct DFT_PLAN  // a length-M complex DFT, radix-2 directly or through Bluestein's chirp convolution
+{
+	size_t M;                        // transform length
+	size_t N;                        // power-of-two FFT length (M itself, or at least 2M - 1)
+	std::complex<double>* twiddle;   // e^(-2 pi i m / N) for m < N/2
+	std::complex<double>* chirp;     // e^(i pi m^2 / M) for m < M (Bluestein only)
+	std::complex<double>* filter;    // FFT of the chirp wrapped to length N (Bluestein only)
+	std::complex<double>* work;      // N values of scratch (Bluestein only)
+}
+DFT_PLAN;
+
+typedef struct MIXED_PRECISION  // float32 planes of the mixed-precision solver, same layout as a PLATEGRID plane
+{
+	size_t I, J;     // number of nodes in x and y directions
+	size_t stride;   // row length in floats (I rounded up to a whole cache line)
+	void* block;     // raw allocation holding both planes
+	float* E;        // the temperature during the float32 sweeps, then the correction being relaxed
+	float* F;        // right-hand side of the correction: the float64 residual of T_fd
+}
+MIXED_PRECISION;
+
+typedef struct SOLVER_DATA  // numerical solver choice for a simulation (all zero = plain Gauss-Seidel)
+{
+	int    nSolver;   // SOLVER_GS, SOLVER_SOR, SOLVER_MG, SOLVER_PCG, SOLVER_DST, SOLVER_CHOLESKY, SOLVER_LINE, SOLVER_ADI
+	double omega;     // SOR relaxation factor, 0 = compute the optimal value from I, J and lamda
+	int    nPrecond;  // PCG preconditioner: PRECOND_JACOBI, PRECOND_SGS, PRECOND_IC
+	int    nThreads;  // threads for the red-black SOR sweeps and residual, 0 or 1 = serial
+	int    nSimd;     // SIMD_AUTO, or the widest instruction set the stencil kernels may use
+	bool   bFused;    // GS/SOR: take the residual from the update in the same sweep (res is filled at the end)
+	int    nTileSweeps; // GS/SOR: sweeps per wavefront pass over the plate, 0 or 1 = one sweep at a time
+	int    nTileWidth;  // columns per wavefront strip, 0 = the whole row
+	int    nOutput;     // OUTPUT_BOTH, OUTPUT_TEXT or OUTPUT_BINARY
+	int    nCheckpointIter;    // iterations between checkpoint snapshots, 0 = none
+	double checkpointSeconds;  // wall time between checkpoint snapshots, 0 = none
+	bool   bResume;            // continue from "<case> checkpoint.hts" when there is one
+	int    nWarmStart;         // WARM_START_NONE, WARM_START_BILINEAR or WARM_START_BICUBIC
+	bool   bCache;             // load the solution from the solution cache, or store it there
+	int    nCacheMB;           // size limit of the solution cache in MB, 0 = DEFAULT_CACHE_MB
+	int    nMaxIter;           // iteration limit, 0 = MAX_ITER
+	bool   bMixed;             // GS/SOR: float32 sweeps with float64 residual refinement (PRECISION MIXED)
+	int    nLines;             // SOLVER LINE: LINES_AUTO, LINES_X, LINES_Y or LINES_ALTERNATE
+	int    nProcesses;         // SOR: bands of rows solved by separate ranks, 0 or 1 = none
+	int    nTransport;         // TRANSPORT_THREADS or TRANSPORT_SHM
+	int    nTransient;         // TRANSIENT_NONE, TRANSIENT_EULER or TRANSIENT_CN
+	double timeStep;           // first time step, 0 = TRANSIENT_FIRST_STEP diffusion times of one cell
+	double diffusivity;        // thermal diffusivity alpha, 0 = 1
+	double endTime;            // time the march stops at, 0 = at steady state
+	double frameTime;          // time between frames of "<case> Transient.hts", 0 = no frame file
+	int    nAmrLevels;         // quadtree refinement from root cells 2^n case cells wide, 0 = the uniform grid
+	double amrTolerance;       // error estimate a leaf may keep (K), 0 = AMR_TOLERANCE
+	double amrGradient;        // temperature change across a leaf that splits it anyway (K), 0 = no such test
+	double analyticTolerance;  // series truncation of the analytical solutions, 0 = ANALYTIC_TOLERANCE
+}
+SOLVER_DATA;
+
+typedef struct PHASE_TIMES  // wall time of each phase of the last run of a case, in seconds
+{
+	double parse;      // reading simulations.in (shared by every case)
+	double alloc;      // initialize
+	double bc;         // SetBoundaryConditions
+	double warm;       // solving the coarser cases of a warm start
+	double solve;      // GetNumericalSolution
+	double analytic;   // GetAnalyticalSolution
+	double output;     // printSolution, on the output thread
+}
+PHASE_TIMES;
+
 typedef struct SIMULATION_DATA    // holds data for each simulation
 {
 	double w, h, dx, dy;                   // plate width, plate height; x, y cellSizes
@@ -100,9 +426,443 @@ typedef struct SIMULATION_DATA    // holds data for each simulation
 	int nCaseType;                         // for chosing boundary conditions
 	char strCase[MAX_CASE_NAME_SIZE];      // case name
 	BOUNDARY_CONDITION_DATA bc[NUM_WALLS]; // one for each wall
+	SOLVER_DATA solver;                    // numerical solver choice and tuning
+	int iCoarser;                          // next coarser case of the same plate, -1 = none (LinkCaseFamilies)
+	PHASE_TIMES times;                     // phase timers of the last run (RunSimulation)
 }
 SIMULATION_DATA;
 
+typedef struct SWEEP_JOB  // arguments shared by the threads of a parallel sweep or residual pass
+{
+	PLATEGRID* G;                          // the plate grid
+	const SIMULATION_DATA* SD;             // the simulation data for the selected case
+	double lamda, omega;                   // (dx/dy)^2, relaxation factor
+	int color;                             // colour being relaxed, 0 = red, 1 = black
+	bool bFused;                           // the sweep also reduces the residual into partial
+	RESIDUAL_PARTIAL partial[MAX_THREADS]; // per-thread residual reductions
+}
+SWEEP_JOB;
+
+typedef struct alignas(64) DD_SLOT  // one rank's input to a reduction, on its own cache line
+{
+	double rmax;   // largest residual of the rank's band
+	double sumSq;  // sum of squared residuals of the band
+	int bStop;     // rank 0 only: every rank should leave the loop
+}
+DD_SLOT;
+
+typedef struct DD_IMAGE  // TRANSPORT SHM: the run as a worker process rebuilds it, written by rank 0 before launch
+{
+	SIMULATION_DATA SD;                  // the simulation data for the case
+	size_t I, J, stride;                 // the plate's nodes in x and y, row length
+	double dx, dy;                       // its cell sizes
+	double lamda, omega;                 // (dx/dy)^2, relaxation factor
+	int nRanks;                          // bands of rows
+	size_t rowStart[MAX_PROCESSES + 1];  // first row of each band, then J - 1
+	int iterStart, maxIter;              // iterations already done, iteration limit
+	size_t memBytes;                     // size of the shared region
+	size_t haloOffset, resultOffset;     // byte offsets of the halo rows and of the result planes
+	int nParent;                         // process of rank 0, a worker gives up once it has gone
+}
+DD_IMAGE;
+
+typedef struct DD_SHARED  // start of the shared region of a decomposed solve, then the halo rows and results
+{
+	std::atomic<int> nArrived;       // ranks waiting at the current barrier
+	std::atomic<int> nGeneration;    // barriers completed
+	std::atomic<int> bAbort;         // a rank failed: every barrier returns false from now on
+	DD_SLOT slot[2][MAX_PROCESSES];  // reduction inputs, the two sets used alternately
+	DD_IMAGE image;                  // TRANSPORT SHM: the run, for the workers
+}
+DD_SHARED;
+static_assert(std::atomic<int>::is_always_lock_free, "the barrier atomics must work between processes");
+
+typedef struct DD_RANK  // one rank of a decomposed solve, private to it
+{
+	int rank;             // 0 .. nRanks - 1, rank 0 is the calling thread
+	PLATEGRID* strip;     // its band: owned rows j0 .. j1-1 and a halo row on each side
+	size_t j0, j1;        // first owned plate row and one past the last
+	int nExchanges;       // halo exchanges done, picks the halo row set
+	int nReductions;      // reductions done, picks the slot set
+}
+DD_RANK;
+
+typedef struct DD_RUN DD_RUN;
+
+typedef struct HALO_TRANSPORT  // how the ranks of a decomposed solve run and talk; MPI would fill the same table
+{
+	const char* strName;                                       // for the console
+	bool (*open)(DD_RUN*);                                     // allocates the shared region of memBytes
+	bool (*launch)(DD_RUN*);                                   // starts ranks 1 .. nRanks-1
+	bool (*exchange)(DD_RUN*, DD_RANK*);                       // swaps edge rows with the neighbouring bands
+	bool (*reduce)(DD_RUN*, DD_RANK*, double*, double*, int*); // global rmax, sum of squares and stop flag
+	void (*gather)(DD_RUN*, DD_RANK*);                         // hands the owned rows of a band to rank 0
+	void (*abort)(DD_RUN*);                                    // makes every rank give up
+	bool (*alive)(DD_RUN*, int);                               // rank 0: no worker has died; a worker: rank 0 has not
+	bool (*join)(DD_RUN*);                                     // waits for ranks 1 .. nRanks-1
+	void (*close)(DD_RUN*);                                    // frees the shared region
+}
+HALO_TRANSPORT;
+
+struct DD_RUN  // a decomposed solve, read by every rank (rank 0 writes the results)
+{
+	PLATEGRID* G;                        // the plate grid
+	const SIMULATION_DATA* SD;           // the simulation data for the case
+	double lamda, omega;                 // (dx/dy)^2, relaxation factor
+	int nRanks;                          // bands of rows
+	size_t rowStart[MAX_PROCESSES + 1];  // first row of each band, then J - 1
+	int iterStart, maxIter;              // iterations already done, iteration limit
+	const HALO_TRANSPORT* transport;     // how the ranks run
+	void* mem;                           // the shared region
+	char strRegion[MAX_CASE_NAME_SIZE];  // TRANSPORT SHM: its name
+	size_t memBytes;                     // its size
+	size_t haloOffset, resultOffset;     // byte offsets of the halo rows and of the result planes
+	DD_SHARED* shared;                   // control block at the start of mem
+	int status[MAX_PROCESSES];           // TRANSPORT THREADS: status of each rank
+	int pid[MAX_PROCESSES];              // TRANSPORT SHM: process of each worker (rank 0), 0 once reaped
+	std::thread* threads;                // TRANSPORT THREADS: the workers
+	int iter;                            // results: iterations done,
+	double rmax, RMS;                    // ... final largest and RMS residual
+};
+
+typedef struct SERIES_JOB  // arguments shared by the threads evaluating a separable analytical solution
+{
+	PLATEGRID* G;          // the plate grid, T_a is filled
+	const double* a;       // wave numbers of the terms
+	const double* c;       // coefficients of the terms
+	double* sines;         // sin(a[m] x) of the interior columns, nCols per term
+	int nTerms;            // number of terms
+	size_t nCols;          // interior columns filled
+	double h;              // plate height
+	double tolerance;      // truncation error relative to |c[0]|
+}
+SERIES_JOB;
+
+typedef struct RESULT_FILE_HEADER  // start of "<case> Solution.hts", little-endian, no padding between fields
+{
+	char     magic[8];               // RESULT_FILE_MAGIC
+	uint32_t version;                // RESULT_FILE_VERSION
+	uint32_t headerSize;             // RESULT_HEADER_SIZE, the byte offset of the first plane
+	uint32_t flags;                  // RESULT_HAS_ANALYTICAL
+	uint32_t nPlanes;                // planes that follow: T_fd, T_a, res
+	uint64_t I, J;                   // number of nodes in x and y
+	uint64_t stride;                 // row length in doubles, node (i, j) of a plane is at j * stride + i
+	double   dx, dy;                 // cell sizes
+	double   w, h;                   // plate width and height
+	char     strCase[MAX_CASE_NAME_SIZE]; // case name, zero padded
+	int32_t  bcType[NUM_WALLS];      // BC_TYPE_* of TOP, BOTTOM, LEFT, RIGHT
+	double   bc[NUM_WALLS][7];       // Ta, Tb, za, zb, ma, mb, k of every wall
+	uint8_t  reserved[RESULT_HEADER_SIZE - 360]; // zero, pads the header to RESULT_HEADER_SIZE
+}
+RESULT_FILE_HEADER;
+static_assert(sizeof(RESULT_FILE_HEADER) == RESULT_HEADER_SIZE, "solution file header must not be padded");
+
+typedef struct CACHE_KEY  // everything that decides a converged field, hashed to name its cache entry
+{
+	double   w, h, dx, dy;            // plate and cells
+	double   bc[NUM_WALLS][7];        // Ta, Tb, za, zb, ma, mb, k of every wall
+	int32_t  bcType[NUM_WALLS];       // boundary type of every wall
+	int32_t  nSolver, nPrecond;       // solver and PCG preconditioner
+	int32_t  bFused;                  // residual from the sweep
+	int32_t  nTileSweeps, nTileWidth; // wavefront tiling
+	int32_t  nWarmStart;              // start from the coarser cases
+	int32_t  maxIter;                 // iteration limit
+	int32_t  bMixed;                  // float32 sweeps with float64 refinement
+	int32_t  nLines;                  // line directions of SOLVER LINE
+	int32_t  nTransient;              // time march before the steady solve
+	int32_t  nAmrLevels;              // quadtree refinement depth
+	int32_t  reserved;                // zero
+	double   omega;                   // SOR factor setting, 0 = optimal
+	double   tolerance;               // MAX_RESIDUAL
+	double   timeStep, diffusivity;   // transient settings, they decide where the march hands over
+	double   endTime, frameTime;
+	double   amrTolerance, amrGradient; // refinement settings, they decide the composite grid
+}
+CACHE_KEY;
+static_assert(sizeof(CACHE_KEY) == 384, "cache key must not be padded");
+
+typedef struct CACHE_FILE_HEADER  // start of a cache entry, then the T_fd and res planes and the convergence history
+{
+	char      magic[8];     // CACHE_FILE_MAGIC
+	uint32_t  version;      // CACHE_FILE_VERSION
+	int32_t   iter;         // iterations of the solve
+	CACHE_KEY key;          // the full key, so a hash collision is a miss
+	uint64_t  I, J;         // number of nodes in x and y
+	uint64_t  stride;       // row length of the planes in doubles
+	uint64_t  nRecords;     // CONVERGENCE_RECORDs after the planes
+	double    rmax, RMS;    // final residuals
+	int32_t   bConverged;   // the solve converged
+	uint32_t  reserved;     // zero
+}
+CACHE_FILE_HEADER;
+static_assert(sizeof(CACHE_FILE_HEADER) == 456, "cache file header must not be padded");
+
+typedef struct FACTOR_KEY  // what decides the 5-point operator, and so its factor
+{
+	uint64_t I, J;        // number of nodes in x and y
+	double   lamda;       // (dx/dy)^2
+	int32_t  bInsulated;  // the right wall is insulated (unknowns on it)
+	uint32_t reserved;    // zero
+}
+FACTOR_KEY;
+static_assert(sizeof(FACTOR_KEY) == 32, "factor key must not be padded");
+
+typedef struct BANDED_FACTOR  // lower Cholesky factor of the operator, row p holds columns p-b..p
+{
+	FACTOR_KEY key;   // the operator
+	size_t n, m;      // unknowns in x and y
+	size_t N;         // unknowns, n m
+	size_t b;         // bandwidth, the shorter of n and m
+	bool bColumns;    // unknowns numbered down the columns (m < n), else along the rows
+	double* L;        // N rows of b + 1 values
+}
+BANDED_FACTOR;
+
+typedef struct FACTOR_FILE_HEADER  // start of a cached factor "<hash>.hcf", then the N (b + 1) values of L
+{
+	char       magic[8];  // FACTOR_FILE_MAGIC
+	uint32_t   version;   // FACTOR_FILE_VERSION
+	int32_t    bColumns;  // unknowns numbered down the columns
+	FACTOR_KEY key;       // the full key, so a hash collision is a miss
+	uint64_t   n, m;      // unknowns in x and y
+	uint64_t   N, b;      // unknowns and bandwidth
+}
+FACTOR_FILE_HEADER;
+static_assert(sizeof(FACTOR_FILE_HEADER) == 80, "factor file header must not be padded");
+
+typedef struct FACTOR_CACHE_ENTRY  // a factor kept in memory
+{
+	BANDED_FACTOR* F;   // the factor
+	int nUsers;         // solves using it now, it is only dropped at 0
+	uint64_t lastUse;   // FACTOR_CACHE clock at the last use
+}
+FACTOR_CACHE_ENTRY;
+
+typedef struct FACTOR_CACHE  // the process-wide in-memory factor cache
+{
+	std::mutex lock;                         // guards everything below
+	std::vector<FACTOR_CACHE_ENTRY> entries; // the factors
+	uint64_t clock;                          // counts uses, for least recently used eviction
+	size_t bytes;                            // memory of all the factors
+}
+FACTOR_CACHE;
+
+typedef struct CACHE_ENTRY  // a cache file seen while evicting
+{
+	std::filesystem::path path;                 // the file
+	uint64_t size;                              // its size in bytes
+	std::filesystem::file_time_type time;       // last use
+}
+CACHE_ENTRY;
+
+typedef struct CHECKPOINT_HEADER  // start of "<case> checkpoint.hts", then the T_fd plane and the convergence history
+{
+	char     magic[8];   // CHECKPOINT_FILE_MAGIC
+	uint32_t version;    // CHECKPOINT_FILE_VERSION
+	int32_t  nSolver;    // solver of the run that wrote it
+	uint64_t I, J;       // number of nodes in x and y
+	uint64_t stride;     // row length of the T_fd plane in doubles
+	double   dx, dy;     // cell sizes
+	int32_t  iter;       // iterations done
+	uint32_t reserved;   // zero
+	uint64_t nRecords;   // CONVERGENCE_RECORDs after the plane, one per iteration done
+}
+CHECKPOINT_HEADER;
+static_assert(sizeof(CHECKPOINT_HEADER) == 72, "checkpoint header must not be padded");
+
+typedef struct SOLVE_INFO  // what SolvePlate did, for the console summary and the library statistics
+{
+	int    iter;        // iterations done
+	double rmax, RMS;   // final largest and RMS residual
+	bool   bConverged;  // the residual fell below MAX_RESIDUAL
+	double omega;       // SOR relaxation factor used (1 for the other solvers)
+	int    nThreads;    // threads of the parallel sweep
+	int    nLevels;     // multigrid levels
+	bool   bFused;      // the residual came from the sweep
+	bool   bTiled;      // several sweeps per wavefront pass
+	double seconds;     // wall time of this run of the solver loop, set-up included
+	int    iterRun;     // iterations done by this run (fewer than iter when resumed, 0 from the cache)
+	bool   bMixed;      // PRECISION MIXED was used
+	int    iterFloat;   // last iteration of the float32 sweeps of T (0 when resumed)
+	int    nRefinements; // float32 corrections added to T_fd in float64
+	int    iterDouble;  // iteration where float64 sweeps took over, 0 = never
+	int    nSolver;     // solver that ran: the setting, or the one it fell back to
+	bool   bFallback;   // a direct solver could not solve the plate
+	size_t nBandwidth;  // SOLVER CHOLESKY: bandwidth of the factor
+	int    nFactorSource; // FACTOR_COMPUTED, FACTOR_FROM_MEMORY or FACTOR_FROM_DISK
+	double factorSeconds; // time to factor, or to find the factor
+	int    nLines;      // SOLVER LINE: the line directions used
+	int    nShifts;     // SOLVER ADI: shifts in one cycle
+	int    nProcesses;  // SOR: ranks of the decomposed solve, 0 = not decomposed
+	const char* strTransport; // how those ranks ran
+	bool   bTransportFallback; // TRANSPORT SHM could not start its worker processes, the ranks ran as threads
+	size_t nAmrNodes;   // AMR_LEVELS: nodes of the final composite grid, 0 = not adaptive
+	int    nAmrLeaves;  // leaves of the final quadtree
+	int    nAmrDepth;   // its deepest leaf, in splits from a root cell
+	int    nAmrPasses;  // composite grids solved
+	double nodeUpdates; // node updates of all passes (for the MLUPS figure)
+}
+SOLVE_INFO;
+
+typedef struct TRANSIENT_INFO  // what SolveTransient did, for the console summary
+{
+	int    nSteps;        // accepted time steps
+	int    nRejected;     // attempts redone with a shorter step
+	int    nCycles;       // multigrid V-cycles of all attempts
+	int    nFrames;       // frames written
+	double t;             // time reached
+	double dtMin, dtMax;  // shortest and longest accepted step
+	double rmax, RMS;     // steady-state residual at the end
+	bool   bSteady;       // rmax fell below MAX_TRANSIENT_RESIDUAL
+	bool   bEndTime;      // the march reached END_TIME first
+	bool   bWriteFailed;  // a frame could not be written, the frame file is incomplete
+	double seconds;       // wall time of the march
+}
+TRANSIENT_INFO;
+
+typedef struct AMR_CELL  // one cell of the refinement quadtree, its corners are nodes of the case grid
+{
+	int32_t i0, j0;     // lower left corner node
+	int32_t i1, j1;     // upper right corner node
+	int32_t nDepth;     // splits from its root cell
+	int32_t iChild;     // first of its children (they are consecutive), -1 = a leaf
+	int32_t nChildren;  // 4, or 2 when the cell is one case cell wide in x or y
+	int32_t bSplit;     // marked to be split
+}
+AMR_CELL;
+
+typedef struct AMR_ROW  // the equation of one unknown of the composite grid: T[p] = sum of w[k] T[q[k]]
+{
+	size_t p;           // the node, as an index into the planes of the case grid
+	size_t q[6];        // the nodes its stencil reaches (unused ones are p with weight 0)
+	double w[6];        // their weights, summing to 1
+	bool   bHanging;    // relaxed with omega 1: over-relaxing the one-sided ghost coupling can diverge
+}
+AMR_ROW;
+
+typedef struct AMR_ARM  // one arm of the stencil of a composite node
+{
+	double h;           // distance to the neighbour
+	size_t q[2];        // the neighbour, or the two nodes a ghost neighbour is interpolated from
+	double w[2];        // interpolation weights (1 and 0 for a node)
+	double s;           // ghost: product of its distances to q[0] and q[1], 0 for a node
+}
+AMR_ARM;
+
+typedef struct AMR_MESH  // refinement quadtree over the case grid and the composite grid of its leaves
+{
+	AMR_CELL* cells;     // the tree, root cells first
+	size_t nCells;       // cells in the tree
+	size_t nCapacity;    // cells allocated
+	int32_t* leafOf;     // leaf covering each case cell, (I - 1) (J - 1) of them row by row
+	uint8_t* bNode;      // 1 for each case node that is a composite node, I J of them row by row
+	AMR_ROW* rows;       // equations of the unknowns, in sweep order
+	size_t nRows;        // unknowns (hanging nodes included)
+	size_t nRowCapacity; // rows allocated
+	size_t nNodes;       // composite grid nodes, the wall nodes included
+	int nLeaves;         // leaves of the tree
+	int nDepth;          // deepest leaf
+}
+AMR_MESH;
+
+struct HTS_PLATE  // a plate of the C interface: one case with its own grid, only cached factors are shared
+{
+	SIMULATION_DATA SD;  // geometry, boundary conditions and solver settings
+	PLATEGRID* G;        // the grid, allocated by hts_create_plate
+};
+
+typedef struct CONVERGENCE_RECORD  // one line of "<case> convergence.dat"
+{
+	double rmax, RMS;  // residuals after the iteration
+	double seconds;    // wall time since the solve started (resumed solves continue the saved clock)
+	int    iter;       // iterations done
+}
+CONVERGENCE_RECORD;
+
+typedef struct OUTPUT_TASK  // one piece of work for the output thread, run in the order submitted
+{
+	int nType;                      // OUTPUT_TASK_CONVERGENCE or OUTPUT_TASK_SOLUTION
+	FILE* f;                        // convergence file
+	CONVERGENCE_RECORD* records;    // block to write, freed with the task (may be NULL)
+	size_t nRecords;                // records in the block
+	bool bClose;                    // close f after the block
+	PLATEGRID* G;                   // grid to print, freed with the task
+	const SIMULATION_DATA* pSD;     // its case
+	int* pStatus;                   // case status, set to HTS_ERROR_FILE if printing fails
+	double* pSeconds;               // NULL, or receives the wall time of printSolution
+	std::string* pReport;           // batch: the case's report, finished and printed (and freed) by the task
+	struct OUTPUT_TASK* next;       // next task in the queue
+}
+OUTPUT_TASK;
+
+typedef struct OUTPUT_WRITER  // background thread that does the file output while the solvers keep going
+{
+	std::thread thread;             // the output thread
+	std::mutex lock;                // guards everything below
+	std::condition_variable wake;   // signals a new task (or quit) to the output thread
+	std::condition_variable idle;   // signals the waiting threads that the queue ran dry
+	OUTPUT_TASK* head;              // oldest task
+	OUTPUT_TASK* tail;              // newest task
+	bool bBusy;                     // the output thread is running a task
+	bool bQuit;                     // exit once the queue is empty
+}
+OUTPUT_WRITER;
+
+typedef struct CONVERGENCE_LOG  // convergence records of one solve on their way to the file
+{
+	OUTPUT_WRITER* W;               // output thread, NULL to write on the solver thread
+	FILE* f;                        // the open convergence file
+	CONVERGENCE_RECORD* records;    // block being filled
+	size_t n;                       // records in the block
+}
+CONVERGENCE_LOG;
+
+typedef struct CHECKPOINT  // snapshots of one solve, and the state a resumed solve starts from
+{
+	char strFile[MAX_BUFF_SIZE];    // "<case> checkpoint.hts"
+	int nInterval;                  // iterations between snapshots, 0 = none
+	double seconds;                 // wall time between snapshots, 0 = none
+	int iterStart;                  // iterations done by the run being resumed
+	int iterSaved;                  // iterations in the last snapshot
+	std::chrono::steady_clock::time_point lastSave; // time of the last snapshot (or of the start)
+	CONVERGENCE_RECORD* records;    // convergence history since iteration 1
+	size_t nRecords, nCapacity;     // records held, records allocated
+	bool bSaved;                    // at least one snapshot was written
+	bool bWriteFailed;              // a snapshot could not be written
+	bool bKeepHistory;              // record the history without snapshots (for the solution cache)
+}
+CHECKPOINT;
+
+typedef struct WARM_START  // the coarser cases solved to seed a case, coarsest first, the case itself last
+{
+	int nLevels;                        // levels filled in
+	int iCase[MAX_WARM_LEVELS];         // case of each level
+	int iter[MAX_WARM_LEVELS];          // iterations of each level, -1 for the case itself
+	double hCell[MAX_WARM_LEVELS];      // sqrt(dx dy) of each level
+	double errExact[MAX_WARM_LEVELS];   // RMS error against the analytical solution, -1 if there is none
+	double errChange[MAX_WARM_LEVELS];  // RMS change from the previous level, -1 on the coarsest
+	PLATEGRID* G;                       // solution of the last coarse level, seeds the next one
+}
+WARM_START;
+
+typedef struct CASE_QUEUE  // one batch worker's cases; the owner takes from the head, idle workers steal the tail
+{
+	std::mutex lock;   // guards head and tail
+	int* cases;        // case indices, largest grid first
+	int head, tail;    // next case to run, one past the last case
+}
+CASE_QUEUE;
+
+typedef struct BATCH_JOB  // arguments shared by the workers of a batch run
+{
+	SIMULATION_DATA* SD;    // the simulation data array
+	CASE_QUEUE* queues;     // one queue per worker
+	int* status;            // HTS return code of every case
+	double* seconds;        // wall time of every case (solve, without the queued output)
+	OUTPUT_WRITER* W;       // output thread shared by the workers, may be NULL
+}
+BATCH_JOB;
+
 
 //------------------------- FUNCTION PROTOTYPES -------------------------------------------------------------
 int  nint(double);                           // get the nearest integer to a double value
@@ -114,132 +874,965 @@ void removeNewline(char* str);               // removes newline at end of string
 bool isBlankLine(const char*);              // checks if a line contains only whitespace chars
 SIMULATION_DATA* GetSimulationData(SIMULATION_DATA*, int*); // reads a input file to obtain simulation data
 int caseTypetoInt(char*);                                   // converts string caseType to an integer
+void GetSolverSettings(SIMULATION_DATA*, int);              // reads the optional solver settings section
+bool setSolverOption(SOLVER_DATA*, const char*, const char*); // applies one KEY value solver setting
+int solverTypetoInt(const char*);                           // converts a solver name to an integer
 int getUserSimulationChoice(SIMULATION_DATA*, int);         // gets the users sim choice for processing 
 int  printHorizontalBorder(char, char);  // Prints the top or bottom border of the array display box
 void drawStringLine(const char*, int); // draws each string line within the menu block
-void GetCaseAAnalyticalSolution(PLATEPOINT**, const SIMULATION_DATA*); // xmas present! Thanks Dave!
-void GetCaseBAnalyticalSolution(PLATEPOINT**, const SIMULATION_DATA*); // xmas present! You're a cool dude
-void GetCaseCAnalyticalSolution(PLATEPOINT**, const SIMULATION_DATA*); // xmas present! Appreciate it 
-void GetNumericalSolution(PLATEPOINT**, const SIMULATION_DATA);  // numerically calculates the solution of each case
-void printSolution(PLATEPOINT**, const SIMULATION_DATA*); // 2nd xmas present!  Prints contour plot data.
-PLATEPOINT** initialize(int, SIMULATION_DATA*, PLATEPOINT**); // initializes the dynamic array
-PLATEPOINT** SetBoundaryConditions(PLATEPOINT**, SIMULATION_DATA*, int); // sets boundary conditions for each wall
-void FreeMemory(PLATEPOINT**, SIMULATION_DATA*, size_t); // frees the memory of the dynamically allocated arrays
+void GetCaseAAnalyticalSolution(PLATEGRID*, const SIMULATION_DATA*); // xmas present! Thanks Dave!
+void GetCaseBAnalyticalSolution(PLATEGRID*, const SIMULATION_DATA*); // xmas present! You're a cool dude
+void GetCaseCAnalyticalSolution(PLATEGRID*, const SIMULATION_DATA*); // xmas present! Appreciate it 
+bool GetAnalyticalSolution(PLATEGRID*, const SIMULATION_DATA*); // picks the analytical solution of the case
+void LinkCaseFamilies(SIMULATION_DATA*, int);                   // finds the next coarser case of every plate
+bool isSamePlate(const SIMULATION_DATA*, const SIMULATION_DATA*); // same plate and boundary conditions
+bool WarmStart(PLATEGRID*, const SIMULATION_DATA*, int, WARM_START*); // seeds a case from its coarser cases
+void ReportWarmStart(const PLATEGRID*, const SIMULATION_DATA*, int, bool, WARM_START*); // observed order of accuracy
+void InterpolateGrid(const PLATEGRID*, PLATEGRID*, const SIMULATION_DATA*, int); // coarse solution -> fine T_fd
+double sampleGrid(const PLATEGRID*, double, double, int);       // T_fd interpolated at a point
+double gridErrorRMS(const PLATEGRID*, const PLATEGRID*, int);  // RMS error or change
+bool isNestedGrid(const SIMULATION_DATA*, const SIMULATION_DATA*); // coarse nodes are all fine nodes
+void EvaluateSeriesSolution(PLATEGRID*, const SIMULATION_DATA*, const double*, const double*, int, size_t); // separable series
+void seriesRowsJob(void*, int, int);                            // pool job: the series on a band of rows
+double sinhRatio(double, double, double);                       // sinh(a y) / sinh(a h) without overflow
+void RunSimulation(SIMULATION_DATA*, int, OUTPUT_WRITER*, int*); // solves one case and queues its output files
+void printPhaseTimes(const SIMULATION_DATA*);                  // the phase timers of a case
+double secondsSince(std::chrono::steady_clock::time_point);    // wall time since a point
+int RunBatch(SIMULATION_DATA*, int, int, char**);               // headless run of the cases named on the command line
+void batchCasesJob(void*, int, int);                            // pool job: run queued cases, steal when idle
+void runBatchCase(BATCH_JOB*, int);                             // one case, its report printed as one block
+bool matchCasePattern(const char*, const char*);                // case name matches a pattern with * and ?
+void reportf(const char*, ...);                                 // printf, or into the batch report of the case
+void printCaseReport(const char*, const std::string*);          // a batch case's report, one block
+size_t caseNodeCount(const SIMULATION_DATA*);                   // grid nodes of a case before it is initialized
+int GetNumericalSolution(PLATEGRID*, const SIMULATION_DATA, OUTPUT_WRITER*); // numerically calculates the solution of each case
+int SolvePlate(PLATEGRID*, const SIMULATION_DATA*, CONVERGENCE_LOG*, CHECKPOINT*, SOLVE_INFO*); // the solver loop, no console output
+int UpdateCheckpoint(const PLATEGRID*, const SIMULATION_DATA*, CHECKPOINT*, double, double, double, int); // history, snapshots, stop
+int SolveTransient(PLATEGRID*, const SIMULATION_DATA*, const char*, TRANSIENT_INFO*); // implicit time march
+bool writeTransientFrame(FILE*, const PLATEGRID*, double, double, int, double, double); // appends one frame
+int SolveAdaptive(PLATEGRID*, const SIMULATION_DATA*, CONVERGENCE_LOG*, CHECKPOINT*, SOLVE_INFO*); // AMR_LEVELS
+bool CreateAmrMesh(const PLATEGRID*, const SIMULATION_DATA*, AMR_MESH*); // root cells of the quadtree
+void FreeAmrMesh(AMR_MESH*);                                    // frees the tree and the composite grid
+bool splitAmrCell(AMR_MESH*, size_t);                           // adds the children of a leaf
+void mapAmrLeaves(const PLATEGRID*, AMR_MESH*);                 // leaf of every case cell, leaf count and depth
+bool BuildAmrRows(const PLATEGRID*, const SIMULATION_DATA*, AMR_MESH*); // equations of the composite grid
+bool isFixedNode(const PLATEGRID*, const SIMULATION_DATA*, size_t, size_t); // a wall node the solvers never change
+void SweepAmr(PLATEGRID*, const AMR_MESH*, double);             // one SOR sweep of the composite grid
+void GetAmrResidual(const PLATEGRID*, const AMR_MESH*, double*, double*); // its residual
+void ResampleAmr(PLATEGRID*, const SIMULATION_DATA*, const AMR_MESH*); // composite solution onto every case node
+int RefineAmrMesh(const PLATEGRID*, const SIMULATION_DATA*, AMR_MESH*); // splits the leaves the residual flags
+bool WriteCheckpoint(const PLATEGRID*, const SIMULATION_DATA*, CHECKPOINT*, int); // writes a snapshot
+bool LoadCheckpoint(PLATEGRID*, const SIMULATION_DATA*, CHECKPOINT*); // reads the snapshot of a resumed case
+void FreeCheckpoint(CHECKPOINT*);                               // frees the convergence history
+bool isCheckpointing(const SOLVER_DATA*);                       // the case writes snapshots
+void makeCacheKey(const SIMULATION_DATA*, CACHE_KEY*);          // what decides the converged field
+uint64_t hashBytes(const void*, size_t);                        // 64-bit FNV-1a
+bool LoadCachedSolution(PLATEGRID*, const SIMULATION_DATA*, CONVERGENCE_LOG*, SOLVE_INFO*); // cache lookup
+bool hasCachedSolution(const SIMULATION_DATA*);                 // the cache has an entry for the case
+bool StoreCachedSolution(const PLATEGRID*, const SIMULATION_DATA*, const CHECKPOINT*, const SOLVE_INFO*); // cache insert
+void evictSolutionCache(uint64_t);                              // drops least recently used entries
+void installStopHandlers(const SIMULATION_DATA*, int);          // SIGINT/SIGTERM stop checkpointing cases cleanly
+void requestStop(int);                                          // signal handler, see nStopSignal
+void SweepGaussSeidel(PLATEGRID*, const SIMULATION_DATA*, double); // one lexicographic Gauss-Seidel sweep
+void SweepGaussSeidelFused(PLATEGRID*, const SIMULATION_DATA*, double, double*, double*); // ... with its residual
+void SweepRedBlackSOR(PLATEGRID*, const SIMULATION_DATA*, double, double, double*, double*); // one red-black SOR sweep
+void RelaxRedBlackRows(PLATEGRID*, const SIMULATION_DATA*, double, double, int, size_t, size_t, double*, double*);
+double GetOptimalOmega(const PLATEGRID*, const SIMULATION_DATA*, double); // optimal SOR factor for the plate
+void SweepTiled(PLATEGRID*, const SIMULATION_DATA*, double, double, double*, double*); // several sweeps, wavefront order
+void RelaxTileSegment(PLATEGRID*, const SIMULATION_DATA*, double, double, int, size_t, size_t, size_t, double*, double*);
+void GetResidual(PLATEGRID*, const SIMULATION_DATA*, double, double*, double*); // fills res, rmax and RMS
+void GetResidualRows(PLATEGRID*, const SIMULATION_DATA*, double, size_t, size_t, double*, double*); // some rows
+int SolveMixedPrecision(PLATEGRID*, const SIMULATION_DATA*, double, double, int, CONVERGENCE_LOG*, CHECKPOINT*,
+	std::chrono::steady_clock::time_point, double, int*, double*, double*, SOLVE_INFO*); // float32 sweeps, float64 refinement
+bool CreateMixedPrecision(const PLATEGRID*, MIXED_PRECISION*); // allocates the float32 planes
+void SweepMixedPrecision(MIXED_PRECISION*, const SIMULATION_DATA*, float, float, bool, double*, double*); // one float32 sweep
+void GetMixedResidual(const PLATEGRID*, const SIMULATION_DATA*, double, MIXED_PRECISION*, double*, double*); // float64 residual into F
+void ApplyMixedCorrection(PLATEGRID*, const SIMULATION_DATA*, const MIXED_PRECISION*, bool); // T_fd = E or T_fd += E
+int SolveDirectDST(PLATEGRID*, const SIMULATION_DATA*, double);   // sine transform in x, Thomas in y
+bool CreateDFTPlan(size_t, DFT_PLAN*);                            // twiddles and Bluestein chirp for one length
+void FreeDFTPlan(DFT_PLAN*);                                      // frees the tables of a plan
+void RunDFT(DFT_PLAN*, std::complex<double>*);                    // in-place forward DFT of any length
+void fftRadix2(std::complex<double>*, const DFT_PLAN*);           // in-place power-of-two FFT
+int SolveDirectCholesky(PLATEGRID*, const SIMULATION_DATA*, double, SOLVE_INFO*); // cached banded factor, two triangular solves
+size_t factorIndex(const BANDED_FACTOR*, size_t, size_t);        // position of an unknown in a factor
+BANDED_FACTOR* AcquireFactor(const FACTOR_KEY*, const SOLVER_DATA*, int*); // memory cache, disk cache or factor
+void ReleaseFactor(BANDED_FACTOR*);                              // hands a factor back to the cache
+FACTOR_CACHE* getFactorCache();                                  // the process-wide factor cache
+size_t factorBytes(size_t, size_t);                              // size of a band
+BANDED_FACTOR* CreateFactor(const FACTOR_KEY*);                  // assembles and factors the operator
+double dotBand(const double*, const double*, size_t);            // dot product of two runs of a band
+void FreeFactor(BANDED_FACTOR*);                                 // frees a factor
+BANDED_FACTOR* LoadFactor(const FACTOR_KEY*);                    // reads a factor from the cache directory
+void StoreFactor(const BANDED_FACTOR*, uint64_t);                // writes a factor to the cache directory
+int SolveDecomposed(PLATEGRID*, const SIMULATION_DATA*, double, double, CONVERGENCE_LOG*, CHECKPOINT*, SOLVE_INFO*); // PROCESSES
+int RunSubdomain(DD_RUN*, int, CONVERGENCE_LOG*, CHECKPOINT*);   // iteration loop of one rank
+PLATEGRID* CreateSubdomainGrid(const PLATEGRID*, size_t, size_t); // a band of rows with its halo rows
+void FreeSubdomainGrid(PLATEGRID*);                              // frees a band
+const HALO_TRANSPORT* GetHaloTransport(int);                     // function table of a TRANSPORT
+bool sharedExchange(DD_RUN*, DD_RANK*);                          // halo rows through the shared region
+bool sharedReduce(DD_RUN*, DD_RANK*, double*, double*, int*);    // residual reduction through the shared region
+void sharedGather(DD_RUN*, DD_RANK*);                            // owned rows into the result planes
+void sharedAbort(DD_RUN*);                                       // releases every rank from its barrier
+bool ddBarrier(DD_RUN*, int);                                    // waits for every rank
+double* ddHaloRow(DD_RUN*, int, int, int);                       // an edge row in the shared region
+double* ddResultT(DD_RUN*);                                      // result T_fd plane in the shared region
+double* ddResultRes(DD_RUN*);                                    // result res plane in the shared region
+bool threadsOpen(DD_RUN*);                                       // TRANSPORT THREADS
+bool threadsLaunch(DD_RUN*);
+bool threadsAlive(DD_RUN*, int);
+bool threadsJoin(DD_RUN*);
+void threadsClose(DD_RUN*);
+#ifdef HTS_POSIX_SHM
+bool shmOpen(DD_RUN*);                                           // TRANSPORT SHM
+bool shmLaunch(DD_RUN*);
+bool shmAlive(DD_RUN*, int);
+bool shmJoin(DD_RUN*);
+void shmClose(DD_RUN*);
+int RunSubdomainWorker(const char*, int);                        // main of a TRANSPORT SHM worker process
+#endif
+THREAD_POOL* CreateThreadPool(int);                        // starts the helper threads
+void FreeThreadPool(THREAD_POOL*);                         // stops and joins the helper threads
+void RunThreadPool(THREAD_POOL*, POOL_JOB, void*);         // runs a job on every thread and waits for it
+void threadPoolWorker(THREAD_POOL*, int);                  // helper thread main loop
+void getRowRange(int, int, size_t, size_t*, size_t*);      // interior rows owned by one thread
+void SweepRedBlackSORParallel(THREAD_POOL*, SWEEP_JOB*, double*, double*); // one red-black SOR sweep on the pool
+void GetResidualParallel(THREAD_POOL*, SWEEP_JOB*, double*, double*); // residual with per-thread reductions
+void combineResidualPartials(const THREAD_POOL*, const SWEEP_JOB*, double*, double*); // rmax and RMS of the threads
+void relaxRowsJob(void*, int, int);                        // pool job: relax one colour
+void residualRowsJob(void*, int, int);                     // pool job: residual of a band of rows
+const STENCIL_KERNELS* GetStencilKernels(int);             // row kernels for the best usable instruction set
+int getCpuSimdLevel();                                     // widest SIMD instruction set of this CPU and OS
+void relaxRowScalar(double*, const double*, const double*, size_t, int, double, double);
+void relaxResidualRowScalar(double*, const double*, const double*, size_t, int, double, double, double*, double*);
+void residualRowScalar(const double*, const double*, const double*, double*, size_t, double, double*, double*);
+void relaxRowFloatScalar(float*, const float*, const float*, const float*, size_t, int, float, float, double*, double*);
+#ifdef HTS_X86_SIMD
+void relaxRowAVX2(double*, const double*, const double*, size_t, int, double, double);
+void relaxResidualRowAVX2(double*, const double*, const double*, size_t, int, double, double, double*, double*);
+void residualRowAVX2(const double*, const double*, const double*, double*, size_t, double, double*, double*);
+void relaxRowFloatAVX2(float*, const float*, const float*, const float*, size_t, int, float, float, double*, double*);
+void relaxRowAVX512(double*, const double*, const double*, size_t, int, double, double);
+void relaxResidualRowAVX512(double*, const double*, const double*, size_t, int, double, double, double*, double*);
+void residualRowAVX512(const double*, const double*, const double*, double*, size_t, double, double*, double*);
+void relaxRowFloatAVX512(float*, const float*, const float*, const float*, size_t, int, float, float, double*, double*);
+#endif
+MULTIGRID* CreateMultigrid(PLATEGRID*, const SIMULATION_DATA*); // builds the coarse grid hierarchy
+void FreeMultigrid(MULTIGRID*);                                 // frees the coarse grid hierarchy
+void SolveFullMultigrid(MULTIGRID*);                            // full-multigrid initial guess on level 0
+void MultigridVCycle(MULTIGRID*, int);                          // one V-cycle starting at the given level
+void SmoothMultigridLevel(MG_LEVEL*, bool);                     // one red-black Gauss-Seidel sweep with rhs
+void GetMultigridResidual(MG_LEVEL*, bool);                     // r = f - a u + laplacian(u) on one level
+void RestrictMultigridResidual(const MG_LEVEL*, MG_LEVEL*);     // fine residual -> coarse right-hand side
+void ProlongMultigrid(const MG_LEVEL*, MG_LEVEL*, bool, bool);  // bilinear coarse -> fine transfer
+PCG_DATA* CreatePCG(PLATEGRID*, const SIMULATION_DATA*, double); // sets up the first PCG direction
+void FreePCG(PCG_DATA*);                                         // frees the PCG work planes
+void StepPCG(PCG_DATA*, PLATEGRID*);                             // one conjugate gradient iteration
+LINE_DATA* CreateLineSolver(PLATEGRID*, const SIMULATION_DATA*, double, int); // line directions and ADI shifts
+void FreeLineSolver(LINE_DATA*);                                 // frees the line solver work space
+void SweepLines(LINE_DATA*, PLATEGRID*);                         // one line Gauss-Seidel iteration
+void StepADI(LINE_DATA*, PLATEGRID*);                            // one Peaceman-Rachford iteration
+void solveTridiagonal(double*, double*, size_t, double, double, double); // Thomas algorithm, constant coefficients
+void ApplyPCGOperator(const PCG_DATA*, const double*, double*, bool); // A x, or b - A x with the walls
+void ApplyPreconditioner(PCG_DATA*);                             // z = M^-1 r
+double dotPCG(const PCG_DATA*, const double*, const double*);    // dot product over the unknowns
+bool printSolution(const PLATEGRID*, const SIMULATION_DATA*); // 2nd xmas present!  Prints contour plot data.
+bool printTextSolution(const PLATEGRID*, const SIMULATION_DATA*);   // the three text .dat files
+bool printBinarySolution(const PLATEGRID*, const SIMULATION_DATA*); // the binary "<case> Solution.hts"
+void fillResultHeader(const PLATEGRID*, const SIMULATION_DATA*, RESULT_FILE_HEADER*); // header of a solution or frame file
+OUTPUT_WRITER* CreateOutputWriter();                     // starts the output thread
+void FreeOutputWriter(OUTPUT_WRITER*);                   // finishes the queued output and joins the thread
+void FlushOutputWriter(OUTPUT_WRITER*);                  // waits until the queued output is written
+void SubmitOutputTask(OUTPUT_WRITER*, const OUTPUT_TASK*); // queues a task (runs it here without a thread)
+void outputWriterThread(OUTPUT_WRITER*);                 // output thread main loop
+void runOutputTask(OUTPUT_TASK*);                        // does the work of a task and frees its data
+void logConvergence(CONVERGENCE_LOG*, double, double, double, int); // records one iteration
+void closeConvergenceLog(CONVERGENCE_LOG*);              // hands the last block over and closes the file
+PLATEGRID* initialize(int, SIMULATION_DATA*, PLATEGRID*); // allocates and zeroes the plate grid
+PLATEGRID* SetBoundaryConditions(PLATEGRID*, SIMULATION_DATA*, int); // sets boundary conditions for each wall
+void FreeMemory(PLATEGRID*, SIMULATION_DATA*); // frees the memory of the dynamically allocated arrays
+
+//------------------------- INLINE GRID HELPERS -------------------------------------------------------------
+// flat index of node (i, j) in any plane of the grid
+inline size_t gridIndex(const PLATEGRID* G, size_t i, size_t j) { return j * G->stride + i; }
+// physical x position of column i
+inline double gridX(const PLATEGRID* G, size_t i) { return (double)i * G->dx; }
+// physical y position of row j
+inline double gridY(const PLATEGRID* G, size_t j) { return (double)j * G->dy; }
 
 
+#ifndef HTS_LIBRARY
 //-----------------------------------------------------------------------------------------------------------
-int main()
+int main(int argc, char* argv[])
 {
 	int iS = -1, NS = -1;         // chosen simulation index, number of simulations
-	PLATEPOINT** P = NULL;        // For 2D dynamically allocated array for a simulation
+	int nStatus;                  // batch exit status, or the HTS status of the interactive case
 	SIMULATION_DATA* SD = NULL;   // the array to hold simulation data for all cases in simulations.in
+	OUTPUT_WRITER* W;             // output thread of the interactive run
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // parse timer
+	double parseSeconds;          // wall time of reading simulations.in
 
+	strProgram = argv[0];
+#ifdef HTS_POSIX_SHM
+	if (argc == 4 && strcmp(argv[1], DD_WORKER_OPTION) == 0) return RunSubdomainWorker(argv[2], atoi(argv[3]));
+#endif
 	SD = GetSimulationData(SD, &NS);
+	if (SD == NULL) // no input file (or no memory), only wait for the user when there is one
+	{
+		if (argc <= 1) waitForEnterKey();
+		return EXIT_FAILURE;
+	}
+	GetSolverSettings(SD, NS);
+	LinkCaseFamilies(SD, NS);
+	parseSeconds = secondsSince(start);
+	for (iS = 0; iS < NS; iS++) SD[iS].times.parse = parseSeconds;
+	if (argc > 1) // headless batch run of the cases named on the command line
+	{
+		installStopHandlers(SD, NS);
+		nStatus = RunBatch(SD, NS, argc, argv);
+		FreeMemory(NULL, SD);
+		hts_release_caches();
+		return nStatus;
+	}
 	iS = getUserSimulationChoice(SD, NS);
-	P = initialize(iS, SD, P);
-	P = SetBoundaryConditions(P, SD, iS);
-	GetNumericalSolution(P, SD[iS]);
-	if (strcmp(SD[iS].strCase, "A-1") == 0 || strcmp(SD[iS].strCase, "A-2") == 0)
-		GetCaseAAnalyticalSolution(P, &SD[iS]);
-	else if (strcmp(SD[iS].strCase, "B-1") == 0 || strcmp(SD[iS].strCase, "B-2") == 0)
-		GetCaseBAnalyticalSolution(P, &SD[iS]);
-	else if (strcmp(SD[iS].strCase, "C-1") == 0 || strcmp(SD[iS].strCase, "C-2") == 0 || strcmp(SD[iS].strCase, "C-3") == 0)
-		GetCaseCAnalyticalSolution(P, &SD[iS]);
-	printSolution(P, &SD[iS]);
-	FreeMemory(P, SD, SD[iS].I);
+	installStopHandlers(&SD[iS], 1);
+	W = CreateOutputWriter(); // NULL writes on this thread
+	RunSimulation(SD, iS, W, &nStatus);
+	FreeOutputWriter(W); // the output timer is final once the files are written
+	printf("\nPhase times of \"%s\"\n", SD[iS].strCase);
+	printPhaseTimes(&SD[iS]);
+	FreeMemory(NULL, SD);
+	hts_release_caches();
 	waitForEnterKey();
-	
+
 	endProgram(NULL);
 }
+#endif
 
 //-----------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  This function reads from the input file to store the data uesd for the simulation
-// ARGUMENTS:    *SD: the SIMULATION_DATA array, 
-// RETURN VALUE: SD dynamic array, int NS
-//               
-//               
-SIMULATION_DATA* GetSimulationData(SIMULATION_DATA* SD, int* NS)
+// DESCRIPTION:  Solves one case from start to finish: grid, boundary conditions, numerical and analytical
+//               solutions and the output files.  Cases only share the read-only solver settings, so several
+//               can run at once on different iS.  The convergence records and the solution files go through
+//               the output thread, which takes over the grid; *pStatus and SD[iS].times.output are final
+//               once W has been flushed.  Every phase is timed into SD[iS].times
+// ARGUMENTS:    SD:      the simulation data array (I and J of case iS are filled in)
+//               iS:      the case to run
+//               W:       the output thread, NULL to write the files before returning
+//               pStatus: returns HTS_OK, HTS_ERROR_NOT_CONVERGED, HTS_ERROR_FILE, HTS_ERROR_MEMORY, 
+//                        HTS_ERROR_ARGUMENT or HTS_ERROR_INTERRUPTED
+// RETURN VALUE: none
+void RunSimulation(SIMULATION_DATA* SD, int iS, OUTPUT_WRITER* W, int* pStatus)
 {
-	FILE* fin;                         // file input stream
-	errno_t err;                       // error stream
-	const char* caseSeps = " \t\n/";   // word delimiters
-	char data[MAX_BUFF_SIZE] = {};     // temporary storage array for the tokenized string
-	char* tok = NULL, * nextToken = NULL, * pRet = NULL, * pGarbage; // tok variables to tokenize
-	int n, i;                          // counters
-	int N = 0; // int variable for NS
-	// opens the input file and checks to see if the file exists
-	err = fopen_s(&fin, SIMULATIONS_INPUT_DATA_FILE, "r"); 
-	if (err != 0 || fin == NULL) // checks to see if file exists
+	PLATEGRID* G = NULL;   // the contiguous temperature/residual grid for the case
+	OUTPUT_TASK task = {}; // prints the solution files and frees G
+	WARM_START ws = {};    // coarser cases that seeded G
+	bool bAnalytical;      // the case has an analytical solution
+	PHASE_TIMES* T = &SD[iS].times; // phase timers of the case
+	std::chrono::steady_clock::time_point start; // start of the phase being timed
+
+	if (nStopSignal != 0) // a batch run was stopped before this case started
 	{
-		printf("Cannot open file :/"); 
-		waitForEnterKey();
-		exit(EXIT_FAILURE);
+		*pStatus = HTS_ERROR_INTERRUPTED;
+		return;
 	}
-	// reads the input file per line until it reaches the sim data header or the dashes lines 
-	while (fgets(data, MAX_BUFF_SIZE, fin) != NULL) 
+	T->alloc = T->bc = T->warm = T->solve = T->analytic = T->output = 0.0;
+	start = std::chrono::steady_clock::now();
+	G = initialize(iS, SD, G);
+	T->alloc = secondsSince(start);
+	if (G == NULL)
 	{
-		// if the current line read is the sim data header, it will skip past it and not do anything
-		if (strstr(data, SIMULATION_DATA_FILE_HEADER1) != NULL) continue; 
-		// if the current line read is the dashed lines, it will break out the loop 
-		if (strstr(data, DASHES) != NULL)break;
+		reportf("\nCannot allocate the grid of \"%s\"\n", SD[iS].strCase);
+		*pStatus = SD[iS].I < 3 || SD[iS].J < 3 ? HTS_ERROR_ARGUMENT : HTS_ERROR_MEMORY;
+		return;
 	}
-	// continues to read through the document line by line
-	while (fgets(data, MAX_BUFF_SIZE, fin) != NULL) 
+	start = std::chrono::steady_clock::now();
+	G = SetBoundaryConditions(G, SD, iS);
+	T->bc = secondsSince(start);
+	if (SD[iS].solver.nWarmStart != WARM_START_NONE && SD[iS].iCoarser >= 0 &&
+		!(SD[iS].solver.bCache && hasCachedSolution(&SD[iS])))
 	{
-		// checks to see if the current line is a blank line and if it is it will skip it
-		if (isBlankLine(data)) continue;
-		// checks to see if the current line is sim data header 2 and if it 
-		//is it will stop looping through each line
-		if (strstr(data, SIMULATION_DATA_FILE_HEADER2) != NULL) break;
-		// if the data array is not a NULL character, it will increment up after each line is read
-		if (data != NULL) N++;
+		start = std::chrono::steady_clock::now();
+		if (!WarmStart(G, SD, iS, &ws)) reportf("\nOut of memory for the warm start of \"%s\", starting from T0", SD[iS].strCase);
+		T->warm = secondsSince(start);
 	}
-	*NS = N; // pointer NS is set to line counter N
-	printf("Number of cases = %d", *NS);
-	rewind(fin); // rewinds the document from the beginning to read and tokenize
-	// dynamically allocates memory for a sim data array 
-	//to store simulation data and intializes it all to 0
-	SD = (SIMULATION_DATA*)calloc(*NS, sizeof(SIMULATION_DATA));
-	if (SD == NULL) exit(0); // if the array contains NULL, the program will end upon exit
-	while (fgets(data, MAX_BUFF_SIZE, fin) != NULL) // reads through the input file line by line
+	start = std::chrono::steady_clock::now();
+	*pStatus = GetNumericalSolution(G, SD[iS], W);
+	T->solve = secondsSince(start);
+	if (*pStatus == HTS_ERROR_MEMORY || *pStatus == HTS_ERROR_INTERRUPTED) // no solution files
 	{
-		// if the current line contains the sim data header string, it will skip
-		if (strstr(data, SIMULATION_DATA_FILE_HEADER1)) continue;
-		// if the current line contains dashes, it will break out of the loop
-		if (strstr(data, DASHES)) break; 
+		FreeMemory(ws.G, NULL);
+		FreeMemory(G, NULL);
+		return;
 	}
-	// looping through for total number of simulations
-	for (n = 0; n < *NS; n++)
+	start = std::chrono::steady_clock::now();
+	bAnalytical = GetAnalyticalSolution(G, &SD[iS]);
+	T->analytic = secondsSince(start);
+	if (ws.nLevels > 0) ReportWarmStart(G, SD, iS, bAnalytical, &ws);
+
+	task.nType = OUTPUT_TASK_SOLUTION;
+	task.G = G;
+	task.pSD = &SD[iS];
+	task.pStatus = pStatus;
+	task.pSeconds = &T->output;
+	task.pReport = pCaseReport; // batch: the file lines end the report, the task prints it
+	pCaseReport = NULL;
+	SubmitOutputTask(W, &task);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Prints the phase timers of the last run of a case on one indented line (after its output
+//               has been written)
+// ARGUMENTS:    pSD: the case
+// RETURN VALUE: none
+void printPhaseTimes(const SIMULATION_DATA* pSD)
+{
+	const PHASE_TIMES* T = &pSD->times; // the timers
+
+	printf("    parse %.4lf s, allocate %.4lf s, boundary conditions %.4lf s", T->parse, T->alloc, T->bc);
+	if (T->warm > 0.0) printf(", warm start %.4lf s", T->warm);
+	printf(", solve %.4lf s, analytical %.4lf s, output %.4lf s\n", T->solve, T->analytic, T->output);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Wall time elapsed since a point, for the phase timers
+// ARGUMENTS:    start: the point
+// RETURN VALUE: seconds
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Computes the analytical solution of the cases that have one (picked by case name)
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for the case
+// RETURN VALUE: true if the case has one
+bool GetAnalyticalSolution(PLATEGRID* G, const SIMULATION_DATA* SD)
+{
+	if (strcmp(SD->strCase, "A-1") == 0 || strcmp(SD->strCase, "A-2") == 0)
+		GetCaseAAnalyticalSolution(G, SD);
+	else if (strcmp(SD->strCase, "B-1") == 0 || strcmp(SD->strCase, "B-2") == 0)
+		GetCaseBAnalyticalSolution(G, SD);
+	else if (strcmp(SD->strCase, "C-1") == 0 || strcmp(SD->strCase, "C-2") == 0 || strcmp(SD->strCase, "C-3") == 0)
+		GetCaseCAnalyticalSolution(G, SD);
+	else return false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Links every case to the next coarser case of the same plate (same w, h and boundary 
+//               conditions, fewer nodes), e.g. A-2 to A-1 and C-3 to C-1 through C-2, for the WARM_START
+//               setting
+// ARGUMENTS:    SD: the simulation data array
+//               NS: the number of simulations
+// RETURN VALUE: none
+void LinkCaseFamilies(SIMULATION_DATA* SD, int NS)
+{
+	int n, m;        // counters
+	size_t nNodes;   // nodes of case n
+
+	for (n = 0; n < NS; n++)
 	{
-		// reads each line of the input file
-		pRet = fgets(data, MAX_BUFF_SIZE, fin);
-		// first token of the line
-		tok = strtok_s(data, caseSeps, &nextToken); 
-		// stores the first token of the case name into the sim data array strCase variable
-		strcpy_s(SD[n].strCase, MAX_CASE_NAME_SIZE, tok);
-		// tokenizes the next string and stores it into tok
-		tok = strtok_s(NULL, caseSeps, &nextToken);
-		// takes the second token being the width and 
-		//converts the string into a double and stores into width variable
-		SD[n].w = strtod(tok, &pGarbage); 
-		// tokenizes the next string which is the height of the plate in the case
-		tok = strtok_s(NULL, caseSeps, &nextToken);
-		// converts the string into a double and stores 
-		//it into the height variable of the sim data array
-		SD[n].h = strtod(tok, &pGarbage); 
-		// tokenizes the third string dx
-		tok = strtok_s(NULL, caseSeps, &nextToken);
-		// converts the string into a double and stores the 
-		//dx value into the dx variable in sim data array
-		SD[n].dx = strtod(tok, &pGarbage); 
-		// tokenizes the final variable dy
-		tok = strtok_s(NULL, caseSeps, &nextToken); 
-		// converts the string into a double and stores the dy value 
-		//into the dy variable in sim data array
-		SD[n].dy = strtod(tok, &pGarbage);
-	}
-	// reads through each line of the input file
+		SD[n].iCoarser = -1;
+		nNodes = caseNodeCount(&SD[n]);
+		for (m = 0; m < NS; m++)
+		{
+			if (m == n || !isSamePlate(&SD[n], &SD[m]) || caseNodeCount(&SD[m]) >= nNodes) continue;
+			if (SD[n].iCoarser < 0 || caseNodeCount(&SD[m]) > caseNodeCount(&SD[SD[n].iCoarser])) SD[n].iCoarser = m;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Whether two cases describe the same plate and boundary conditions (the grids may differ)
+// ARGUMENTS:    A, B: the cases
+// RETURN VALUE: true if they do
+bool isSamePlate(const SIMULATION_DATA* A, const SIMULATION_DATA* B)
+{
+	int n; // wall counter
+
+	if (A->w != B->w || A->h != B->h) return false;
+	for (n = 0; n < NUM_WALLS; n++)
+	{
+		const BOUNDARY_CONDITION_DATA* a = &A->bc[n], * b = &B->bc[n];
+		if (a->nType != b->nType || a->Ta != b->Ta || a->Tb != b->Tb || a->za != b->za || a->zb != b->zb ||
+			a->ma != b->ma || a->mb != b->mb || a->k != b->k) return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Nested iteration: solves the coarser cases of the plate, coarsest first, each starting from
+//               the previous one interpolated onto its grid, and seeds the interior of G with the last of
+//               them.  The coarse cases are solved on private copies with their own solver settings and
+//               write no files.  For every level the RMS error against the analytical solution (when the
+//               case has one) and the RMS change from the previous level are kept for ReportWarmStart
+// ARGUMENTS:    G:  the grid of case iS (boundary conditions set)
+//               SD: the simulation data array
+//               iS: the case being seeded
+//               ws: returns the levels; ws->G is the finest coarse solution, freed by ReportWarmStart
+// RETURN VALUE: false if out of memory (G is then left as it was)
+bool WarmStart(PLATEGRID* G, const SIMULATION_DATA* SD, int iS, WARM_START* ws)
+{
+	int chain[MAX_WARM_LEVELS]; // coarser cases, finest first
+	int nChain = 0;             // number of coarser cases
+	int n, nStatus;             // counter, HTS code of a coarse solve
+	SIMULATION_DATA coarse;     // private copy of a coarse case, which may be running on another worker
+	SOLVE_INFO info;            // convergence of a coarse solve
+	PLATEGRID* C;               // grid of a coarse level
+	bool bOk = true;            // every level was solved
+
+	for (n = SD[iS].iCoarser; n >= 0 && nChain < MAX_WARM_LEVELS - 1; n = SD[n].iCoarser) chain[nChain++] = n;
+	while (nChain > 0)
+	{
+		coarse = SD[chain[--nChain]];
+		C = initialize(0, &coarse, NULL);
+		if (C == NULL)
+		{
+			bOk = false;
+			break;
+		}
+		C = SetBoundaryConditions(C, &coarse, 0);
+		if (ws->G != NULL) InterpolateGrid(ws->G, C, &coarse, SD[iS].solver.nWarmStart);
+		info = {};
+		nStatus = SolvePlate(C, &coarse, NULL, NULL, &info);
+		if (nStatus == HTS_ERROR_MEMORY)
+		{
+			FreeMemory(C, NULL);
+			bOk = false;
+			break;
+		}
+		ws->iCase[ws->nLevels] = chain[nChain];
+		ws->iter[ws->nLevels] = info.iter;
+		ws->hCell[ws->nLevels] = sqrt(coarse.dx * coarse.dy);
+		ws->errExact[ws->nLevels] = GetAnalyticalSolution(C, &coarse) ? gridErrorRMS(C, NULL, 0) : -1.0;
+		ws->errChange[ws->nLevels] = ws->G != NULL ? gridErrorRMS(C, ws->G, SD[iS].solver.nWarmStart) : -1.0;
+		ws->nLevels++;
+		FreeMemory(ws->G, NULL);
+		ws->G = C;
+	}
+	if (!bOk) // a level failed, start the case from T0 as usual
+	{
+		FreeMemory(ws->G, NULL);
+		ws->G = NULL;
+		ws->nLevels = 0;
+		return false;
+	}
+	InterpolateGrid(ws->G, G, &SD[iS], SD[iS].solver.nWarmStart);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Adds the solved case as the finest level and prints the levels of the warm start with the
+//               observed order of accuracy p = log(e_coarse / e_fine) / log(h_coarse / h_fine), h = sqrt(dx dy).
+//               e is the RMS error against the analytical solution when every level has one, otherwise the
+//               RMS change from the previous level (which needs three levels for an order).  An order is only
+//               printed where the coarser grid nests in the finer one (isNestedGrid).  Frees ws->G
+// ARGUMENTS:    G:  the solved grid of case iS (T_a filled if it has an analytical solution)
+//               SD: the simulation data array
+//               iS: the case
+//               bAnalytical: T_a holds the analytical solution
+//               ws: the coarse levels from WarmStart
+// RETURN VALUE: none
+void ReportWarmStart(const PLATEGRID* G, const SIMULATION_DATA* SD, int iS, bool bAnalytical, WARM_START* ws)
+{
+	bool bExact = bAnalytical;  // orders from the analytical error
+	double* e;                  // error measure of the levels
+	int n, L;                   // counters, the case's level
+
+	L = ws->nLevels++;
+	ws->iCase[L] = iS;
+	ws->iter[L] = -1; // already reported by GetNumericalSolution
+	ws->hCell[L] = sqrt(SD[iS].dx * SD[iS].dy);
+	ws->errExact[L] = bAnalytical ? gridErrorRMS(G, NULL, 0) : -1.0;
+	ws->errChange[L] = gridErrorRMS(G, ws->G, SD[iS].solver.nWarmStart);
+	FreeMemory(ws->G, NULL);
+	ws->G = NULL;
+	for (n = 0; n < L; n++) bExact = bExact && ws->errExact[n] >= 0.0;
+	e = bExact ? ws->errExact : ws->errChange;
+
+	reportf("\nWarm start (%s interpolation), %s:", SD[iS].solver.nWarmStart == WARM_START_BICUBIC ? "bicubic" : "bilinear",
+		bExact ? "RMS error against the analytical solution" : "RMS change from the coarser level");
+	reportf("\n  %-*s %9s %12s %11s %12s %7s", MAX_CASE_NAME_SIZE / 4, "case", "nodes", "h", "iterations", "error", "order");
+	for (n = 0; n <= L; n++)
+	{
+		const SIMULATION_DATA* S = &SD[ws->iCase[n]];
+		reportf("\n  %-*s %9zu %12.5le", MAX_CASE_NAME_SIZE / 4, S->strCase, caseNodeCount(S), ws->hCell[n]);
+		if (ws->iter[n] >= 0) reportf(" %11d", ws->iter[n]);
+		else reportf(" %11s", "(above)");
+		if (e[n] >= 0.0) reportf(" %12.5le", e[n]);
+		if (n > 0 && e[n - 1] > 0.0 && e[n] > 0.0 && ws->hCell[n - 1] != ws->hCell[n] &&
+			isNestedGrid(&SD[ws->iCase[n - 1]], S))
+			reportf(" %7.3lf", log(e[n - 1] / e[n]) / log(ws->hCell[n - 1] / ws->hCell[n]));
+	}
+	reportf("\n");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Sets the nodes of F that the solver updates (interior and insulated right wall) to the 
+//               solution on C interpolated to their positions; the boundary conditions of F are kept
+// ARGUMENTS:    C:       the coarse solution
+//               F:       the grid to seed (boundary conditions set)
+//               SD:      the simulation data of F
+//               nMethod: WARM_START_BILINEAR or WARM_START_BICUBIC
+// RETURN VALUE: none
+void InterpolateGrid(const PLATEGRID* C, PLATEGRID* F, const SIMULATION_DATA* SD, int nMethod)
+{
+	size_t iLast = SD->bc[RIGHT].nType == BC_TYPE_INSULATED ? F->I - 1 : F->I - 2; // last updated column
+	size_t i, j; // counters
+
+	for (j = 1; j < F->J - 1; j++)
+	{
+		for (i = 1; i <= iLast; i++) F->T_fd[gridIndex(F, i, j)] = sampleGrid(C, gridX(F, i), gridY(F, j), nMethod);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Interpolates T_fd of a grid at a point of the plate.  Bicubic uses Catmull-Rom weights on
+//               the 4 x 4 nearest nodes, with the node indices clamped at the edges
+// ARGUMENTS:    C:       the grid
+//               x, y:    the point
+//               nMethod: WARM_START_BILINEAR or WARM_START_BICUBIC
+// RETURN VALUE: the interpolated temperature
+double sampleGrid(const PLATEGRID* C, double x, double y, int nMethod)
+{
+	double fx = x / C->dx, fy = y / C->dy;  // position in cells
+	double tx, ty;                          // position inside the cell
+	double wx[4], wy[4];                    // weights of the columns and rows
+	double T = 0.0;                         // interpolated value
+	long i0, j0, a, b, ia, jb;              // cell, counters, clamped node
+	long I = (long)C->I, J = (long)C->J;    // nodes in x and y
+
+	i0 = (long)floor(fx);
+	j0 = (long)floor(fy);
+	if (i0 < 0) i0 = 0;
+	if (i0 > I - 2) i0 = I - 2;
+	if (j0 < 0) j0 = 0;
+	if (j0 > J - 2) j0 = J - 2;
+	tx = fx - (double)i0;
+	ty = fy - (double)j0;
+	if (nMethod != WARM_START_BICUBIC)
+	{
+		const double* T0row = C->T_fd + gridIndex(C, i0, j0), * T1row = T0row + C->stride;
+		return (1.0 - ty) * ((1.0 - tx) * T0row[0] + tx * T0row[1]) + ty * ((1.0 - tx) * T1row[0] + tx * T1row[1]);
+	}
+	// Catmull-Rom weights of nodes -1, 0, 1, 2 around the cell
+	wx[0] = ((-tx + 2.0) * tx - 1.0) * tx / 2.0;
+	wx[1] = ((3.0 * tx - 5.0) * tx * tx + 2.0) / 2.0;
+	wx[2] = ((-3.0 * tx + 4.0) * tx + 1.0) * tx / 2.0;
+	wx[3] = (tx - 1.0) * tx * tx / 2.0;
+	wy[0] = ((-ty + 2.0) * ty - 1.0) * ty / 2.0;
+	wy[1] = ((3.0 * ty - 5.0) * ty * ty + 2.0) / 2.0;
+	wy[2] = ((-3.0 * ty + 4.0) * ty + 1.0) * ty / 2.0;
+	wy[3] = (ty - 1.0) * ty * ty / 2.0;
+	for (b = 0; b < 4; b++)
+	{
+		jb = j0 - 1 + b;
+		if (jb < 0) jb = 0;
+		if (jb > J - 1) jb = J - 1;
+		for (a = 0; a < 4; a++)
+		{
+			ia = i0 - 1 + a;
+			if (ia < 0) ia = 0;
+			if (ia > I - 1) ia = I - 1;
+			T += wy[b] * wx[a] * C->T_fd[gridIndex(C, (size_t)ia, (size_t)jb)];
+		}
+	}
+	return T;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  RMS over the interior nodes of G of T_fd minus either T_a (C == NULL) or the solution on a
+//               coarser grid C interpolated to the nodes
+// ARGUMENTS:    G:       the grid
+//               C:       NULL, or the coarser grid
+//               nMethod: interpolation of C, WARM_START_BILINEAR or WARM_START_BICUBIC
+// RETURN VALUE: the RMS difference
+double gridErrorRMS(const PLATEGRID* G, const PLATEGRID* C, int nMethod)
+{
+	double d, sumSq = 0.0; // difference at a node, sum of squares
+	size_t i, j;           // counters
+
+	for (j = 1; j < G->J - 1; j++)
+	{
+		for (i = 1; i < G->I - 1; i++)
+		{
+			if (C == NULL) d = G->T_fd[gridIndex(G, i, j)] - G->T_a[gridIndex(G, i, j)];
+			else d = G->T_fd[gridIndex(G, i, j)] - sampleGrid(C, gridX(G, i), gridY(G, j), nMethod);
+			sumSq += d * d;
+		}
+	}
+	return sqrt(sumSq / (((double)G->I - 2) * ((double)G->J - 2)));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Whether every node of a coarser grid of the plate is also a node of a finer one, i.e. the
+//               cells of the fine grid divide those of the coarse grid in both directions.  Only then do
+//               the errors of the two grids measure the same discretisation at the same points
+// ARGUMENTS:    C: the coarser case
+//               F: the finer case of the same plate
+// RETURN VALUE: true if the grids nest
+bool isNestedGrid(const SIMULATION_DATA* C, const SIMULATION_DATA* F)
+{
+	int nxC = nint(C->w / C->dx), nyC = nint(C->h / C->dy); // cells of the coarse grid
+	int nxF = nint(F->w / F->dx), nyF = nint(F->h / F->dy); // cells of the fine grid
+
+	return nxC > 0 && nyC > 0 && nxF % nxC == 0 && nyF % nyC == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Headless batch mode.  The arguments name the cases to run: ALL, case names, or patterns
+//               with * and ? such as "C-*"; "-j n" sets the number of workers (default one per hardware
+//               thread, at most one per case).  The cases are dealt round-robin, largest grid first, onto
+//               one queue per worker; a worker whose queue runs dry steals from the tail of the others, so
+//               the long cases start first and the short ones fill in the gaps.  The console report of each
+//               case is printed as one block, every line tagged with the case name, once the case ends
+// ARGUMENTS:    SD:   the simulation data array
+//               NS:   the number of simulations
+//               argc: argument count
+//               argv: the arguments
+// RETURN VALUE: EXIT_SUCCESS if every case converged and was written, EXIT_FAILURE if one did not,
+//               EXIT_USAGE for bad arguments or when no case matches
+int RunBatch(SIMULATION_DATA* SD, int NS, int argc, char* argv[])
+{
+	BATCH_JOB job = {};          // arguments of the workers
+	THREAD_POOL* pool;           // the workers, the caller is worker 0
+	bool* bSelected;             // case was named on the command line
+	int* order;                  // selected cases, largest grid first
+	int* slots = NULL;           // storage of the queues
+	int nWorkers = (int)std::thread::hardware_concurrency(); // workers requested
+	int nCases = 0;              // number of selected cases
+	int n, m, a, t;              // counters, swap temporary
+	int nStatus = EXIT_SUCCESS;  // exit status
+	bool bMatched;               // the argument matched at least one case
+	char* pGarbage;              // end of the converted number
+
+	bSelected = (bool*)calloc(NS, sizeof(bool));
+	order = (int*)calloc(NS, sizeof(int));
+	job.status = (int*)calloc(NS, sizeof(int));
+	job.seconds = (double*)calloc(NS, sizeof(double));
+	if (bSelected == NULL || order == NULL || job.status == NULL || job.seconds == NULL)
+	{
+		free(bSelected);
+		free(order);
+		free(job.status);
+		free(job.seconds);
+		return EXIT_FAILURE;
+	}
+	for (a = 1; a < argc; a++)
+	{
+		if (strcmp(argv[a], "-j") == 0 && a + 1 < argc)
+		{
+			nWorkers = (int)strtol(argv[++a], &pGarbage, 10);
+			if (nWorkers < 1 || *pGarbage != '\0') nStatus = EXIT_USAGE;
+			continue;
+		}
+		bMatched = false;
+		for (n = 0; n < NS; n++)
+		{
+			if (_stricmp(argv[a], ALL_CASES) != 0 && !matchCasePattern(argv[a], SD[n].strCase)) continue;
+			bSelected[n] = bMatched = true;
+		}
+		if (!bMatched)
+		{
+			printf("\nNo case matches \"%s\"", argv[a]);
+			nStatus = EXIT_USAGE;
+		}
+	}
+	for (n = 0; n < NS; n++) if (bSelected[n]) order[nCases++] = n;
+	if (nCases == 0 || nStatus == EXIT_USAGE)
+	{
+		printf("\n%s\n", BATCH_USAGE);
+		free(bSelected);
+		free(order);
+		free(job.status);
+		free(job.seconds);
+		return EXIT_USAGE;
+	}
+
+	// largest grid first, so the longest solves are never the ones left running alone at the end
+	for (n = 1; n < nCases; n++)
+	{
+		for (m = n; m > 0 && caseNodeCount(&SD[order[m]]) > caseNodeCount(&SD[order[m - 1]]); m--)
+		{
+			t = order[m];
+			order[m] = order[m - 1];
+			order[m - 1] = t;
+		}
+	}
+	if (nWorkers > nCases) nWorkers = nCases;
+	if (nWorkers > MAX_THREADS) nWorkers = MAX_THREADS;
+	job.SD = SD;
+	job.queues = new (std::nothrow) CASE_QUEUE[nWorkers]();
+	slots = (int*)calloc((size_t)nWorkers * nCases, sizeof(int));
+	if (job.queues == NULL || slots == NULL) nWorkers = 0; // run everything on this thread below
+	for (n = 0; n < nWorkers; n++) job.queues[n].cases = slots + (size_t)n * nCases;
+	for (n = 0; n < nCases && nWorkers > 0; n++) // round-robin, so every queue starts with one of the largest
+	{
+		CASE_QUEUE* Q = &job.queues[n % nWorkers];
+		Q->cases[Q->tail++] = order[n];
+	}
+	printf("\nBatch: %d cases on %d workers\n", nCases, nWorkers > 0 ? nWorkers : 1);
+
+	job.W = CreateOutputWriter(); // one thread writes the files of every worker, NULL writes on the workers
+	pool = nWorkers > 0 ? CreateThreadPool(nWorkers) : NULL;
+	if (pool == NULL) // no memory for the queues or the pool
+	{
+		for (n = 0; n < nCases; n++) runBatchCase(&job, order[n]);
+	}
+	else
+	{
+		RunThreadPool(pool, batchCasesJob, &job);
+		FreeThreadPool(pool);
+	}
+	FreeOutputWriter(job.W); // every file is written and every status final
+
+	printf("\n\nBatch summary\n");
+	for (n = 0; n < nCases; n++)
+	{
+		m = order[n];
+		printf("  %-*s %9zu nodes  %10.3lf s  %s\n", MAX_CASE_NAME_SIZE / 4, SD[m].strCase, SD[m].I * SD[m].J,
+			job.seconds[m], job.status[m] == HTS_OK ? "converged" : hts_error_string(job.status[m]));
+		if (job.status[m] != HTS_ERROR_INTERRUPTED) printPhaseTimes(&SD[m]);
+		if (job.status[m] != HTS_OK) nStatus = EXIT_FAILURE;
+	}
+
+	free(slots);
+	delete[] job.queues;
+	free(bSelected);
+	free(order);
+	free(job.status);
+	free(job.seconds);
+	return nStatus;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Pool job of a batch run: runs the cases of this worker's queue from the head, then steals
+//               cases from the tail of the other queues until every queue is empty
+// ARGUMENTS:    pArgs:             the BATCH_JOB
+//               iThread, nThreads: this worker and the number of workers
+// RETURN VALUE: none
+void batchCasesJob(void* pArgs, int iThread, int nThreads)
+{
+	BATCH_JOB* job = (BATCH_JOB*)pArgs;
+	CASE_QUEUE* Q;    // queue a case is taken from
+	int iS, n;        // case to run, queue counter
+
+	while (true)
+	{
+		iS = -1;
+		for (n = 0; n < nThreads && iS < 0; n++) // own queue first, then the others in turn
+		{
+			Q = &job->queues[(iThread + n) % nThreads];
+			std::lock_guard<std::mutex> guard(Q->lock);
+			if (Q->head == Q->tail) continue;
+			iS = n == 0 ? Q->cases[Q->head++] : Q->cases[--Q->tail];
+		}
+		if (iS < 0) return; // cases are never added, so empty queues stay empty
+		runBatchCase(job, iS);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Runs one case of a batch run with its console report collected.  The report is printed as
+//               one block with every line tagged with the case name: by the output task of the case once the
+//               solution files are written (RunSimulation hands the report over), or here when the case
+//               stopped before it had files to write
+// ARGUMENTS:    job: the BATCH_JOB
+//               iS:  the case to run
+// RETURN VALUE: none
+void runBatchCase(BATCH_JOB* job, int iS)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // case timer
+
+	pCaseReport = new (std::nothrow) std::string(); // NULL prints directly
+	RunSimulation(job->SD, iS, job->W, &job->status[iS]);
+	job->seconds[iS] = secondsSince(start);
+	if (pCaseReport != NULL) // not handed to an output task
+	{
+		printCaseReport(job->SD[iS].strCase, pCaseReport);
+		delete pCaseReport;
+		pCaseReport = NULL;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  printf for the per-case report (GetNumericalSolution and what RunSimulation calls): appends
+//               to the batch report of the case running on this thread, or prints directly outside batch mode
+// ARGUMENTS:    format: printf format, followed by its values
+// RETURN VALUE: none
+void reportf(const char* format, ...)
+{
+	va_list args, copy;  // the values, a second pass over them
+	int n;               // characters the format expands to
+	size_t nOld;         // report length before them
+
+	va_start(args, format);
+	if (pCaseReport == NULL) vprintf(format, args);
+	else
+	{
+		va_copy(copy, args);
+		n = vsnprintf(NULL, 0, format, copy);
+		va_end(copy);
+		if (n > 0)
+		{
+			nOld = pCaseReport->size();
+			pCaseReport->resize(nOld + n + 1);
+			vsnprintf(&(*pCaseReport)[nOld], (size_t)n + 1, format, args);
+			pCaseReport->resize(nOld + n);
+		}
+	}
+	va_end(args);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Prints the report of a batch case as one block, each non-blank line prefixed with the case
+//               name.  The block goes out in a single fwrite, which the C runtime does not interleave with
+//               the output of other threads
+// ARGUMENTS:    strCase: the case name
+//               report:  what the case printed
+// RETURN VALUE: none
+void printCaseReport(const char* strCase, const std::string* report)
+{
+	std::string block;     // the tagged lines
+	size_t a = 0, b;       // start and end of a line
+
+	while (a < report->size())
+	{
+		b = report->find('\n', a);
+		if (b == std::string::npos) b = report->size();
+		if (report->find_first_not_of(" \t", a) < b)
+		{
+			block += "[";
+			block += strCase;
+			block += "] ";
+			block.append(*report, a, b - a);
+			block += "\n";
+		}
+		a = b + 1;
+	}
+	if (!block.empty())
+	{
+		fwrite(block.data(), 1, block.size(), stdout);
+		fflush(stdout);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Matches a case name against a pattern where * stands for any run of characters and ? for
+//               any one character
+// ARGUMENTS:    pattern: the pattern
+//               str:     the case name
+// RETURN VALUE: true if the whole name matches
+bool matchCasePattern(const char* pattern, const char* str)
+{
+	if (*pattern == '\0') return *str == '\0';
+	if (*pattern == '*') return matchCasePattern(pattern + 1, str) || (*str != '\0' && matchCasePattern(pattern, str + 1));
+	if (*str == '\0') return false;
+	if (*pattern != '?' && *pattern != *str) return false;
+	return matchCasePattern(pattern + 1, str + 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Number of grid nodes of a case, computed the same way as initialize does
+// ARGUMENTS:    SD: the simulation data for the case
+// RETURN VALUE: I * J
+size_t caseNodeCount(const SIMULATION_DATA* SD)
+{
+	return (size_t)nint((SD->w / SD->dx) + 1.0) * (size_t)nint((SD->h / SD->dy) + 1.0);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  This function reads from the input file to store the data uesd for the simulation
+// ARGUMENTS:    *SD: the SIMULATION_DATA array, 
+// RETURN VALUE: SD dynamic array, int NS
+//               NULL if the input file cannot be opened
+//               
+SIMULATION_DATA* GetSimulationData(SIMULATION_DATA* SD, int* NS)
+{
+	FILE* fin;                         // file input stream
+	errno_t err;                       // error stream
+	const char* caseSeps = " \t\n/";   // word delimiters
+	char data[MAX_BUFF_SIZE] = {};     // temporary storage array for the tokenized string
+	char* tok = NULL, * nextToken = NULL, * pRet = NULL, * pGarbage; // tok variables to tokenize
+	int n, i = 0;                      // counters
+	int N = 0; // int variable for NS
+	// opens the input file and checks to see if the file exists
+	err = fopen_s(&fin, SIMULATIONS_INPUT_DATA_FILE, "r"); 
+	if (err != 0 || fin == NULL) // checks to see if file exists
+	{
+		printf("Cannot open file :/"); 
+		*NS = 0;
+		return NULL; // main decides whether to wait for the user
+	}
+	// reads the input file per line until it reaches the sim data header or the dashes lines 
+	while (fgets(data, MAX_BUFF_SIZE, fin) != NULL) 
+	{
+		// if the current line read is the sim data header, it will skip past it and not do anything
+		if (strstr(data, SIMULATION_DATA_FILE_HEADER1) != NULL) continue; 
+		// if the current line read is the dashed lines, it will break out the loop 
+		if (strstr(data, DASHES) != NULL)break;
+	}
+	// continues to read through the document line by line
 	while (fgets(data, MAX_BUFF_SIZE, fin) != NULL) 
+	{
+		// checks to see if the current line is a blank line and if it is it will skip it
+		if (isBlankLine(data)) continue;
+		// checks to see if the current line is sim data header 2 and if it 
+		//is it will stop looping through each line
+		if (strstr(data, SIMULATION_DATA_FILE_HEADER2) != NULL) break;
+		// if the data array is not a NULL character, it will increment up after each line is read
+		if (data != NULL) N++;
+	}
+	*NS = N; // pointer NS is set to line counter N
+	printf("Number of cases = %d", *NS);
+	rewind(fin); // rewinds the document from the beginning to read and tokenize
+	// dynamically allocates memory for a sim data array 
+	//to store simulation data and intializes it all to 0
+	SD = (SIMULATION_DATA*)calloc(*NS, sizeof(SIMULATION_DATA));
+	if (SD == NULL) // if the array contains NULL, there is nothing to run
+	{
+		fclose(fin);
+		return NULL;
+	}
+	while (fgets(data, MAX_BUFF_SIZE, fin) != NULL) // reads through the input file line by line
+	{
+		// if the current line contains the sim data header string, it will skip
+		if (strstr(data, SIMULATION_DATA_FILE_HEADER1)) continue;
+		// if the current line contains dashes, it will break out of the loop
+		if (strstr(data, DASHES)) break; 
+	}
+	// looping through for total number of simulations
+	for (n = 0; n < *NS; n++)
+	{
+		// reads each line of the input file
+		pRet = fgets(data, MAX_BUFF_SIZE, fin);
+		// first token of the line
+		tok = strtok_s(data, caseSeps, &nextToken); 
+		// stores the first token of the case name into the sim data array strCase variable
+		strcpy_s(SD[n].strCase, MAX_CASE_NAME_SIZE, tok);
+		// tokenizes the next string and stores it into tok
+		tok = strtok_s(NULL, caseSeps, &nextToken);
+		// takes the second token being the width and 
+		//converts the string into a double and stores into width variable
+		SD[n].w = strtod(tok, &pGarbage); 
+		// tokenizes the next string which is the height of the plate in the case
+		tok = strtok_s(NULL, caseSeps, &nextToken);
+		// converts the string into a double and stores 
+		//it into the height variable of the sim data array
+		SD[n].h = strtod(tok, &pGarbage); 
+		// tokenizes the third string dx
+		tok = strtok_s(NULL, caseSeps, &nextToken);
+		// converts the string into a double and stores the 
+		//dx value into the dx variable in sim data array
+		SD[n].dx = strtod(tok, &pGarbage); 
+		// tokenizes the final variable dy
+		tok = strtok_s(NULL, caseSeps, &nextToken); 
+		// converts the string into a double and stores the dy value 
+		//into the dy variable in sim data array
+		SD[n].dy = strtod(tok, &pGarbage);
+	}
+	// reads through each line of the input file until every case has its walls
+	while (i < *NS && fgets(data, MAX_BUFF_SIZE, fin) != NULL) 
 	{
 		// reading through each line of input file
 		while (fgets(data, MAX_BUFF_SIZE, fin) != NULL) 
@@ -382,30 +1975,280 @@ SIMULATION_DATA* GetSimulationData(SIMULATION_DATA* SD, int* NS)
 }
 
 //-----------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  Prompts the user to make a selection based on which case they want to run the sim for 
-//               and stores the selection that they made for use in the SD array
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
-//               SD: the simulation data for case B
-// RETURN VALUE: iS: 
-int getUserSimulationChoice(SIMULATION_DATA* SD, int NS)
+// DESCRIPTION:  Reads the optional "Solver Settings" section at the end of the input file.  Each line is
+//               "<case> <KEY> <value>" where <case> is a case name or ALL, e.g. "A-2  SOLVER  SOR".
+//               Cases without settings keep plain Gauss-Seidel
+// ARGUMENTS:    SD: the simulation data array
+//               NS: the number of simulations
+// RETURN VALUE: none
+void GetSolverSettings(SIMULATION_DATA* SD, int NS)
 {
-	int n; // loop counter
-	bool bHasGarbage = false; // initilized boolean variable to false to check for garbage
-	int ret, iS; // return and sim index variables
+	FILE* fin;                                    // file input stream
+	errno_t err;                                  // error stream
+	const char* seps = " \t\r\n";                 // word delimiters
+	char data[MAX_BUFF_SIZE] = {};                // line buffer
+	char* tok, * key, * value, * nextToken = NULL; // case name, setting name and setting value
+	int n;                                        // counter
+	bool bFound = false;                          // true once the section header has been read
 
-	system("cls"); // clears screen for the menu to print
-	printHorizontalBorder(TL, TR); // prints the outside top border for the menu
-	printf("%c", VL); // prints left vertical line
-	printf("   %s   ", SIMULATION_CHOICE); // prints the simulation choice header
-	printf("%c\n", VL); // right vertical line
-	for (n = 0; n < NS; n++) drawStringLine(SD[n].strCase, n); // prints each simulation case choice
-	printHorizontalBorder(BL, BR); // bottom menu border
-	printf("\nSelect Simulation Case: "); // prompt to make simulation choice based on options 
-	ret = scanf_s("%d", &iS); // checks to see if the return is only 1
-	if (ret != 1) EXIT_FAILURE; // if the user enters more than one value, it won't work
-	if (iS != '\n') bHasGarbage = flushInputBuffer2(); // checks to see if the input is a garbage value
-	// if the user choice is greater than the total number of sims avaiable or less than 0, prompt to try again
-	if (iS > NS || iS <= 0) 
+	err = fopen_s(&fin, SIMULATIONS_INPUT_DATA_FILE, "r");
+	if (err != 0 || fin == NULL) return; // GetSimulationData has already reported this
+	while (fgets(data, MAX_BUFF_SIZE, fin) != NULL)
+	{
+		// skip everything up to the section header
+		if (!bFound)
+		{
+			bFound = strstr(data, SIMULATION_DATA_FILE_HEADER3) != NULL;
+			continue;
+		}
+		if (isBlankLine(data) || strstr(data, DASHES) != NULL) continue;
+		tok = strtok_s(data, seps, &nextToken);
+		key = strtok_s(NULL, seps, &nextToken);
+		value = strtok_s(NULL, seps, &nextToken);
+		if (tok == NULL || key == NULL || value == NULL || tok[0] == '/') continue; // comment or incomplete line
+		for (n = 0; n < NS; n++)
+		{
+			if (strcmp(tok, ALL_CASES) != 0 && strcmp(tok, SD[n].strCase) != 0) continue;
+			if (!setSolverOption(&SD[n].solver, key, value))
+			{
+				printf("\nUnknown solver setting \"%s %s\" ignored", key, value);
+				break;
+			}
+		}
+	}
+	fclose(fin);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Applies one solver setting
+// ARGUMENTS:    pSolver: the solver data of a case
+//               key:     setting name (SOLVER, OMEGA, PRECOND, THREADS, SIMD, RESIDUAL, TILE_SWEEPS, TILE_WIDTH,
+//                        OUTPUT, CHECKPOINT, CHECKPOINT_SECONDS, RESUME, WARM_START, CACHE, CACHE_MB,
+//                        MAX_ITERATIONS, PRECISION, LINES, PROCESSES, TRANSPORT, TRANSIENT, TIME_STEP,
+//                        DIFFUSIVITY, END_TIME, FRAME_TIME, ANALYTIC_TOLERANCE, AMR_LEVELS, AMR_TOLERANCE,
+//                        AMR_GRADIENT)
+//               value:   setting value; AMR_LEVELS takes 0 (uniform grid) to MAX_AMR_LEVELS, AMR_TOLERANCE and
+//                        AMR_GRADIENT take kelvin >= 0 (0 = AMR_TOLERANCE, and no gradient test)
+// RETURN VALUE: false if the setting is not recognised
+bool setSolverOption(SOLVER_DATA* pSolver, const char* key, const char* value)
+{
+	char* pGarbage; // end of the converted number
+
+	if (strcmp(key, "SOLVER") == 0)
+	{
+		int nSolver = solverTypetoInt(value);
+		if (nSolver < 0) return false;
+		pSolver->nSolver = nSolver;
+		return true;
+	}
+	else if (strcmp(key, "THREADS") == 0) // 0 = one per hardware thread
+	{
+		int nThreads = (int)strtol(value, &pGarbage, 10);
+		if (*pGarbage != '\0' || pGarbage == value) return false; // not a number, rather than "all cores"
+		if (nThreads == 0) nThreads = (int)std::thread::hardware_concurrency();
+		if (nThreads <= 0 || nThreads > MAX_THREADS) return false;
+		pSolver->nThreads = nThreads;
+		return true;
+	}
+	else if (strcmp(key, "SIMD") == 0) // upper limit for the stencil kernels
+	{
+		if (strcmp(value, "AUTO") == 0) pSolver->nSimd = SIMD_AUTO;
+		else if (strcmp(value, "SCALAR") == 0) pSolver->nSimd = SIMD_SCALAR;
+		else if (strcmp(value, "AVX2") == 0) pSolver->nSimd = SIMD_AVX2;
+		else if (strcmp(value, "AVX512") == 0) pSolver->nSimd = SIMD_AVX512;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "PRECISION") == 0) // DOUBLE = float64 sweeps, MIXED = float32 sweeps refined in float64
+	{
+		if (strcmp(value, "DOUBLE") == 0) pSolver->bMixed = false;
+		else if (strcmp(value, "MIXED") == 0) pSolver->bMixed = true;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "RESIDUAL") == 0) // FULL = separate residual pass, FUSED = from the GS/SOR update
+	{
+		if (strcmp(value, "FULL") == 0) pSolver->bFused = false;
+		else if (strcmp(value, "FUSED") == 0) pSolver->bFused = true;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "TILE_SWEEPS") == 0) // GS/SOR sweeps per cache-blocked wavefront pass
+	{
+		pSolver->nTileSweeps = (int)strtol(value, &pGarbage, 10);
+		return pSolver->nTileSweeps >= 0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "TILE_WIDTH") == 0) // columns per wavefront strip, 0 = whole rows
+	{
+		pSolver->nTileWidth = (int)strtol(value, &pGarbage, 10);
+		return pSolver->nTileWidth >= 0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "OUTPUT") == 0) // TEXT = .dat files, BINARY = Solution.hts, BOTH (default)
+	{
+		if (strcmp(value, "BOTH") == 0) pSolver->nOutput = OUTPUT_BOTH;
+		else if (strcmp(value, "TEXT") == 0) pSolver->nOutput = OUTPUT_TEXT;
+		else if (strcmp(value, "BINARY") == 0) pSolver->nOutput = OUTPUT_BINARY;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "CHECKPOINT") == 0) // snapshot every n iterations, 0 = none
+	{
+		pSolver->nCheckpointIter = (int)strtol(value, &pGarbage, 10);
+		return pSolver->nCheckpointIter >= 0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "CHECKPOINT_SECONDS") == 0) // snapshot every s seconds of wall time, 0 = none
+	{
+		pSolver->checkpointSeconds = strtod(value, &pGarbage);
+		return pSolver->checkpointSeconds >= 0.0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "RESUME") == 0) // YES = continue from the case's checkpoint file
+	{
+		if (strcmp(value, "YES") == 0) pSolver->bResume = true;
+		else if (strcmp(value, "NO") == 0) pSolver->bResume = false;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "WARM_START") == 0) // start from the coarser cases of the same plate
+	{
+		if (strcmp(value, "NONE") == 0) pSolver->nWarmStart = WARM_START_NONE;
+		else if (strcmp(value, "BILINEAR") == 0) pSolver->nWarmStart = WARM_START_BILINEAR;
+		else if (strcmp(value, "BICUBIC") == 0) pSolver->nWarmStart = WARM_START_BICUBIC;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "CACHE") == 0) // YES = reuse solutions of identical cases from SOLUTION_CACHE_DIR
+	{
+		if (strcmp(value, "YES") == 0) pSolver->bCache = true;
+		else if (strcmp(value, "NO") == 0) pSolver->bCache = false;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "CACHE_MB") == 0) // size limit of the solution cache
+	{
+		pSolver->nCacheMB = (int)strtol(value, &pGarbage, 10);
+		return pSolver->nCacheMB > 0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "MAX_ITERATIONS") == 0) // iteration limit of the solve, 0 = MAX_ITER
+	{
+		pSolver->nMaxIter = (int)strtol(value, &pGarbage, 10);
+		return pSolver->nMaxIter >= 0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "LINES") == 0) // SOLVER LINE: which lines are solved implicitly
+	{
+		if (strcmp(value, "AUTO") == 0) pSolver->nLines = LINES_AUTO;
+		else if (strcmp(value, "X") == 0) pSolver->nLines = LINES_X;
+		else if (strcmp(value, "Y") == 0) pSolver->nLines = LINES_Y;
+		else if (strcmp(value, "ALTERNATE") == 0) pSolver->nLines = LINES_ALTERNATE;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "PROCESSES") == 0) // SOLVER SOR: ranks of a decomposed solve, 0 = one per hardware thread
+	{
+		pSolver->nProcesses = (int)strtol(value, &pGarbage, 10);
+		if (pSolver->nProcesses == 0) pSolver->nProcesses = (int)std::thread::hardware_concurrency();
+		return pSolver->nProcesses > 0 && pSolver->nProcesses <= MAX_PROCESSES && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "TRANSPORT") == 0) // how the ranks of PROCESSES run: THREADS (default) or SHM (the program)
+	{
+#ifdef HTS_POSIX_SHM
+		if (strcmp(value, "SHM") == 0) pSolver->nTransport = TRANSPORT_SHM;
+		else
+#endif
+		if (strcmp(value, "THREADS") == 0) pSolver->nTransport = TRANSPORT_THREADS;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "TRANSIENT") == 0) // march in time from T0 before the steady solve
+	{
+		if (strcmp(value, "NONE") == 0) pSolver->nTransient = TRANSIENT_NONE;
+		else if (strcmp(value, "EULER") == 0) pSolver->nTransient = TRANSIENT_EULER;
+		else if (strcmp(value, "CN") == 0) pSolver->nTransient = TRANSIENT_CN;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "TIME_STEP") == 0) // first step of the march, 0 = TRANSIENT_FIRST_STEP
+	{
+		pSolver->timeStep = strtod(value, &pGarbage);
+		return pSolver->timeStep >= 0.0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "DIFFUSIVITY") == 0) // alpha in dT/dt = alpha laplacian(T), 0 = 1
+	{
+		pSolver->diffusivity = strtod(value, &pGarbage);
+		return pSolver->diffusivity >= 0.0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "END_TIME") == 0) // stop the march here instead of at steady state, 0 = never
+	{
+		pSolver->endTime = strtod(value, &pGarbage);
+		return pSolver->endTime >= 0.0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "FRAME_TIME") == 0) // time between frames of "<case> Transient.hts", 0 = none
+	{
+		pSolver->frameTime = strtod(value, &pGarbage);
+		return pSolver->frameTime >= 0.0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "AMR_LEVELS") == 0) // quadtree refinement from cells 2^n case cells wide, 0 = uniform grid
+	{
+		pSolver->nAmrLevels = (int)strtol(value, &pGarbage, 10);
+		return pSolver->nAmrLevels >= 0 && pSolver->nAmrLevels <= MAX_AMR_LEVELS && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "AMR_TOLERANCE") == 0) // error estimate a leaf may keep in K, 0 = AMR_TOLERANCE
+	{
+		pSolver->amrTolerance = strtod(value, &pGarbage);
+		return pSolver->amrTolerance >= 0.0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "AMR_GRADIENT") == 0) // temperature change across a leaf that splits it in K, 0 = none
+	{
+		pSolver->amrGradient = strtod(value, &pGarbage);
+		return pSolver->amrGradient >= 0.0 && *pGarbage == '\0';
+	}
+	else if (strcmp(key, "ANALYTIC_TOLERANCE") == 0) // series truncation relative to the first term, 0 = 1e-13
+	{
+		double tolerance = strtod(value, &pGarbage);
+		if (tolerance < 0.0 || tolerance >= 1.0 || *pGarbage != '\0') return false;
+		pSolver->analyticTolerance = tolerance;
+		return true;
+	}
+	else if (strcmp(key, "PRECOND") == 0)
+	{
+		if (strcmp(value, "JACOBI") == 0) pSolver->nPrecond = PRECOND_JACOBI;
+		else if (strcmp(value, "SGS") == 0) pSolver->nPrecond = PRECOND_SGS;
+		else if (strcmp(value, "IC") == 0) pSolver->nPrecond = PRECOND_IC;
+		else return false;
+		return true;
+	}
+	else if (strcmp(key, "OMEGA") == 0)
+	{
+		pSolver->omega = strtod(value, &pGarbage);
+		return pSolver->omega >= 0.0 && pSolver->omega < 2.0 && *pGarbage == '\0';
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Prompts the user to make a selection based on which case they want to run the sim for 
+//               and stores the selection that they made for use in the SD array
+// ARGUMENTS:    SD: the simulation data array
+//               NS: the number of simulations
+// RETURN VALUE: iS: 
+int getUserSimulationChoice(SIMULATION_DATA* SD, int NS)
+{
+	int n; // loop counter
+	bool bHasGarbage = false; // initilized boolean variable to false to check for garbage
+	int ret, iS; // return and sim index variables
+
+	system("cls"); // clears screen for the menu to print
+	printHorizontalBorder(TL, TR); // prints the outside top border for the menu
+	printf("%c", VL); // prints left vertical line
+	printf("   %s   ", SIMULATION_CHOICE); // prints the simulation choice header
+	printf("%c\n", VL); // right vertical line
+	for (n = 0; n < NS; n++) drawStringLine(SD[n].strCase, n); // prints each simulation case choice
+	printHorizontalBorder(BL, BR); // bottom menu border
+	printf("\nSelect Simulation Case: "); // prompt to make simulation choice based on options 
+	ret = scanf_s("%d", &iS); // checks to see if the return is only 1
+	if (ret != 1) EXIT_FAILURE; // if the user enters more than one value, it won't work
+	if (iS != '\n') bHasGarbage = flushInputBuffer2(); // checks to see if the input is a garbage value
+	// if the user choice is greater than the total number of sims avaiable or less than 0, prompt to try again
+	if (iS > NS || iS <= 0) 
 	{
 		printf("Try making another choice!"); // Message to try again
 		waitForEnterKey(); // holds the menu open until the ENTER key is pressed
@@ -414,59 +2257,66 @@ int getUserSimulationChoice(SIMULATION_DATA* SD, int NS)
 }
 
 //-----------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  Dynamically allocates the memory for each array and intializes to 0 for each element 
-//               and it intializes each x and y position of each node
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
-//               SD: the simulation data for case B
-// RETURN VALUE: PLATEPOINT P
-PLATEPOINT** initialize(int iS, SIMULATION_DATA* SD, PLATEPOINT** P)
+// DESCRIPTION:  Dynamically allocates one contiguous, cache-line aligned block for the T_a, T_fd and res 
+//               planes of the grid and intializes every element to 0.  x and y are not stored, they are 
+//               computed from the node indices with gridX/gridY
+// ARGUMENTS:    iS: the user simulation selection
+//               SD: the simulation data array (I and J are filled in here)
+//               G:  the plate grid (ignored, a new one is allocated)
+// RETURN VALUE: PLATEGRID G, NULL if the plate has no interior nodes or the memory cannot be allocated
+PLATEGRID* initialize(int iS, SIMULATION_DATA* SD, PLATEGRID* G)
 {
 	double  w = SD[iS].w;//auxiliary variables for simulation data variables
 	double dx = SD[iS].dx;
 	double  h = SD[iS].h;
 	double dy = SD[iS].dy;
-	size_t n, i, j;
+	size_t planeSize;       // number of doubles in one padded plane
+	size_t rowAlign = GRID_ALIGNMENT / sizeof(double); // doubles per cache line
+	uintptr_t base;         // address of the raw block, rounded up to the alignment
 	//calculating the number of nodes in I and J
 	SD[iS].I = nint((w / dx) + 1.0);
 	SD[iS].J = nint((h / dy) + 1.0);
 	//assigning I and J variables
 	size_t I = SD[iS].I;
 	size_t J = SD[iS].J;
-	//1D PLATEPOINT array is allocated for size of I
-	P = (PLATEPOINT**)calloc(I, sizeof(PLATEPOINT*));
-	//If P is NULL exit the program
-	if (P == NULL) exit(0);
-	//allocate a 2D PLATEPOINT array
-	for (i = 0; i < I; i++)
-	{
-		//allocate a 2D PLATEPOINT array for size of J
-		P[i] = (PLATEPOINT*)calloc(J, sizeof(PLATEPOINT));
-		//If P is NULL exit the program
-		if (P == NULL) exit(0);
-	}
-	//If I or J are 0 exit the program
-	if (I == 0 || J == 0) exit(0);
-	//loop both i and j for the sizes I and J
-	for (i = 0; i < I; i++)
+	//If there are no interior nodes there is nothing to solve
+	if (I < 3 || J < 3) return NULL;
+	//allocate the grid descriptor
+	G = (PLATEGRID*)calloc(1, sizeof(PLATEGRID));
+	//If G is NULL report it to the caller
+	if (G == NULL) return NULL;
+	G->I = I;
+	G->J = J;
+	G->dx = dx;
+	G->dy = dy;
+	//pad each row to a whole cache line so every row starts aligned
+	G->stride = (I + rowAlign - 1) / rowAlign * rowAlign;
+	planeSize = G->stride * J;
+	//one zeroed block for all three planes, plus slack to align the first one
+	G->block = calloc(3 * planeSize * sizeof(double) + GRID_ALIGNMENT, 1);
+	//If the block is NULL report it to the caller
+	if (G->block == NULL)
 	{
-		for (j = 0; j < J; j++)
-		{	//initialize x and y for the sizes dx and dy
-			P[i][j].x = (double)i * dx;
-			P[i][j].y = (double)j * dy;
-		}
+		free(G);
+		return NULL;
 	}
+	base = ((uintptr_t)G->block + GRID_ALIGNMENT - 1) & ~(uintptr_t)(GRID_ALIGNMENT - 1);
+	//the planes follow each other inside the block
+	G->T_fd = (double*)base;
+	G->T_a = G->T_fd + planeSize;
+	G->res = G->T_a + planeSize;
 
-	return P;
+	return G;
 }
 
 //-----------------------------------------------------------------------------------------------------------
 // DESCRIPTION:  Sets the boundary conditions for each case type depending on the users selection 
 //               Sets Temps, za, zb, k, and other variables depending on which case type it is
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
+// ARGUMENTS:    G:  the plate grid
 //               iS: the user simulation selection
 //               SD: the simulation data for the selected case
-// RETURN VALUE: P
-PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
+// RETURN VALUE: G
+PLATEGRID* SetBoundaryConditions(PLATEGRID* G, SIMULATION_DATA* SD, int iS)
 {
 	size_t n, i = 0, j = 0; // counter variables
 	size_t I = SD[iS].I, J = SD[iS].J; // auxilary variables for total number of nodes I and J
@@ -493,18 +2343,18 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current x is less than the xa or greater than the xb 
 					//values based on the case, it will set the temp of the node = 0
-					if (P[i][J - 1].x <= xa || P[i][J - 1].x >= xb)
+					if (gridX(G, i) <= xa || gridX(G, i) >= xb)
 					{
 						T = 0;
 						// setting both T_fd and T_a to equal the temp T
-						P[i][J - 1].T_a = T;
-						P[i][J - 1].T_fd = T;
+						G->T_a[gridIndex(G, i, J - 1)] = T;
+						G->T_fd[gridIndex(G, i, J - 1)] = T;
 					}
-					if (P[i][J - 1].x >= xa && P[i][J - 1].x <= xb)
+					if (gridX(G, i) >= xa && gridX(G, i) <= xb)
 					{
 						// sets both T_a and T_fd to the temperature of that case
-						P[i][J - 1].T_a = Tc;
-						P[i][J - 1].T_fd = P[i][J - 1].T_a;
+						G->T_a[gridIndex(G, i, J - 1)] = Tc;
+						G->T_fd[gridIndex(G, i, J - 1)] = G->T_a[gridIndex(G, i, J - 1)];
 					}
 				}
 			}
@@ -518,22 +2368,22 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				// looping through each node to set the conditions
 				for (i = 0; i < I; i++)
 				{
-					double T = P[i][0].T_fd;
+					double T = G->T_fd[gridIndex(G, i, 0)];
 
 					// if the current x is less than the xa or greater than the xb 
 					//values based on the case, it will set the temp of the node = 0
-					if (P[i][0].x <= xa || P[i][0].x >= xb)
+					if (gridX(G, i) <= xa || gridX(G, i) >= xb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[i][0].T_a = T;
-						P[i][0].T_fd = T;
+						G->T_a[gridIndex(G, i, 0)] = T;
+						G->T_fd[gridIndex(G, i, 0)] = T;
 					}
-					if (P[i][0].x >= xa && P[i][0].x <= xb)
+					if (gridX(G, i) >= xa && gridX(G, i) <= xb)
 					{
 						// sets both T_a and T_fd to the temperature of that case
-						P[i][0].T_a = Tc;
-						P[i][0].T_fd = P[i][0].T_a;
+						G->T_a[gridIndex(G, i, 0)] = Tc;
+						G->T_fd[gridIndex(G, i, 0)] = G->T_a[gridIndex(G, i, 0)];
 					}
 				}
 			}
@@ -547,21 +2397,21 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				// looping through the J nodes for the j direction to set the temps
 				for (j = 0; j < J; j++)
 				{
-					double T = P[0][j].T_fd;
+					double T = G->T_fd[gridIndex(G, 0, j)];
 					// if the current y is less than the ya or greater than the yb 
 					//values based on the case, it will set the temp of the node = 0
-					if (P[0][j].y <= ya || P[0][j].y >= yb)
+					if (gridY(G, j) <= ya || gridY(G, j) >= yb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[0][j].T_a = T;
-						P[0][j].T_fd = T;
+						G->T_a[gridIndex(G, 0, j)] = T;
+						G->T_fd[gridIndex(G, 0, j)] = T;
 					}
-					if (P[0][j].y >= ya && P[0][j].y <= yb)
+					if (gridY(G, j) >= ya && gridY(G, j) <= yb)
 					{
 						// sets both T_a and T_fd to the temperature of that case
-						P[0][j].T_a = Tc;
-						P[0][j].T_fd = P[0][j].T_a;
+						G->T_a[gridIndex(G, 0, j)] = Tc;
+						G->T_fd[gridIndex(G, 0, j)] = G->T_a[gridIndex(G, 0, j)];
 					}
 				}
 			}
@@ -575,22 +2425,22 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				// looping through the J nodes for the j direction to set the temps
 				for (j = 0; j < J; j++)
 				{
-					double T = P[I - 1][j].T_fd;
+					double T = G->T_fd[gridIndex(G, I - 1, j)];
 
 					// if the current y is less than the ya or greater than the yb 
 					//values based on the case, it will set the temp of the node = 0
-					if (P[I - 1][j].y <= ya || P[0][j].y >= yb)
+					if (gridY(G, j) <= ya || gridY(G, j) >= yb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[I - 1][j].T_a = T;
-						P[I - 1][j].T_fd = T;
+						G->T_a[gridIndex(G, I - 1, j)] = T;
+						G->T_fd[gridIndex(G, I - 1, j)] = T;
 					}
-					if (P[I - 1][j].y >= ya && P[0][j].y <= yb)
+					if (gridY(G, j) >= ya && gridY(G, j) <= yb)
 					{
 						// sets both T_a and T_fd to the temperature of that case
-						P[I - 1][j].T_a = Tc;
-						P[I - 1][j].T_fd = Tc;
+						G->T_a[gridIndex(G, I - 1, j)] = Tc;
+						G->T_fd[gridIndex(G, I - 1, j)] = Tc;
 					}
 				}
 			}
@@ -610,20 +2460,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current x is less than the xa or greater than the xb 
 					//values based on the case, it will set the temp of the node = 0
-					if (P[i][J - 1].x <= xa || P[i][J - 1].x >= xb)
+					if (gridX(G, i) <= xa || gridX(G, i) >= xb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[i][J - 1].T_a = T;
-						P[i][J - 1].T_fd = T;
+						G->T_a[gridIndex(G, i, J - 1)] = T;
+						G->T_fd[gridIndex(G, i, J - 1)] = T;
 					}
-					if(P[i][J - 1].x >= xa && P[i][J - 1].x <= xb)
+					if(gridX(G, i) >= xa && gridX(G, i) <= xb)
 					{
 						// uses the cosine function to calculate the temps 
 						//and sets the nodes to that temp for T_fd and T_a
-						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((P[i][J - 1].x - xa) / (xb - xa))));
-						P[i][J - 1].T_a = T;
-						P[i][J - 1].T_fd = T;
+						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((gridX(G, i) - xa) / (xb - xa))));
+						G->T_a[gridIndex(G, i, J - 1)] = T;
+						G->T_fd[gridIndex(G, i, J - 1)] = T;
 					}
 				}
 			}
@@ -640,20 +2490,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current x is less than the xa or greater than the xb 
 					//values based on the case, it will set the temp of the node = 0
-					if (P[i][0].x <= xa || P[i][0].x >= xb)
+					if (gridX(G, i) <= xa || gridX(G, i) >= xb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[i][0].T_a = T;
-						P[i][0].T_fd = T;
+						G->T_a[gridIndex(G, i, 0)] = T;
+						G->T_fd[gridIndex(G, i, 0)] = T;
 					}
-					if (P[i][0].x >= xa && P[i][0].x <= xb)
+					if (gridX(G, i) >= xa && gridX(G, i) <= xb)
 					{
 						// uses the cosine function to calculate the temps and 
 						//sets the nodes to that temp for T_fd and T_a
-						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((P[i][0].x - xa) / (xb - xa))));
-						P[i][0].T_a = T;
-						P[i][0].T_fd = T;
+						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((gridX(G, i) - xa) / (xb - xa))));
+						G->T_a[gridIndex(G, i, 0)] = T;
+						G->T_fd[gridIndex(G, i, 0)] = T;
 					}
 				}
 			}
@@ -670,20 +2520,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current y is less than the ya or greater than the yb 
 					//values based on the case, it will set the temp of the node = 0
-					if (P[0][j].y <= ya || P[0][j].y >= yb)
+					if (gridY(G, j) <= ya || gridY(G, j) >= yb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[0][j].T_a = T;
-						P[0][j].T_fd = T;
+						G->T_a[gridIndex(G, 0, j)] = T;
+						G->T_fd[gridIndex(G, 0, j)] = T;
 					}
-					if (P[0][j].y >= ya && P[0][j].y <= yb)
+					if (gridY(G, j) >= ya && gridY(G, j) <= yb)
 					{
 						// uses the cosine function to calculate the temps and sets 
 						//the nodes to that temp for T_fd and T_a
-						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((P[0][j].y - ya) / (yb - ya))));
-						P[0][j].T_a = T;
-						P[0][j].T_fd = P[0][j].T_a;
+						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((gridY(G, j) - ya) / (yb - ya))));
+						G->T_a[gridIndex(G, 0, j)] = T;
+						G->T_fd[gridIndex(G, 0, j)] = G->T_a[gridIndex(G, 0, j)];
 					}
 				}
 			}
@@ -700,20 +2550,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current y is less than the ya or greater than the yb values 
 					//based on the case, it will set the temp of the node = 0
-					if (P[I - 1][j].y <= ya || P[I - 1][j].y >= yb)
+					if (gridY(G, j) <= ya || gridY(G, j) >= yb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[I - 1][j].T_a = T;
-						P[I - 1][j].T_fd = T;
+						G->T_a[gridIndex(G, I - 1, j)] = T;
+						G->T_fd[gridIndex(G, I - 1, j)] = T;
 					}
-					if (P[I - 1][j].y >= ya && P[I - 1][j].y <= yb)
+					if (gridY(G, j) >= ya && gridY(G, j) <= yb)
 					{
 						// uses the cosine function to calculate the temps and sets the nodes 
 						//to that temp for T_fd and T_a
-						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((P[I - 1][j].y - ya) / (yb - ya))));
-						P[I - 1][j].T_a = T;
-						P[I - 1][j].T_fd = T;
+						T = (Tm / 2.0) * (1.0 - cos(2.0 * PI * ((gridY(G, j) - ya) / (yb - ya))));
+						G->T_a[gridIndex(G, I - 1, j)] = T;
+						G->T_fd[gridIndex(G, I - 1, j)] = T;
 					}
 				}
 			}
@@ -727,8 +2577,8 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 			{
 				// setting both T_fd and T_a to equal the temp T
 				T = 0;
-				P[I - 1][j].T_a = T;
-				P[I - 1][j].T_fd = T;
+				G->T_a[gridIndex(G, I - 1, j)] = T;
+				G->T_fd[gridIndex(G, I - 1, j)] = T;
 			}
 		}
 		else if (SD[iS].bc[n].nType == BC_TYPE_POLY) // if the wall type is type poly
@@ -756,20 +2606,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current phi is less than the ya or greater than the yb values 
 					//based on the case, it will set the temp of the node = 0
-					double phi = (P[i][J - 1].x - xa) / del;
+					double phi = (gridX(G, i) - xa) / del;
 					if (phi >= 0.0 && phi <= 1.0)
 					{
 						// calculates the temp of each node using a polynomial equation
 						T = a + b * phi + c * phi * phi + d * phi * phi * phi;
-						P[i][J - 1].T_a = T;
-						P[i][J - 1].T_fd = T;
+						G->T_a[gridIndex(G, i, J - 1)] = T;
+						G->T_fd[gridIndex(G, i, J - 1)] = T;
 					}
 					if (phi <= 0.0 || phi >= 1.0)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[i][J - 1].T_a = T;
-						P[i][J - 1].T_fd = T;
+						G->T_a[gridIndex(G, i, J - 1)] = T;
+						G->T_fd[gridIndex(G, i, J - 1)] = T;
 					}
 				}
 			}
@@ -790,20 +2640,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current phi is less than the ya or greater than the yb 
 					//values based on the case, it will set the temp of the node = 0
-					double phi = (P[i][0].x - xa) / del;
+					double phi = (gridX(G, i) - xa) / del;
 					if (phi >= 0.0 && phi <= 1.0)
 					{
 						// calculates the temp of each node using a polynomial equation
 						T = a + b * phi + c * phi * phi + d * phi * phi * phi;
-						P[i][0].T_a = T;
-						P[i][0].T_fd = T;
+						G->T_a[gridIndex(G, i, 0)] = T;
+						G->T_fd[gridIndex(G, i, 0)] = T;
 					}
 					if (phi <= 0.0 || phi >= 1.0)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[i][0].T_a = T;
-						P[i][0].T_fd = T;
+						G->T_a[gridIndex(G, i, 0)] = T;
+						G->T_fd[gridIndex(G, i, 0)] = T;
 					}
 				}
 			}
@@ -824,20 +2674,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current phi is less than the ya or greater than the yb 
 					//values based on the case, it will set the temp of the node = 0
-					double phi = (P[i][0].y - ya) / del;
+					double phi = (gridY(G, j) - ya) / del;
 					if (phi >= 0.0 && phi <= 1.0)
 					{
 						// calculates the temp of each node using a polynomial equation
 						T = a + b * phi + c * phi * phi + d * phi * phi * phi;
-						P[0][j].T_a = T;
-						P[0][j].T_fd = T;
+						G->T_a[gridIndex(G, 0, j)] = T;
+						G->T_fd[gridIndex(G, 0, j)] = T;
 					}
 					if (phi <= 0.0 || phi >= 1.0)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[0][j].T_a = T;
-						P[0][j].T_fd = T;
+						G->T_a[gridIndex(G, 0, j)] = T;
+						G->T_fd[gridIndex(G, 0, j)] = T;
 					}
 				}
 			}
@@ -858,20 +2708,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				{
 					// if the current phi is less than the ya or greater than the yb 
 					//values based on the case, it will set the temp of the node = 0
-					double phi = (P[i][J - 1].y - ya) / del;
+					double phi = (gridY(G, j) - ya) / del;
 					if (phi >= 0.0 && phi <= 1.0)
 					{
 						// calculates the temp of each node using a polynomial equation
 						T = a + b * phi + c * phi * phi + d * phi * phi * phi;
-						P[I - 1][j].T_a = T;
-						P[I - 1][j].T_fd = T;
+						G->T_a[gridIndex(G, I - 1, j)] = T;
+						G->T_fd[gridIndex(G, I - 1, j)] = T;
 					}
 					if (phi <= 0.0 || phi >= 1.0)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[I - 1][j].T_a = T;
-						P[I - 1][j].T_fd = T;
+						G->T_a[gridIndex(G, I - 1, j)] = T;
+						G->T_fd[gridIndex(G, I - 1, j)] = T;
 					}
 				}
 			}
@@ -890,20 +2740,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				for (i = 0; i < I; i++)
 				{
 					// checks to see if the current x value is greater than xb or less than xa
-					if (P[i][J - 1].x <= xa || P[i][J - 1].x >= xb)
+					if (gridX(G, i) <= xa || gridX(G, i) >= xb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[i][J - 1].T_a = T;
-						P[i][J - 1].T_fd = T;
+						G->T_a[gridIndex(G, i, J - 1)] = T;
+						G->T_fd[gridIndex(G, i, J - 1)] = T;
 					}
-					if (P[i][J - 1].x >= xa && P[i][J - 1].x <= xb)
+					if (gridX(G, i) >= xa && gridX(G, i) <= xb)
 					{
 						// uses the sinusoidal function to calculate the temps and 
 						//sets the nodes to that temp for T_fd and T_a
-						T = Ta * sin(k * PI * ((P[i][j].x - xa) / (xb - xa)));
-						P[i][J - 1].T_a = T;
-						P[i][J - 1].T_fd = T;
+						T = Ta * sin(k * PI * ((gridX(G, i) - xa) / (xb - xa)));
+						G->T_a[gridIndex(G, i, J - 1)] = T;
+						G->T_fd[gridIndex(G, i, J - 1)] = T;
 					}
 				}
 			}
@@ -919,20 +2769,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				for (i = 0; i < I; i++)
 				{
 					// checks to see if the current x value is greater than xb or less than xa
-					if (P[i][0].x <= xa || P[i][0].x >= xb)
+					if (gridX(G, i) <= xa || gridX(G, i) >= xb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[i][0].T_a = T;
-						P[i][0].T_fd = T;
+						G->T_a[gridIndex(G, i, 0)] = T;
+						G->T_fd[gridIndex(G, i, 0)] = T;
 					}
-					if (P[i][0].x >= xa && P[i][0].x <= xb)
+					if (gridX(G, i) >= xa && gridX(G, i) <= xb)
 					{
 						// uses the sinusoidal function to calculate the temps and sets the 
 						//nodes to that temp for T_fd and T_a
-						T = Ta * sin(k * PI * ((P[i][0].x - xa) / (xb - xa)));
-						P[i][0].T_a = T;
-						P[i][0].T_fd = T;
+						T = Ta * sin(k * PI * ((gridX(G, i) - xa) / (xb - xa)));
+						G->T_a[gridIndex(G, i, 0)] = T;
+						G->T_fd[gridIndex(G, i, 0)] = T;
 					}
 				}
 			}
@@ -949,20 +2799,20 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				for (j = 0; j < J; j++)
 				{
 					// checks to see if the current y value is greater than yb or less than ya
-					if (P[0][j].y <= ya || P[0][j].y >= yb)
+					if (gridY(G, j) <= ya || gridY(G, j) >= yb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[0][j].T_a = T;
-						P[0][j].T_fd = T;
+						G->T_a[gridIndex(G, 0, j)] = T;
+						G->T_fd[gridIndex(G, 0, j)] = T;
 					}
-					if (P[0][j].y >= ya && P[0][j].y <= yb)
+					if (gridY(G, j) >= ya && gridY(G, j) <= yb)
 					{
 						// uses the sinusoidal function to calculate the temps 
 						//and sets the nodes to that temp for T_fd and T_a
-						T = Ta * sin(k * PI * ((P[0][j].y - ya) / (yb - ya)));
-						P[0][j].T_a = T;
-						P[0][J].T_fd = T;
+						T = Ta * sin(k * PI * ((gridY(G, j) - ya) / (yb - ya)));
+						G->T_a[gridIndex(G, 0, j)] = T;
+						G->T_fd[gridIndex(G, 0, j)] = T;
 					}
 				}
 			}
@@ -979,252 +2829,4838 @@ PLATEPOINT** SetBoundaryConditions(PLATEPOINT** P, SIMULATION_DATA* SD, int iS)
 				for (j = 0; j < J; j++)
 				{
 					// checks to see if the current y value is greater than yb or less than ya
-					if (P[I - 1][j].y <= ya || P[I - 1][j].y >= yb)
+					if (gridY(G, j) <= ya || gridY(G, j) >= yb)
 					{
 						// setting both T_fd and T_a to equal the temp T
 						T = 0;
-						P[I - 1][j].T_a = T;
-						P[I - 1][j].T_fd = T;
+						G->T_a[gridIndex(G, I - 1, j)] = T;
+						G->T_fd[gridIndex(G, I - 1, j)] = T;
 					}
-					if (P[I - 1][j].y >= ya && P[I - 1][j].y <= yb)
+					if (gridY(G, j) >= ya && gridY(G, j) <= yb)
 					{
 						// uses the sinusoidal function to calculate the temps and sets 
 						//the nodes to that temp for T_fd and T_a
-						T = Ta * sin(k * PI * ((P[I - 1][j].y - ya) / (yb - ya)));
-						P[I - 1][j].T_a = T;
-						P[I - 1][j].T_fd = T;
+						T = Ta * sin(k * PI * ((gridY(G, j) - ya) / (yb - ya)));
+						G->T_a[gridIndex(G, I - 1, j)] = T;
+						G->T_fd[gridIndex(G, I - 1, j)] = T;
 					}
 				}
 			}
 		}
 	}
 	// calculates the average temparture of the top left node
-	P[0][J - 1].T_a = (P[0][J - 2].T_a + P[1][J - 1].T_a) / 2;
-	P[0][J - 1].T_fd = P[0][J - 1].T_a;
+	G->T_a[gridIndex(G, 0, J - 1)] = (G->T_a[gridIndex(G, 0, J - 2)] + G->T_a[gridIndex(G, 1, J - 1)]) / 2;
+	G->T_fd[gridIndex(G, 0, J - 1)] = G->T_a[gridIndex(G, 0, J - 1)];
 
 	// calculates the average temperature of the bottom left node
-	P[0][0].T_a = (P[0][1].T_a + P[1][0].T_a) / 2.0;
-	P[0][0].T_fd = P[0][0].T_a;
+	G->T_a[gridIndex(G, 0, 0)] = (G->T_a[gridIndex(G, 0, 1)] + G->T_a[gridIndex(G, 1, 0)]) / 2.0;
+	G->T_fd[gridIndex(G, 0, 0)] = G->T_a[gridIndex(G, 0, 0)];
 	// if the case is insulated, it won't take the average temperature of the top right node
 	if (SD[iS].bc[RIGHT].nType != BC_TYPE_INSULATED)
 	{
 		// top right node
-		P[I - 1][J - 1].T_a = (P[I - 2][J - 1].T_a + P[I - 1][J - 2].T_a) / 2.0;
-		P[I - 1][J - 1].T_fd = P[I - 1][J - 1].T_a;
+		G->T_a[gridIndex(G, I - 1, J - 1)] = (G->T_a[gridIndex(G, I - 2, J - 1)] + G->T_a[gridIndex(G, I - 1, J - 2)]) / 2.0;
+		G->T_fd[gridIndex(G, I - 1, J - 1)] = G->T_a[gridIndex(G, I - 1, J - 1)];
+
+		// bottom right node
+		G->T_a[gridIndex(G, I - 1, 0)] = (G->T_a[gridIndex(G, I - 2, 0)] + G->T_a[gridIndex(G, I - 1, 1)]) / 2.0;
+		G->T_fd[gridIndex(G, I - 1, 0)] = G->T_a[gridIndex(G, I - 1, 0)];
+	}
+
+	return G;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Uses Finite-difference method to numerically solve for the temperature of each node 
+//               Cycles through each node and finds the temperature based on the average of neighbouring nodes
+//               Writes "<case> convergence.dat" and reports the solver and its convergence on the console.
+//               With RESUME YES the solve continues from "<case> checkpoint.hts" (its history is written to
+//               the convergence file first); the checkpoint is removed once the case converges.  With
+//               TRANSIENT the plate is marched in time first (SolveTransient, frames to "<case> Transient.hts");
+//               the solver finishes from the settled field, or at END_TIME the field of that time is kept
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for the selected case
+//               W:  the output thread for the convergence records, NULL to write them on this thread
+// RETURN VALUE: HTS_OK, HTS_ERROR_NOT_CONVERGED if MAX_ITER was reached, HTS_ERROR_FILE if the 
+//               convergence file cannot be opened, HTS_ERROR_MEMORY, HTS_ERROR_INTERRUPTED
+int GetNumericalSolution(PLATEGRID* G, const SIMULATION_DATA SD, OUTPUT_WRITER* W)
+{
+	FILE* fConverge = NULL;
+	CONVERGENCE_LOG log = {}; // batches the records for the output thread
+	CHECKPOINT ck = {};       // snapshots and resume state
+	size_t n;                 // counter
+	errno_t err;
+	char strConvergenceFile[MAX_BUFF_SIZE]; // convergence file string name
+	char strFrameFile[MAX_BUFF_SIZE]; // frame file of a transient march
+	SOLVE_INFO info = {}; // solver details and convergence
+	TRANSIENT_INFO tinfo = {}; // the march before the solve
+	int nStatus; // HTS return code of the solve
+
+	sprintf_s(strConvergenceFile, MAX_BUFF_SIZE, "%s convergence.dat", SD.strCase);
+	err = fopen_s(&fConverge, strConvergenceFile, "w");
+	if (err != 0 || fConverge == NULL)
+	{
+		reportf("Cannot open \"%s\" for writing...", strConvergenceFile);
+		return HTS_ERROR_FILE;
+	}
+
+	log.W = W;
+	log.f = fConverge;
+	sprintf_s(ck.strFile, MAX_BUFF_SIZE, "%s checkpoint.hts", SD.strCase);
+	ck.nInterval = SD.solver.nCheckpointIter;
+	ck.seconds = SD.solver.checkpointSeconds;
+	ck.lastSave = std::chrono::steady_clock::now();
+	ck.bKeepHistory = SD.solver.bCache;
+	if (SD.solver.bCache && LoadCachedSolution(G, &SD, &log, &info))
+	{
+		closeConvergenceLog(&log);
+		reportf("\nLoaded from the solution cache\n");
+		reportf("\nNumber of iterations: %d", info.iter);
+		reportf("\nRmax = %.5le", info.rmax);
+		reportf("\nRMS = %.5le\n\n", info.RMS);
+		reportf("\nPrinted data to file \"%s\n", strConvergenceFile);
+		return info.bConverged ? HTS_OK : HTS_ERROR_NOT_CONVERGED;
+	}
+	if (SD.solver.bResume && LoadCheckpoint(G, &SD, &ck))
+	{
+		reportf("\nResuming \"%s\" from \"%s\" at iteration %d", SD.strCase, ck.strFile, ck.iterStart);
+		for (n = 0; n < ck.nRecords; n++)
+			logConvergence(&log, ck.records[n].rmax, ck.records[n].RMS, ck.records[n].seconds, ck.records[n].iter);
+	}
+	if (SD.solver.nTransient != TRANSIENT_NONE && ck.iterStart == 0) // march in time first (a resumed case is past it)
+	{
+		sprintf_s(strFrameFile, MAX_BUFF_SIZE, "%s Transient.hts", SD.strCase);
+		nStatus = SolveTransient(G, &SD, SD.solver.frameTime > 0.0 ? strFrameFile : NULL, &tinfo);
+		reportf("\nTransient: %s, %d steps (%d redone) to t = %.5le, dt %.3le .. %.3le, %d V-cycles in %.4lf s",
+			SD.solver.nTransient == TRANSIENT_CN ? "Crank-Nicolson" : "backward Euler", tinfo.nSteps, tinfo.nRejected,
+			tinfo.t, tinfo.dtMin, tinfo.dtMax, tinfo.nCycles, tinfo.seconds);
+		if (tinfo.nFrames > 0) reportf("\nTransient: %d frames written to \"%s\"", tinfo.nFrames, strFrameFile);
+		if (tinfo.bWriteFailed) reportf("\nCannot write \"%s\"", strFrameFile);
+		if (nStatus != HTS_OK || tinfo.bEndTime)
+		{
+			closeConvergenceLog(&log);
+			FreeCheckpoint(&ck);
+			if (nStatus == HTS_ERROR_MEMORY) reportf("\nOut of memory solving \"%s\"\n", SD.strCase);
+			else if (nStatus == HTS_ERROR_INTERRUPTED) reportf("\n\"%s\" stopped by signal %d at t = %.5le\n", SD.strCase,
+				(int)nStopSignal, tinfo.t);
+			else reportf("\nTransient: stopped at END_TIME, steady-state Rmax = %.5le, RMS = %.5le\n\n", tinfo.rmax, tinfo.RMS);
+			return nStatus; // at END_TIME the field of that time is the result, not a steady solution
+		}
+		if (tinfo.bSteady) reportf("\nTransient: steady within %.1le, the %s solver finishes from there", MAX_TRANSIENT_RESIDUAL,
+			SOLVER_NAMES[SD.solver.nSolver]);
+	}
+	nStatus = SolvePlate(G, &SD, &log, &ck, &info);
+	closeConvergenceLog(&log); // the file is closed by the output thread after the last record
+	if (ck.bWriteFailed) reportf("\nCannot write \"%s\"", ck.strFile);
+	if (nStatus == HTS_OK && ck.bSaved) remove(ck.strFile); // a finished case is not resumed again
+	if ((nStatus == HTS_OK || nStatus == HTS_ERROR_NOT_CONVERGED) && ck.bKeepHistory && !StoreCachedSolution(G, &SD, &ck, &info))
+		reportf("\nCannot add \"%s\" to the solution cache", SD.strCase);
+	FreeCheckpoint(&ck);
+	if (nStatus == HTS_ERROR_MEMORY)
+	{
+		reportf("\nOut of memory solving \"%s\"\n", SD.strCase);
+		return nStatus;
+	}
+	if (nStatus == HTS_ERROR_INTERRUPTED)
+	{
+		reportf("\n\"%s\" stopped by signal %d at iteration %d", SD.strCase, (int)nStopSignal, info.iter);
+		if (ck.bSaved && !ck.bWriteFailed) reportf(", state saved to \"%s\"", ck.strFile);
+		reportf("\n");
+		return nStatus;
+	}
+
+	if (info.bFallback) reportf("\nSolver: %s cannot solve this plate, using %s instead", SOLVER_NAMES[SD.solver.nSolver],
+		SOLVER_NAMES[info.nSolver]);
+	if (info.nAmrNodes > 0)
+	{
+		reportf("\nMesh: quadtree AMR, %zu of %zu nodes (%.1lf%%), %d leaves %d levels deep, %d composite grids solved",
+			info.nAmrNodes, G->I * G->J, 100.0 * (double)info.nAmrNodes / ((double)G->I * (double)G->J), info.nAmrLeaves,
+			info.nAmrDepth, info.nAmrPasses);
+		reportf("\nSolver: composite-grid %s, omega = %.6lf, resampled onto the %zu x %zu case grid",
+			info.nSolver == SOLVER_GS ? "Gauss-Seidel" : "SOR", info.omega, G->I, G->J);
+	}
+	else if (info.nSolver == SOLVER_CHOLESKY)
+	{
+		reportf("\nSolver: direct, banded Cholesky of bandwidth %zu, ", info.nBandwidth);
+		if (info.nFactorSource == FACTOR_FROM_MEMORY) reportf("factor reused from memory");
+		else reportf("factor %s in %.4lf s", info.nFactorSource == FACTOR_FROM_DISK ? "read from the cache" : "computed",
+			info.factorSeconds);
+	}
+	else if (info.nSolver == SOLVER_DST)
+		reportf("\nSolver: direct, %s in x and tridiagonal solves in y", SD.bc[RIGHT].nType == BC_TYPE_INSULATED ?
+			"quarter-wave sine transform" : "DST-I");
+	else if (info.nSolver == SOLVER_SOR)
+	{
+		reportf("\nSolver: red-black SOR, omega = %.6lf, %s kernels", info.omega, GetStencilKernels(SD.solver.nSimd)->strName);
+		if (info.nThreads > 1) reportf(", %d threads", info.nThreads);
+		if (info.nProcesses > 1) reportf(", %d subdomains on %s with halo exchange", info.nProcesses, info.strTransport);
+		if (info.bTransportFallback) reportf("\nTransport: no SHM worker process could be started, using THREADS instead");
+	}
+	else if (info.nSolver == SOLVER_PCG)
+		reportf("\nSolver: PCG, %s preconditioner", SD.solver.nPrecond == PRECOND_IC ? "incomplete Cholesky" :
+			SD.solver.nPrecond == PRECOND_SGS ? "symmetric Gauss-Seidel" : "Jacobi");
+	else if (info.nSolver == SOLVER_LINE)
+		reportf("\nSolver: line Gauss-Seidel, %s (lamda = %.4lf)", info.nLines == LINES_X ? "x-lines" :
+			info.nLines == LINES_Y ? "y-lines" : "alternating x- and y-lines", (SD.dx / SD.dy) * (SD.dx / SD.dy));
+	else if (info.nSolver == SOLVER_ADI)
+		reportf("\nSolver: Peaceman-Rachford ADI, %d shifts per cycle", info.nShifts);
+	else if (info.nSolver == SOLVER_MG)
+		reportf("\nSolver: multigrid V(%d,%d), %d levels", MG_PRE_SWEEPS, MG_POST_SWEEPS, info.nLevels);
+	if (info.bTiled)
+	{
+		reportf("\nTiling: %d sweeps per wavefront pass", SD.solver.nTileSweeps);
+		if (SD.solver.nTileWidth > 0) reportf(", %d columns per strip", SD.solver.nTileWidth);
+	}
+	if (info.bFused) reportf("\nResidual: fused with the sweep");
+	if (info.bMixed) // where the precision switched
+	{
+		if (info.iterFloat > 0) reportf("\nPrecision: float32 sweeps to iteration %d, then", info.iterFloat);
+		else reportf("\nPrecision:");
+		reportf(" float32 corrections with %d float64 refinements", info.nRefinements);
+		if (info.iterDouble > 0) reportf(", float64 sweeps from iteration %d", info.iterDouble);
+	}
+
+	// prints to screen - the values of iter, rmax and RMS, and how fast this run got there
+	reportf("\nNumber of iterations: %d", info.iter);
+	reportf("\nRmax = %.5le", info.rmax);
+	reportf("\nRMS = %.5le", info.RMS);
+	if (info.iterRun > 0 && info.seconds > 0.0)
+		reportf("\nSolve time = %.4lf s, %.4lf ms per iteration, %.1lf MLUPS", info.seconds, 1e3 * info.seconds / info.iterRun,
+			(info.nAmrNodes > 0 ? info.nodeUpdates : (double)G->I * (double)G->J * info.iterRun) / info.seconds * 1e-6);
+	reportf("\n\n");
+
+	reportf("\nPrinted data to file \"%s\n", strConvergenceFile);
+	return nStatus;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  The solver loop behind GetNumericalSolution and hts_solve.  Relaxes T_fd with the case's 
+//               solver until the residual falls below MAX_RESIDUAL or the iteration limit (MAX_ITER unless
+//               MAX_ITERATIONS is set) is reached, and leaves the residual field in res.  Prints nothing 
+//               and touches no state outside G, so several plates can be solved at once from different threads
+// ARGUMENTS:    G:         the plate grid (boundary conditions set)
+//               SD:        the simulation data for the case
+//               log:       NULL, or the log that receives rmax, RMS, elapsed time and iter after every iteration
+//               ck:        NULL, or the checkpoint state: the solve starts after ck->iterStart iterations
+//                          (T_fd already loaded), records its history, writes snapshots and stops early
+//                          on SIGINT/SIGTERM
+//               pInfo:     returns the solver details and the final convergence
+// RETURN VALUE: HTS_OK, HTS_ERROR_NOT_CONVERGED, HTS_ERROR_MEMORY or HTS_ERROR_INTERRUPTED
+int SolvePlate(PLATEGRID* G, const SIMULATION_DATA* SD, CONVERGENCE_LOG* log, CHECKPOINT* ck, SOLVE_INFO* pInfo)
+{
+	double rmax = 0; // defines and initializes rmax to zero
+	double RMS = 0.0; // variable holder for RMS value
+	double lamda = (SD->dx / SD->dy) * (SD->dx / SD->dy); // calculates lamda 
+	bool bFused = SD->solver.bFused && (SD->solver.nSolver == SOLVER_GS || SD->solver.nSolver == SOLVER_SOR);
+	bool bTiled = SD->solver.nTileSweeps > 1 && (SD->solver.nSolver == SOLVER_GS || SD->solver.nSolver == SOLVER_SOR);
+	double omega = 1.0; // SOR relaxation factor
+	MULTIGRID* MG = NULL; // multigrid hierarchy
+	PCG_DATA* CG = NULL; // conjugate gradient work planes
+	LINE_DATA* LS = NULL; // line relaxation and ADI work space
+	THREAD_POOL* pool = NULL; // helper threads for the parallel red-black sweep
+	SWEEP_JOB* job = NULL; // arguments and reductions of the parallel sweep
+	int iter = ck != NULL ? ck->iterStart : 0; // iteration counter
+	int maxIter = SD->solver.nMaxIter > 0 ? SD->solver.nMaxIter : MAX_ITER; // iteration limit
+	int nStatus = HTS_OK; // checkpoint status, the loop stops if it is not HTS_OK
+	bool bMixed; // float32 sweeps with float64 refinement
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // solve timer
+	double seconds = 0.0; // elapsed time of the record, only read when something is logged
+	double secondsBefore = ck != NULL && ck->nRecords > 0 ? ck->records[ck->nRecords - 1].seconds : 0.0; // resumed
+	SIMULATION_DATA fallback; // the case with the next solver, when a direct one cannot solve it
+
+	pInfo->nSolver = SD->solver.nSolver;
+	if (SD->solver.nSolver == SOLVER_DST || SD->solver.nSolver == SOLVER_CHOLESKY) // one direct solve counts as one iteration
+	{
+		if ((SD->solver.nSolver == SOLVER_DST ? SolveDirectDST(G, SD, lamda) : SolveDirectCholesky(G, SD, lamda, pInfo)) != HTS_OK)
+		{ // not this plate, too big or out of memory: CHOLESKY falls back to DST, DST to SOR
+			fallback = *SD;
+			fallback.solver.nSolver = SD->solver.nSolver == SOLVER_CHOLESKY ? SOLVER_DST : SOLVER_SOR;
+			nStatus = SolvePlate(G, &fallback, log, ck, pInfo);
+			pInfo->bFallback = true;
+			return nStatus;
+		}
+		GetResidual(G, SD, lamda, &rmax, &RMS);
+		iter++;
+		seconds = secondsBefore + secondsSince(start);
+		if (log != NULL) logConvergence(log, rmax, RMS, seconds, iter);
+		if (ck != NULL) nStatus = UpdateCheckpoint(G, SD, ck, rmax, RMS, seconds, iter);
+		pInfo->bConverged = rmax < MAX_RESIDUAL || RMS < MAX_RESIDUAL;
+		pInfo->iter = iter;
+		pInfo->iterRun = 1;
+		pInfo->rmax = rmax;
+		pInfo->RMS = RMS;
+		pInfo->omega = 1.0;
+		pInfo->nThreads = 1;
+		pInfo->seconds = secondsSince(start);
+		if (nStatus != HTS_OK) return nStatus;
+		return pInfo->bConverged ? HTS_OK : HTS_ERROR_NOT_CONVERGED;
+	}
+
+	pInfo->bFused = bFused;
+	pInfo->bTiled = bTiled;
+	pInfo->nThreads = 1;
+	if (SD->solver.nAmrLevels > 0 && !isCheckpointing(&SD->solver) && (ck == NULL || ck->iterStart == 0))
+	{ // quadtree composite grid (a snapshot would need the tree, so a checkpointing case stays uniform)
+		pInfo->bFused = false;
+		pInfo->bTiled = false;
+		nStatus = SolveAdaptive(G, SD, log, ck, pInfo);
+		pInfo->seconds = secondsSince(start);
+		return nStatus;
+	}
+	if (SD->solver.nSolver == SOLVER_SOR) // use the case file omega or compute the optimal one
+	{
+		omega = SD->solver.omega > 0.0 ? SD->solver.omega : GetOptimalOmega(G, SD, lamda);
+		if (SD->solver.nProcesses > 1 && !bTiled && !SD->solver.bMixed && !isCheckpointing(&SD->solver))
+		{ // bands of rows on separate ranks (a snapshot needs the whole field after every iteration)
+			pInfo->omega = omega;
+			pInfo->bFused = false;
+			nStatus = SolveDecomposed(G, SD, lamda, omega, log, ck, pInfo);
+			pInfo->seconds = secondsSince(start);
+			return nStatus;
+		}
+		if (SD->solver.nThreads > 1 && !bTiled) // rows are split across a pool, the caller is thread 0
+		{
+			pool = CreateThreadPool(SD->solver.nThreads);
+			job = new (std::nothrow) SWEEP_JOB();
+			if (pool == NULL || job == NULL)
+			{
+				FreeThreadPool(pool);
+				delete job;
+				return HTS_ERROR_MEMORY;
+			}
+			job->G = G;
+			job->SD = SD;
+			job->lamda = lamda;
+			job->omega = omega;
+			job->bFused = bFused;
+			pInfo->nThreads = pool->nThreads;
+		}
+	}
+	else if (SD->solver.nSolver == SOLVER_PCG) // first residual and search direction
+	{
+		CG = CreatePCG(G, SD, lamda);
+		if (CG == NULL) return HTS_ERROR_MEMORY;
+	}
+	else if (SD->solver.nSolver == SOLVER_LINE || SD->solver.nSolver == SOLVER_ADI) // line directions or shifts
+	{
+		LS = CreateLineSolver(G, SD, lamda, iter);
+		if (LS == NULL) return HTS_ERROR_MEMORY;
+		pInfo->nLines = LS->nLines;
+		pInfo->nShifts = LS->nShifts;
+	}
+	else if (SD->solver.nSolver == SOLVER_MG) // build the hierarchy and start from the FMG solution
+	{
+		MG = CreateMultigrid(G, SD);
+		if (MG == NULL) return HTS_ERROR_MEMORY;
+		pInfo->nLevels = MG->nLevels;
+		if (iter == 0) SolveFullMultigrid(MG); // a resumed solve already has a better start
+	}
+	pInfo->omega = omega;
+
+	// mixed precision runs the serial GS and SOR sweeps; snapshots need T_fd current after every iteration
+	bMixed = SD->solver.bMixed && (SD->solver.nSolver == SOLVER_GS || SD->solver.nSolver == SOLVER_SOR) &&
+		pool == NULL && !bTiled && !isCheckpointing(&SD->solver);
+	if (bMixed) nStatus = SolveMixedPrecision(G, SD, lamda, omega, maxIter, log, ck, start, secondsBefore, &iter, &rmax, &RMS, pInfo);
+	if (!pInfo->bMixed || pInfo->iterDouble > 0) do // float64 sweeps, also after the mixed solver ran out of precision
+	{
+		// relax every interior node once with the chosen solver (fused sweeps also return rmax and RMS)
+		if (bTiled) SweepTiled(G, SD, lamda, omega, bFused ? &rmax : NULL, &RMS);
+		else if (pool != NULL) SweepRedBlackSORParallel(pool, job, &rmax, &RMS);
+		else if (SD->solver.nSolver == SOLVER_SOR) SweepRedBlackSOR(G, SD, lamda, omega, bFused ? &rmax : NULL, &RMS);
+		else if (SD->solver.nSolver == SOLVER_MG) MultigridVCycle(MG, 0);
+		else if (SD->solver.nSolver == SOLVER_PCG) StepPCG(CG, G);
+		else if (SD->solver.nSolver == SOLVER_LINE) SweepLines(LS, G);
+		else if (SD->solver.nSolver == SOLVER_ADI) StepADI(LS, G);
+		else if (bFused) SweepGaussSeidelFused(G, SD, lamda, &rmax, &RMS);
+		else SweepGaussSeidel(G, SD, lamda);
+		// recompute the residual field, rmax and RMS for the convergence check
+		if (!bFused && pool != NULL) GetResidualParallel(pool, job, &rmax, &RMS);
+		else if (!bFused) GetResidual(G, SD, lamda, &rmax, &RMS);
+		iter += bTiled ? SD->solver.nTileSweeps : 1; // iter increments by the sweeps done
+	    // do the loop while iter is less than or equal to MAX_ITER AND rmax is 
+		//greater or eqal to MAX_RESIDUAL AND RMS greater or equal to MAX_RESIDUAL  
+		if (log != NULL || ck != NULL) seconds = secondsBefore + secondsSince(start);
+		if (log != NULL) logConvergence(log, rmax, RMS, seconds, iter);
+		if (ck != NULL) nStatus = UpdateCheckpoint(G, SD, ck, rmax, RMS, seconds, iter);
+
+	} while (nStatus == HTS_OK && iter <= maxIter && (rmax >= MAX_RESIDUAL && RMS >= MAX_RESIDUAL));
+	pInfo->bConverged = rmax < MAX_RESIDUAL || RMS < MAX_RESIDUAL;
+
+	// the fused and float32 sweeps never write res, so fill it (and report the true residual) once for the output files
+	if (bFused && pool != NULL) GetResidualParallel(pool, job, &rmax, &RMS);
+	else if (bFused || pInfo->bMixed) GetResidual(G, SD, lamda, &rmax, &RMS);
+
+	pInfo->iter = iter;
+	pInfo->iterRun = ck != NULL ? iter - ck->iterStart : iter;
+	pInfo->rmax = rmax;
+	pInfo->RMS = RMS;
+	pInfo->seconds = secondsSince(start);
+	FreeMultigrid(MG);
+	FreePCG(CG);
+	FreeLineSolver(LS);
+	FreeThreadPool(pool);
+	delete job;
+	if (nStatus != HTS_OK) return nStatus;
+	return pInfo->bConverged ? HTS_OK : HTS_ERROR_NOT_CONVERGED;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  TRANSIENT EULER|CN: marches dT/dt = alpha laplacian(T) in time from the current field (T0 
+//               inside, the walls switched on at t = 0).  Each implicit step
+//                   T' - theta alpha dt laplacian(T') = T + (1 - theta) alpha dt laplacian(T)
+//               (theta = 1 backward Euler, 1/2 Crank-Nicolson) is the steady problem with a diagonal shift 
+//               and a right-hand side, which the multigrid V-cycle already solves: its levels get the shift
+//               1/(theta alpha dt) and level 0 the source, and the cycles start from a linear extrapolation
+//               of the last two steps.  How far the step moved from that prediction estimates its local
+//               error (first order, so conservative for Crank-Nicolson); a step more than TRANSIENT_REJECT
+//               allowances off is redone shorter, and the next step grows or shrinks with the square root
+//               of the allowance over the estimate.  As the plate settles the steps grow geometrically (the
+//               case files take 100 to 300 steps), and the march stops once the steady residual falls below
+//               MAX_TRANSIENT_RESIDUAL or at END_TIME.  Frames are written as they are made, at every 
+//               FRAME_TIME (the steps are cut to land on them) and at the end, so only the current and 
+//               previous fields are ever held
+// ARGUMENTS:    G:            the plate grid (boundary conditions set), returns the field at the end
+//               SD:           the simulation data for the case
+//               strFrameFile: NULL, or the frame file to write
+//               pInfo:        returns the steps, the time reached and the residual
+// RETURN VALUE: HTS_OK, HTS_ERROR_MEMORY or HTS_ERROR_INTERRUPTED
+int SolveTransient(PLATEGRID* G, const SIMULATION_DATA* SD, const char* strFrameFile, TRANSIENT_INFO* pInfo)
+{
+	double lamda = (SD->dx / SD->dy) * (SD->dx / SD->dy); // (dx/dy)^2
+	double theta = SD->solver.nTransient == TRANSIENT_CN ? 0.5 : 1.0; // implicit weight
+	double alpha = SD->solver.diffusivity > 0.0 ? SD->solver.diffusivity : 1.0; // thermal diffusivity
+	double h = SD->dx < SD->dy ? SD->dx : SD->dy; // smaller cell size
+	double dt = SD->solver.timeStep > 0.0 ? SD->solver.timeStep : TRANSIENT_FIRST_STEP * h * h / alpha; // step to try next
+	double dtStep;                // the step being tried, cut to land on a frame or END_TIME
+	double dtPrev = 0.0;          // the last accepted step
+	double t = 0.0;               // time reached
+	double tNext;                 // time at the end of the step, exactly the frame or END_TIME it was cut to
+	double tFrame = SD->solver.frameTime; // time of the next frame
+	double tol;                   // local error allowed per step
+	double solveTol;              // residual each step is solved to, in temperature units
+	double e, ratio, p, q;        // error estimate, step ratio, predicted node, temperature-unit scale
+	double wallMax = 0.0;         // hottest wall
+	bool bInsulated = SD->bc[RIGHT].nType == BC_TYPE_INSULATED;
+	size_t I = G->I, J = G->J, s = G->stride, iLast = bInsulated ? I - 1 : I - 2; // last unknown column
+	size_t planeSize = s * J;     // doubles in one plane
+	size_t i, j, k;               // counters
+	MULTIGRID* MG;                // hierarchy that solves the steps
+	MG_LEVEL* L0;                 // its level 0, the plate
+	double* block;                // Tn, Tp and lapN
+	double* Tn, * Tp, * lapN;     // field at t, at t - dtPrev, and its laplacian (CN)
+	FILE* fFrames = NULL;         // the frame file
+	RESULT_FILE_HEADER header;    // its header
+	int nCycles, nTries, l;       // V-cycles and attempts of a step, level counter
+	int nStatus = HTS_OK;         // stop signal
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // march timer
+
+	memset(pInfo, 0, sizeof(TRANSIENT_INFO));
+	MG = CreateMultigrid(G, SD);
+	block = (double*)calloc(3 * planeSize, sizeof(double));
+	if (MG == NULL || block == NULL)
+	{
+		FreeMultigrid(MG);
+		free(block);
+		return HTS_ERROR_MEMORY;
+	}
+	L0 = &MG->level[0];
+	Tn = block;
+	Tp = Tn + planeSize;
+	lapN = Tp + planeSize;
+	for (i = 0; i < I; i++) wallMax = std::max(wallMax, std::max(fabs(G->T_fd[i]), fabs(G->T_fd[(J - 1) * s + i])));
+	for (j = 0; j < J; j++) wallMax = std::max(wallMax, std::max(fabs(G->T_fd[j * s]), fabs(G->T_fd[j * s + I - 1])));
+	tol = TRANSIENT_STEP_ERROR * (wallMax > 0.0 ? wallMax : 1.0);
+	solveTol = std::min(0.01 * tol, 0.1 * MAX_TRANSIENT_RESIDUAL);
+
+	if (strFrameFile != NULL && (fopen_s(&fFrames, strFrameFile, "wb") != 0 || fFrames == NULL))
+	{
+		fFrames = NULL;
+		pInfo->bWriteFailed = true;
+	}
+	if (fFrames != NULL)
+	{
+		setvbuf(fFrames, NULL, _IONBF, 0); // whole planes, stdio buffering would only add a copy
+		fillResultHeader(G, SD, &header);
+		memcpy(header.magic, TRANSIENT_FILE_MAGIC, sizeof(header.magic));
+		header.version = TRANSIENT_FILE_VERSION;
+		header.flags = 0;
+		header.nPlanes = 1; // per frame
+		if (fwrite(&header, sizeof(header), 1, fFrames) != 1) pInfo->bWriteFailed = true;
+		GetResidual(G, SD, lamda, &pInfo->rmax, &pInfo->RMS);
+		if (!writeTransientFrame(fFrames, G, 0.0, 0.0, 0, pInfo->rmax, pInfo->RMS)) pInfo->bWriteFailed = true;
+		else pInfo->nFrames++;
+	}
+
+	while (pInfo->nSteps < TRANSIENT_MAX_STEPS)
+	{
+		memcpy(Tn, G->T_fd, planeSize * sizeof(double));
+		if (theta < 1.0) // the explicit half of Crank-Nicolson: laplacian(T) at t
+		{
+			memset(L0->f, 0, planeSize * sizeof(double));
+			for (l = 0; l < MG->nLevels; l++) MG->level[l].shift = 0.0;
+			GetMultigridResidual(L0, bInsulated);
+			memcpy(lapN, L0->r, planeSize * sizeof(double));
+		}
+		for (nTries = 0; ; nTries++)
+		{
+			tNext = t + dt;
+			if (SD->solver.endTime > 0.0 && tNext > SD->solver.endTime) tNext = SD->solver.endTime;
+			if (tFrame > 0.0 && tNext > tFrame) tNext = tFrame;
+			dtStep = tNext - t;
+			for (l = 0; l < MG->nLevels; l++) MG->level[l].shift = 1.0 / (alpha * theta * dtStep);
+			ratio = pInfo->nSteps > 0 ? dtStep / dtPrev : 0.0;
+			for (j = 1; j < J - 1; j++) // source, and the predicted field as the first guess
+			{
+				for (i = 1; i <= iLast; i++)
+				{
+					k = j * s + i;
+					L0->f[k] = L0->shift * Tn[k] + (theta < 1.0 ? lapN[k] : 0.0);
+					G->T_fd[k] = Tn[k] + ratio * (Tn[k] - Tp[k]);
+				}
+			}
+			q = L0->dx * L0->dx / (2.0 * (1.0 + lamda) + L0->dx * L0->dx * L0->shift); // residual -> node change
+			for (nCycles = 0; nCycles < TRANSIENT_MAX_CYCLES; )
+			{
+				MultigridVCycle(MG, 0);
+				nCycles++;
+				GetMultigridResidual(L0, bInsulated);
+				e = 0.0;
+				for (k = 0; k < planeSize; k++) e = std::max(e, fabs(L0->r[k]));
+				if (e * q < solveTol) break;
+			}
+			pInfo->nCycles += nCycles;
+			if (pInfo->nSteps == 0) break; // nothing to extrapolate from: the first step is taken as given
+			e = 0.0; // how far the step moved from the prediction
+			for (j = 1; j < J - 1; j++)
+			{
+				for (i = 1; i <= iLast; i++)
+				{
+					k = j * s + i;
+					p = Tn[k] + ratio * (Tn[k] - Tp[k]);
+					e = std::max(e, fabs(G->T_fd[k] - p));
+				}
+			}
+			e *= dtStep / (dtStep + dtPrev); // local error of the step
+			if (e <= TRANSIENT_REJECT * tol || nTries == TRANSIENT_MAX_REJECTS) break;
+			dt = dtStep * std::max(TRANSIENT_MIN_SHRINK, TRANSIENT_SAFETY * sqrt(tol / e));
+			pInfo->nRejected++;
+		}
+		if (pInfo->nSteps > 0) // next step from this one's error
+		{
+			ratio = e > 0.0 ? TRANSIENT_SAFETY * sqrt(tol / e) : TRANSIENT_MAX_GROWTH;
+			ratio = std::min(TRANSIENT_MAX_GROWTH, std::max(TRANSIENT_MIN_SHRINK, ratio));
+			// a step cut short for a frame keeps the longer step unless its own error asks for less
+			dt = dtStep < dt ? std::min(dt, dtStep * ratio) : dtStep * ratio;
+		}
+		std::swap(Tn, Tp); // Tp is the field at t, T_fd at t + dtStep
+		dtPrev = dtStep;
+		t = tNext;
+		pInfo->dtMin = pInfo->nSteps == 0 ? dtStep : std::min(pInfo->dtMin, dtStep);
+		pInfo->dtMax = std::max(pInfo->dtMax, dtStep);
+		pInfo->nSteps++;
+
+		GetResidual(G, SD, lamda, &pInfo->rmax, &pInfo->RMS);
+		pInfo->bSteady = pInfo->rmax < MAX_TRANSIENT_RESIDUAL;
+		pInfo->bEndTime = SD->solver.endTime > 0.0 && t >= SD->solver.endTime;
+		if (nStopSignal != 0) nStatus = HTS_ERROR_INTERRUPTED;
+		if (fFrames != NULL && !pInfo->bWriteFailed && ((tFrame > 0.0 && t >= tFrame) || pInfo->bSteady || pInfo->bEndTime))
+		{
+			if (!writeTransientFrame(fFrames, G, t, dtStep, pInfo->nSteps, pInfo->rmax, pInfo->RMS)) pInfo->bWriteFailed = true;
+			else pInfo->nFrames++;
+		}
+		while (tFrame > 0.0 && tFrame <= t) tFrame += SD->solver.frameTime;
+		if (pInfo->bSteady || pInfo->bEndTime || nStatus != HTS_OK) break;
+	}
+
+	if (fFrames != NULL && fclose(fFrames) != 0) pInfo->bWriteFailed = true;
+	pInfo->t = t;
+	pInfo->seconds = secondsSince(start);
+	FreeMultigrid(MG);
+	free(block);
+	return nStatus;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Appends one frame to a frame file: a row of stride doubles holding t, dt, the step, rmax
+//               and RMS (the rest zero), then the T_fd plane with the grid's row layout
+// ARGUMENTS:    f:         the frame file
+//               G:         the plate grid
+//               t, dt:     time of the frame and the step that reached it
+//               nStep:     steps taken
+//               rmax, RMS: steady-state residual of the field
+// RETURN VALUE: false if the frame could not be written
+bool writeTransientFrame(FILE* f, const PLATEGRID* G, double t, double dt, int nStep, double rmax, double RMS)
+{
+	std::vector<double> row(G->stride, 0.0); // the frame's header row
+	size_t nValues = G->stride * G->J;        // doubles in the plane
+
+	row[0] = t;
+	row[1] = dt;
+	row[2] = (double)nStep;
+	row[3] = rmax;
+	row[4] = RMS;
+	return fwrite(row.data(), sizeof(double), G->stride, f) == G->stride && fwrite(G->T_fd, sizeof(double), nValues, f) == nValues;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  AMR_LEVELS n: solves the plate on a quadtree of cells instead of every node of the case
+//               grid.  The root cells are about 2^n case cells wide and split into four (two once they are
+//               one case cell wide in x or y), so every corner is a node of the case grid and keeps its
+//               place in T_fd.  The composite grid is the corners of the leaves (BuildAmrRows).  Each pass
+//               relaxes it, resamples it onto every case node (bilinear in each leaf) and takes the residual
+//               of that field on the case grid, which is zero inside a leaf and shows where the resampled
+//               field kinks.  Leaves whose error estimate from it exceeds AMR_TOLERANCE, or whose corners
+//               differ by more than AMR_GRADIENT, are split (RefineAmrMesh) and the next pass starts from
+//               the resampled field.  A grid that will be refined again is only relaxed to
+//               AMR_PASS_RESIDUAL AMR_TOLERANCE; once no leaf splits, the last one is relaxed on to
+//               MAX_RESIDUAL.  T_fd and res end up as for the uniform solvers (res is the case-grid
+//               residual of the resampled field), so the output files keep their shape.  GS relaxes with
+//               omega 1, every other SOLVER with SOR
+// ARGUMENTS:    G:     the plate grid (boundary conditions set)
+//               SD:    the simulation data for the case
+//               log:   the convergence log, may be NULL
+//               ck:    the checkpoint (history only, no snapshots), may be NULL
+//               pInfo: returns the iterations, residuals and the final composite grid
+// RETURN VALUE: HTS_OK, HTS_ERROR_NOT_CONVERGED, HTS_ERROR_MEMORY or the checkpoint status
+int SolveAdaptive(PLATEGRID* G, const SIMULATION_DATA* SD, CONVERGENCE_LOG* log, CHECKPOINT* ck, SOLVE_INFO* pInfo)
+{
+	AMR_MESH A = {};       // the tree and its composite grid
+	double lamda = (SD->dx / SD->dy) * (SD->dx / SD->dy); // (dx/dy)^2
+	double omega = 1.0;    // relaxation factor of the pass
+	double rmax = 0.0, RMS = 0.0; // composite residual
+	double rmaxCase, RMSCase; // case-grid residual of the resampled field
+	double hEq;            // cell size of a uniform grid with as many unknowns
+	double Mx, My;         // its cells in x and y
+	double rho;            // its Jacobi spectral radius
+	int iter = ck != NULL ? ck->iterStart : 0; // iteration counter
+	int maxIter = SD->solver.nMaxIter > 0 ? SD->solver.nMaxIter : MAX_ITER; // iteration limit
+	int nStatus = HTS_OK;  // checkpoint status
+	int nSplit;            // leaves split after a pass, -1 = out of memory
+	double tolerance = SD->solver.amrTolerance > 0.0 ? SD->solver.amrTolerance : AMR_TOLERANCE; // AMR_TOLERANCE
+	double target;         // residual the pass relaxes to
+	bool bBuild = true;    // the tree changed, build its composite grid
+	bool bFinal = false;   // no leaf split after the last pass
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // solve timer
+	double secondsBefore = ck != NULL && ck->nRecords > 0 ? ck->records[ck->nRecords - 1].seconds : 0.0; // resumed
+	double seconds = 0.0;  // elapsed time of a record
+
+	if (G->I < 3 || G->J < 3) return HTS_ERROR_ARGUMENT;
+	if (!CreateAmrMesh(G, SD, &A)) return HTS_ERROR_MEMORY;
+	pInfo->nSolver = SD->solver.nSolver == SOLVER_GS ? SOLVER_GS : SOLVER_SOR;
+	while (true)
+	{
+		if (bBuild) // a new composite grid
+		{
+			if (!BuildAmrRows(G, SD, &A))
+			{
+				nStatus = HTS_ERROR_MEMORY;
+				break;
+			}
+			if (pInfo->nSolver == SOLVER_SOR && SD->solver.omega > 0.0) omega = SD->solver.omega;
+			else if (pInfo->nSolver == SOLVER_SOR) // GetOptimalOmega of a uniform grid with as many unknowns
+			{
+				hEq = sqrt(SD->w * SD->h / (double)(A.nRows > 0 ? A.nRows : 1));
+				Mx = SD->w / hEq;
+				My = SD->h / hEq;
+				if (SD->bc[RIGHT].nType == BC_TYPE_INSULATED) Mx *= 2.0;
+				rho = 0.5 * (cos(PI / (Mx > 2.0 ? Mx : 2.0)) + cos(PI / (My > 2.0 ? My : 2.0)));
+				omega = 2.0 / (1.0 + sqrt(1.0 - rho * rho));
+			}
+			pInfo->nAmrPasses++;
+		}
+		target = bFinal ? MAX_RESIDUAL : AMR_PASS_RESIDUAL * tolerance;
+		do // relax the composite grid
+		{
+			SweepAmr(G, &A, omega);
+			GetAmrResidual(G, &A, &rmax, &RMS);
+			pInfo->nodeUpdates += (double)A.nRows;
+			iter++;
+			if (log != NULL || ck != NULL) seconds = secondsBefore + secondsSince(start);
+			if (log != NULL) logConvergence(log, rmax, RMS, seconds, iter);
+			if (ck != NULL) nStatus = UpdateCheckpoint(G, SD, ck, rmax, RMS, seconds, iter);
+		} while (nStatus == HTS_OK && iter <= maxIter && rmax >= target && RMS >= target);
+		ResampleAmr(G, SD, &A);
+		GetResidual(G, SD, lamda, &rmaxCase, &RMSCase);
+		pInfo->nAmrNodes = A.nNodes;
+		pInfo->nAmrLeaves = A.nLeaves;
+		pInfo->nAmrDepth = A.nDepth;
+		if (bFinal || nStatus != HTS_OK || iter > maxIter) break;
+		nSplit = RefineAmrMesh(G, SD, &A);
+		if (nSplit < 0)
+		{
+			nStatus = HTS_ERROR_MEMORY;
+			break;
+		}
+		bBuild = nSplit > 0;
+		bFinal = nSplit == 0; // the grid is final: relax it the rest of the way to MAX_RESIDUAL
+	}
+	FreeAmrMesh(&A);
+
+	pInfo->bConverged = rmax < MAX_RESIDUAL || RMS < MAX_RESIDUAL;
+	pInfo->iter = iter;
+	pInfo->iterRun = ck != NULL ? iter - ck->iterStart : iter;
+	pInfo->rmax = rmax;
+	pInfo->RMS = RMS;
+	pInfo->omega = omega;
+	if (nStatus != HTS_OK) return nStatus;
+	return pInfo->bConverged ? HTS_OK : HTS_ERROR_NOT_CONVERGED;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Allocates the leaf and node maps and the root cells of the quadtree: ceil((I - 1) / 2^n) by
+//               ceil((J - 1) / 2^n) cells whose edges are the case grid lines nearest to an even split
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for the case (AMR_LEVELS)
+//               A:  returns the tree
+// RETURN VALUE: false if out of memory
+bool CreateAmrMesh(const PLATEGRID* G, const SIMULATION_DATA* SD, AMR_MESH* A)
+{
+	size_t Mx = G->I - 1, My = G->J - 1; // case cells in x and y
+	size_t w = (size_t)1 << SD->solver.nAmrLevels; // width of a root cell in case cells
+	size_t nx = (Mx + w - 1) / w, ny = (My + w - 1) / w; // root cells in x and y
+	size_t a, b;           // root cell counters
+	AMR_CELL* C;           // a root cell
+
+	memset(A, 0, sizeof(AMR_MESH));
+	A->nCapacity = 4 * nx * ny;
+	A->cells = (AMR_CELL*)malloc(A->nCapacity * sizeof(AMR_CELL));
+	A->leafOf = (int32_t*)malloc(Mx * My * sizeof(int32_t));
+	A->bNode = (uint8_t*)calloc(G->I * G->J, 1);
+	if (A->cells == NULL || A->leafOf == NULL || A->bNode == NULL)
+	{
+		FreeAmrMesh(A);
+		return false;
+	}
+	for (b = 0; b < ny; b++)
+	{
+		for (a = 0; a < nx; a++)
+		{
+			C = &A->cells[A->nCells++];
+			C->i0 = (int32_t)((a * Mx + nx / 2) / nx);
+			C->i1 = (int32_t)(((a + 1) * Mx + nx / 2) / nx);
+			C->j0 = (int32_t)((b * My + ny / 2) / ny);
+			C->j1 = (int32_t)(((b + 1) * My + ny / 2) / ny);
+			C->nDepth = 0;
+			C->iChild = -1;
+			C->nChildren = 0;
+			C->bSplit = 0;
+		}
+	}
+	mapAmrLeaves(G, A);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees the tree, the leaf map and the composite grid equations
+// ARGUMENTS:    A: the mesh
+// RETURN VALUE: none
+void FreeAmrMesh(AMR_MESH* A)
+{
+	free(A->cells);
+	free(A->leafOf);
+	free(A->bNode);
+	free(A->rows);
+	memset(A, 0, sizeof(AMR_MESH));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Splits a leaf at the case grid lines through its middle (the lower half gets the shorter
+//               part of an odd width); a side one case cell long is not split
+// ARGUMENTS:    A: the mesh
+//               c: index of the leaf
+// RETURN VALUE: false if out of memory (the leaf is left as it was)
+bool splitAmrCell(AMR_MESH* A, size_t c)
+{
+	AMR_CELL P = A->cells[c];  // the parent (the array may move)
+	AMR_CELL* cells;           // grown tree
+	int32_t xs[3], ys[3];      // edges of the children
+	int nx = P.i1 - P.i0 > 1 ? 2 : 1, ny = P.j1 - P.j0 > 1 ? 2 : 1; // children in x and y
+	int a, b;                  // child counters
+	AMR_CELL* C;               // a child
+
+	if (nx * ny == 1) return true;
+	if (A->nCells + 4 > A->nCapacity) // double the tree
+	{
+		cells = (AMR_CELL*)realloc(A->cells, 2 * A->nCapacity * sizeof(AMR_CELL));
+		if (cells == NULL) return false;
+		A->cells = cells;
+		A->nCapacity *= 2;
+	}
+	xs[0] = P.i0;
+	xs[1] = P.i0 + (P.i1 - P.i0) / 2;
+	xs[nx] = P.i1;
+	ys[0] = P.j0;
+	ys[1] = P.j0 + (P.j1 - P.j0) / 2;
+	ys[ny] = P.j1;
+	A->cells[c].iChild = (int32_t)A->nCells;
+	A->cells[c].nChildren = nx * ny;
+	A->cells[c].bSplit = 0;
+	for (b = 0; b < ny; b++)
+	{
+		for (a = 0; a < nx; a++)
+		{
+			C = &A->cells[A->nCells++];
+			C->i0 = xs[a];
+			C->i1 = xs[a + 1];
+			C->j0 = ys[b];
+			C->j1 = ys[b + 1];
+			C->nDepth = P.nDepth + 1;
+			C->iChild = -1;
+			C->nChildren = 0;
+			C->bSplit = 0;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Writes the leaf that covers each case cell into leafOf, and counts the leaves and their
+//               depth
+// ARGUMENTS:    G: the plate grid
+//               A: the mesh
+// RETURN VALUE: none
+void mapAmrLeaves(const PLATEGRID* G, AMR_MESH* A)
+{
+	size_t Mx = G->I - 1;  // case cells in a row
+	size_t c;              // cell counter
+	int32_t i, j;          // case cell counters
+	const AMR_CELL* C;     // a leaf
+
+	A->nLeaves = 0;
+	A->nDepth = 0;
+	for (c = 0; c < A->nCells; c++)
+	{
+		C = &A->cells[c];
+		if (C->iChild >= 0) continue;
+		A->nLeaves++;
+		if (C->nDepth > A->nDepth) A->nDepth = C->nDepth;
+		for (j = C->j0; j < C->j1; j++)
+			for (i = C->i0; i < C->i1; i++) A->leafOf[(size_t)j * Mx + (size_t)i] = (int32_t)c;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Builds the equations of the composite grid, row by row through the case grid so the sweep
+//               runs in the lexicographic order of the uniform Gauss-Seidel.  A case node is a composite
+//               node if it is the corner of one of the (up to four) leaves around it.  Each arm of its
+//               stencil reaches the nearest node along its grid line, at the nearest leaf corner, and the
+//               5-point stencil for unequal spacings
+//                   cE (T_E - T) + cW (T_W - T) + cN (T_N - T) + cS (T_S - T) = 0,   cE = 2 / ((hE + hW) hE), ...
+//               reduces to the uniform one where every arm is one cell long.  A node inside the edge of a
+//               bigger leaf (a hanging node) has no node along the arm into that leaf; it gets a ghost
+//               value on the leaf's far edge, interpolated between that edge's corners and corrected by
+//               -s_a s_b T''/2 along the edge, with T'' taken from the node's own arms along the edge.
+//               Plain linear interpolation would leave an O(1) truncation error at every hanging node; with
+//               the correction the composite solution stays second order.  The insulated right wall
+//               mirrors the west arm, as GetResidualRows does
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for the case
+//               A:  the mesh (leafOf current), returns rows, nRows, bNode and nNodes
+// RETURN VALUE: false if out of memory
+bool BuildAmrRows(const PLATEGRID* G, const SIMULATION_DATA* SD, AMR_MESH* A)
+{
+	size_t Mx = G->I - 1, My = G->J - 1; // case cells in x and y
+	size_t i, j;           // case node counters
+	int k, m, n;           // leaf, arm and weight counters
+	const AMR_CELL* L[4];  // leaves south-west, south-east, north-west and north-east of the node, or NULL
+	const AMR_CELL* H;     // a leaf the node hangs on, or NULL
+	bool bCorner;          // the node is a corner of a leaf
+	AMR_ROW* R;            // the row being built
+	AMR_ROW* rows;         // grown rows
+	AMR_ARM arm[4];        // east, west, north and south arms
+	double c[4];           // their coefficients
+	double g;              // weight left to the arms across a ghost after its curvature correction
+	double diag;           // sum of the coefficients
+	int32_t e;             // far end of an arm, in case nodes
+	double t;              // position of the node along the edge it hangs on
+
+	memset(A->bNode, 0, G->I * G->J);
+	A->nRows = 0;
+	A->nNodes = 0;
+	for (j = 0; j <= My; j++)
+	{
+		for (i = 0; i <= Mx; i++)
+		{
+			L[0] = i > 0 && j > 0 ? &A->cells[A->leafOf[(j - 1) * Mx + i - 1]] : NULL;
+			L[1] = i < Mx && j > 0 ? &A->cells[A->leafOf[(j - 1) * Mx + i]] : NULL;
+			L[2] = i > 0 && j < My ? &A->cells[A->leafOf[j * Mx + i - 1]] : NULL;
+			L[3] = i < Mx && j < My ? &A->cells[A->leafOf[j * Mx + i]] : NULL;
+			bCorner = false;
+			H = NULL;
+			for (k = 0; k < 4; k++)
+			{
+				if (L[k] == NULL) continue;
+				if (((int32_t)i == L[k]->i0 || (int32_t)i == L[k]->i1) && ((int32_t)j == L[k]->j0 || (int32_t)j == L[k]->j1))
+					bCorner = true;
+				else H = L[k];
+			}
+			if (!bCorner) continue; // inside a leaf, or inside the edge between two leaves
+			A->bNode[j * G->I + i] = 1;
+			A->nNodes++;
+			if (isFixedNode(G, SD, i, j)) continue;
+			if (A->nRows == A->nRowCapacity) // double the rows
+			{
+				rows = (AMR_ROW*)realloc(A->rows, (A->nRowCapacity > 0 ? 2 * A->nRowCapacity : 1024) * sizeof(AMR_ROW));
+				if (rows == NULL) return false;
+				A->rows = rows;
+				A->nRowCapacity = A->nRowCapacity > 0 ? 2 * A->nRowCapacity : 1024;
+			}
+
+			// an unknown is never on the top, bottom or left wall, so L[0] and L[2] exist; L[1] and L[3] are
+			// missing only on the insulated right wall.  H is on one side, both leaves of that side
+			memset(arm, 0, sizeof(arm));
+			t = 0.0;
+			if (H != NULL && ((H == L[0] && H == L[2]) || (H == L[1] && H == L[3]))) // on a vertical edge of H
+				t = (double)((int32_t)j - H->j0) / (double)(H->j1 - H->j0);
+			else if (H != NULL) // on a horizontal one
+				t = (double)((int32_t)i - H->i0) / (double)(H->i1 - H->i0);
+			if (H != NULL && H == L[0] && H == L[2]) // west: ghost on the west edge of H
+			{
+				e = H->i0;
+				arm[1].q[0] = gridIndex(G, (size_t)e, (size_t)H->j0);
+				arm[1].q[1] = gridIndex(G, (size_t)e, (size_t)H->j1);
+				arm[1].w[0] = 1.0 - t;
+				arm[1].w[1] = t;
+				arm[1].s = t * (1.0 - t) * (double)(H->j1 - H->j0) * (double)(H->j1 - H->j0) * G->dy * G->dy;
+			}
+			else
+			{
+				e = L[0]->i0 > L[2]->i0 ? L[0]->i0 : L[2]->i0;
+				arm[1].q[0] = arm[1].q[1] = gridIndex(G, (size_t)e, j);
+				arm[1].w[0] = 1.0;
+			}
+			arm[1].h = (double)((int32_t)i - e) * G->dx;
+			if (L[1] == NULL) arm[0] = arm[1]; // mirror image across the insulated wall
+			else if (H != NULL && H == L[1] && H == L[3]) // east: ghost on the east edge of H
+			{
+				e = H->i1;
+				arm[0].q[0] = gridIndex(G, (size_t)e, (size_t)H->j0);
+				arm[0].q[1] = gridIndex(G, (size_t)e, (size_t)H->j1);
+				arm[0].w[0] = 1.0 - t;
+				arm[0].w[1] = t;
+				arm[0].s = t * (1.0 - t) * (double)(H->j1 - H->j0) * (double)(H->j1 - H->j0) * G->dy * G->dy;
+				arm[0].h = (double)(e - (int32_t)i) * G->dx;
+			}
+			else
+			{
+				e = L[1]->i1 < L[3]->i1 ? L[1]->i1 : L[3]->i1;
+				arm[0].q[0] = arm[0].q[1] = gridIndex(G, (size_t)e, j);
+				arm[0].w[0] = 1.0;
+				arm[0].h = (double)(e - (int32_t)i) * G->dx;
+			}
+			if (H != NULL && H == L[2] && H == L[3]) // north: ghost on the north edge of H
+			{
+				e = H->j1;
+				arm[2].q[0] = gridIndex(G, (size_t)H->i0, (size_t)e);
+				arm[2].q[1] = gridIndex(G, (size_t)H->i1, (size_t)e);
+				arm[2].w[0] = 1.0 - t;
+				arm[2].w[1] = t;
+				arm[2].s = t * (1.0 - t) * (double)(H->i1 - H->i0) * (double)(H->i1 - H->i0) * G->dx * G->dx;
+			}
+			else
+			{
+				e = L[3] != NULL && L[3]->j1 < L[2]->j1 ? L[3]->j1 : L[2]->j1;
+				arm[2].q[0] = arm[2].q[1] = gridIndex(G, i, (size_t)e);
+				arm[2].w[0] = 1.0;
+			}
+			arm[2].h = (double)(e - (int32_t)j) * G->dy;
+			if (H != NULL && H == L[0] && H == L[1]) // south: ghost on the south edge of H
+			{
+				e = H->j0;
+				arm[3].q[0] = gridIndex(G, (size_t)H->i0, (size_t)e);
+				arm[3].q[1] = gridIndex(G, (size_t)H->i1, (size_t)e);
+				arm[3].w[0] = 1.0 - t;
+				arm[3].w[1] = t;
+				arm[3].s = t * (1.0 - t) * (double)(H->i1 - H->i0) * (double)(H->i1 - H->i0) * G->dx * G->dx;
+			}
+			else
+			{
+				e = L[1] != NULL && L[1]->j0 > L[0]->j0 ? L[1]->j0 : L[0]->j0;
+				arm[3].q[0] = arm[3].q[1] = gridIndex(G, i, (size_t)e);
+				arm[3].w[0] = 1.0;
+			}
+			arm[3].h = (double)((int32_t)j - e) * G->dy;
+
+			c[0] = 2.0 / ((arm[0].h + arm[1].h) * arm[0].h);
+			c[1] = 2.0 / ((arm[0].h + arm[1].h) * arm[1].h);
+			c[2] = 2.0 / ((arm[2].h + arm[3].h) * arm[2].h);
+			c[3] = 2.0 / ((arm[2].h + arm[3].h) * arm[3].h);
+			g = 1.0 - 0.5 * (c[0] * arm[0].s + c[1] * arm[1].s); // a ghost in x takes T'' from the y arms
+			if (g < 0.0) g = 0.0; // only for leaves far taller than wide: keep the row diagonally dominant
+			c[2] *= g;
+			c[3] *= g;
+			g = 1.0 - 0.5 * (c[2] * arm[2].s + c[3] * arm[3].s); // ... and a ghost in y from the x arms
+			if (g < 0.0) g = 0.0;
+			c[0] *= g;
+			c[1] *= g;
+			diag = c[0] + c[1] + c[2] + c[3];
+
+			R = &A->rows[A->nRows++];
+			R->p = gridIndex(G, i, j);
+			R->bHanging = H != NULL;
+			for (n = 0; n < 6; n++)
+			{
+				R->q[n] = R->p;
+				R->w[n] = 0.0;
+			}
+			n = 0;
+			for (k = 0; k < 4; k++)
+			{
+				for (m = 0; m < 2; m++)
+				{
+					if (arm[k].w[m] == 0.0) continue;
+					R->q[n] = arm[k].q[m];
+					R->w[n++] = c[k] * arm[k].w[m] / diag;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Tells whether a case node holds a boundary temperature: the top, bottom and left walls,
+//               and the right wall unless it is insulated (the nodes GetResidualRows leaves out)
+// ARGUMENTS:    G:    the plate grid
+//               SD:   the simulation data for the case
+//               i, j: the node
+// RETURN VALUE: true for a fixed wall node
+bool isFixedNode(const PLATEGRID* G, const SIMULATION_DATA* SD, size_t i, size_t j)
+{
+	return j == 0 || j == G->J - 1 || i == 0 || (i == G->I - 1 && SD->bc[RIGHT].nType != BC_TYPE_INSULATED);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One SOR sweep over the composite grid in row order (omega 1 = Gauss-Seidel), hanging nodes
+//               are only relaxed by Gauss-Seidel
+// ARGUMENTS:    G:     the plate grid
+//               A:     the mesh
+//               omega: relaxation factor
+// RETURN VALUE: none
+void SweepAmr(PLATEGRID* G, const AMR_MESH* A, double omega)
+{
+	double* T = G->T_fd;   // the field
+	const AMR_ROW* R;      // a row
+	double v;              // the stencil value
+	size_t r;              // row counter
+
+	for (r = 0; r < A->nRows; r++)
+	{
+		R = &A->rows[r];
+		v = R->w[0] * T[R->q[0]] + R->w[1] * T[R->q[1]] + R->w[2] * T[R->q[2]] + R->w[3] * T[R->q[3]] +
+			R->w[4] * T[R->q[4]] + R->w[5] * T[R->q[5]];
+		T[R->p] += (R->bHanging ? 1.0 : omega) * (v - T[R->p]);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Residual |sum of w T - T| of the composite grid, in the same units as GetResidual, with the
+//               RMS taken over its unknowns
+// ARGUMENTS:    G:    the plate grid
+//               A:    the mesh
+//               rmax: returns the largest residual
+//               RMS:  returns the RMS residual
+// RETURN VALUE: none
+void GetAmrResidual(const PLATEGRID* G, const AMR_MESH* A, double* rmax, double* RMS)
+{
+	const double* T = G->T_fd; // the field
+	const AMR_ROW* R;      // a row
+	double r;              // residual of a row
+	double sumSq = 0.0;    // sum of squared residuals
+	size_t n;              // row counter
+
+	*rmax = 0.0;
+	for (n = 0; n < A->nRows; n++)
+	{
+		R = &A->rows[n];
+		r = fabs(R->w[0] * T[R->q[0]] + R->w[1] * T[R->q[1]] + R->w[2] * T[R->q[2]] + R->w[3] * T[R->q[3]] +
+			R->w[4] * T[R->q[4]] + R->w[5] * T[R->q[5]] - T[R->p]);
+		if (r > *rmax) *rmax = r;
+		sumSq += r * r;
+	}
+	*RMS = sqrt(sumSq / (double)(A->nRows > 0 ? A->nRows : 1));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Fills every case node that is neither a composite node nor a fixed wall node with the
+//               bilinear interpolation of the corners of a leaf that holds it.  The leaves go coarsest
+//               first, so a node on an edge between a leaf and smaller ones ends up interpolated between
+//               the nearest composite nodes along that edge
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for the case
+//               A:  the mesh (bNode current)
+// RETURN VALUE: none
+void ResampleAmr(PLATEGRID* G, const SIMULATION_DATA* SD, const AMR_MESH* A)
+{
+	const AMR_CELL* C;     // a leaf
+	double T00, T10, T01, T11; // its corner temperatures
+	double s, t;           // position in the leaf
+	int32_t i, j;          // case node counters
+	size_t c;              // cell counter
+	int d;                 // depth counter
+
+	for (d = 0; d <= A->nDepth; d++)
+	{
+		for (c = 0; c < A->nCells; c++)
+		{
+			C = &A->cells[c];
+			if (C->iChild >= 0 || C->nDepth != d) continue;
+			T00 = G->T_fd[gridIndex(G, (size_t)C->i0, (size_t)C->j0)];
+			T10 = G->T_fd[gridIndex(G, (size_t)C->i1, (size_t)C->j0)];
+			T01 = G->T_fd[gridIndex(G, (size_t)C->i0, (size_t)C->j1)];
+			T11 = G->T_fd[gridIndex(G, (size_t)C->i1, (size_t)C->j1)];
+			for (j = C->j0; j <= C->j1; j++)
+			{
+				t = (double)(j - C->j0) / (double)(C->j1 - C->j0);
+				for (i = C->i0; i <= C->i1; i++)
+				{
+					if (A->bNode[(size_t)j * G->I + (size_t)i] || isFixedNode(G, SD, (size_t)i, (size_t)j)) continue;
+					s = (double)(i - C->i0) / (double)(C->i1 - C->i0);
+					G->T_fd[gridIndex(G, (size_t)i, (size_t)j)] = (1.0 - t) * ((1.0 - s) * T00 + s * T10) +
+						t * ((1.0 - s) * T01 + s * T11);
+				}
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Splits the leaves the last pass flags, then keeps the tree 2:1 balanced (no leaf has an edge
+//               neighbour more than one level deeper).  res holds the case-grid residual of the resampled
+//               field.  A kink of slope jump s across a leaf edge leaves r = h s / (2 (1 + lamda)) at the
+//               case nodes on it (h = dx), and s is about the leaf width H times the curvature, so the
+//               interpolation error H^2 T''/8 of the leaf is about (1 + lamda) r H / (4 h): that estimate,
+//               with the largest r on the leaf's closed rectangle and H in case cells, is held against
+//               AMR_TOLERANCE.  AMR_GRADIENT also splits leaves whose corners differ by more than it
+// ARGUMENTS:    G:  the plate grid (res filled)
+//               SD: the simulation data for the case
+//               A:  the mesh, refined and its leaf map updated
+// RETURN VALUE: leaves split, -1 if out of memory
+int RefineAmrMesh(const PLATEGRID* G, const SIMULATION_DATA* SD, AMR_MESH* A)
+{
+	double lamda = (SD->dx / SD->dy) * (SD->dx / SD->dy); // (dx/dy)^2
+	double tolerance = SD->solver.amrTolerance > 0.0 ? SD->solver.amrTolerance : AMR_TOLERANCE;
+	size_t Mx = G->I - 1, My = G->J - 1; // case cells in x and y
+	size_t c, nCells;      // cell counter, cells before the splits
+	int32_t i, j;          // case node counters
+	int32_t w;             // larger side of a leaf in case cells
+	double r;              // largest residual on a leaf
+	double Tmin, Tmax, T;  // corner temperatures of a leaf
+	int nSplit = 0;        // leaves split
+	int nMarked;           // leaves marked in a round
+	AMR_CELL* C;           // a leaf
+	const AMR_CELL* N;     // a neighbour
+
+	for (c = 0; c < A->nCells; c++) // flag the leaves
+	{
+		C = &A->cells[c];
+		if (C->iChild >= 0 || (C->i1 - C->i0 < 2 && C->j1 - C->j0 < 2)) continue;
+		r = 0.0;
+		for (j = C->j0; j <= C->j1; j++)
+			for (i = C->i0; i <= C->i1; i++) if (G->res[gridIndex(G, (size_t)i, (size_t)j)] > r) r = G->res[gridIndex(G, (size_t)i, (size_t)j)];
+		w = C->i1 - C->i0 > C->j1 - C->j0 ? C->i1 - C->i0 : C->j1 - C->j0;
+		if ((1.0 + lamda) * r * w / 4.0 > tolerance) C->bSplit = 1;
+		if (SD->solver.amrGradient > 0.0)
+		{
+			Tmin = Tmax = G->T_fd[gridIndex(G, (size_t)C->i0, (size_t)C->j0)];
+			T = G->T_fd[gridIndex(G, (size_t)C->i1, (size_t)C->j0)];
+			Tmin = T < Tmin ? T : Tmin, Tmax = T > Tmax ? T : Tmax;
+			T = G->T_fd[gridIndex(G, (size_t)C->i0, (size_t)C->j1)];
+			Tmin = T < Tmin ? T : Tmin, Tmax = T > Tmax ? T : Tmax;
+			T = G->T_fd[gridIndex(G, (size_t)C->i1, (size_t)C->j1)];
+			Tmin = T < Tmin ? T : Tmin, Tmax = T > Tmax ? T : Tmax;
+			if (Tmax - Tmin > SD->solver.amrGradient) C->bSplit = 1;
+		}
+	}
+	do // split the marked leaves, then mark the ones too coarse next to them
+	{
+		nCells = A->nCells;
+		for (c = 0; c < nCells; c++)
+		{
+			if (!A->cells[c].bSplit) continue;
+			if (!splitAmrCell(A, c)) return -1;
+			nSplit++;
+		}
+		mapAmrLeaves(G, A);
+		nMarked = 0;
+		for (c = 0; c < A->nCells; c++)
+		{
+			C = &A->cells[c];
+			if (C->iChild >= 0 || (C->i1 - C->i0 < 2 && C->j1 - C->j0 < 2)) continue;
+			for (j = C->j0; j < C->j1 && !C->bSplit; j++) // west and east neighbours
+			{
+				if (C->i0 > 0) N = &A->cells[A->leafOf[(size_t)j * Mx + (size_t)C->i0 - 1]];
+				if (C->i0 > 0 && N->nDepth > C->nDepth + 1) C->bSplit = 1;
+				if ((size_t)C->i1 < Mx) N = &A->cells[A->leafOf[(size_t)j * Mx + (size_t)C->i1]];
+				if ((size_t)C->i1 < Mx && N->nDepth > C->nDepth + 1) C->bSplit = 1;
+			}
+			for (i = C->i0; i < C->i1 && !C->bSplit; i++) // south and north neighbours
+			{
+				if (C->j0 > 0) N = &A->cells[A->leafOf[((size_t)C->j0 - 1) * Mx + (size_t)i]];
+				if (C->j0 > 0 && N->nDepth > C->nDepth + 1) C->bSplit = 1;
+				if ((size_t)C->j1 < My) N = &A->cells[A->leafOf[(size_t)C->j1 * Mx + (size_t)i]];
+				if ((size_t)C->j1 < My && N->nDepth > C->nDepth + 1) C->bSplit = 1;
+			}
+			nMarked += C->bSplit;
+		}
+	} while (nMarked > 0);
+
+	return nSplit;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Called by SolvePlate after every iteration.  When the case is checkpointing, appends the
+//               residuals to the history and writes a snapshot every CHECKPOINT iterations, every
+//               CHECKPOINT_SECONDS of wall time, and when a stop signal has arrived.  The snapshot holds 
+//               everything the GS, SOR and multigrid iterations depend on, so a resumed solve repeats the
+//               remaining iterations exactly (PCG restarts its search direction from the saved field)
+// ARGUMENTS:    G:         the plate grid
+//               SD:        the simulation data for the case
+//               ck:        the checkpoint state
+//               rmax, RMS: residuals after the iteration
+//               seconds:   wall time since the solve started
+//               iter:      iterations done
+// RETURN VALUE: HTS_OK, HTS_ERROR_INTERRUPTED once a stop signal has arrived, HTS_ERROR_MEMORY
+int UpdateCheckpoint(const PLATEGRID* G, const SIMULATION_DATA* SD, CHECKPOINT* ck, double rmax, double RMS, double seconds, int iter)
+{
+	CONVERGENCE_RECORD* records; // grown history
+	bool bSave;                  // write a snapshot now
+
+	if (!isCheckpointing(&SD->solver) && !ck->bKeepHistory) return nStopSignal != 0 ? HTS_ERROR_INTERRUPTED : HTS_OK;
+	if (ck->nRecords == ck->nCapacity) // double the history
+	{
+		records = (CONVERGENCE_RECORD*)realloc(ck->records, 
+			(ck->nCapacity > 0 ? 2 * ck->nCapacity : CONVERGENCE_BLOCK) * sizeof(CONVERGENCE_RECORD));
+		if (records == NULL && isCheckpointing(&SD->solver)) return HTS_ERROR_MEMORY;
+		if (records == NULL) // only the cache wanted it: solve on, without storing the result
+		{
+			FreeCheckpoint(ck);
+			ck->bKeepHistory = false;
+			return nStopSignal != 0 ? HTS_ERROR_INTERRUPTED : HTS_OK;
+		}
+		ck->records = records;
+		ck->nCapacity = ck->nCapacity > 0 ? 2 * ck->nCapacity : CONVERGENCE_BLOCK;
+	}
+	ck->records[ck->nRecords].rmax = rmax;
+	ck->records[ck->nRecords].RMS = RMS;
+	ck->records[ck->nRecords].seconds = seconds;
+	ck->records[ck->nRecords].iter = iter;
+	ck->nRecords++;
+
+	if (!isCheckpointing(&SD->solver)) return nStopSignal != 0 ? HTS_ERROR_INTERRUPTED : HTS_OK;
+	bSave = nStopSignal != 0;
+	if (ck->nInterval > 0 && iter - ck->iterSaved >= ck->nInterval) bSave = true;
+	if (ck->seconds > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - ck->lastSave).count() >= ck->seconds)
+		bSave = true;
+	if (bSave && !WriteCheckpoint(G, SD, ck, iter)) ck->bWriteFailed = true;
+
+	return nStopSignal != 0 ? HTS_ERROR_INTERRUPTED : HTS_OK;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Writes a snapshot: CHECKPOINT_HEADER, the T_fd plane and the convergence history.  It goes
+//               to a temporary file that then replaces the checkpoint, so a run killed while writing
+//               leaves the previous snapshot intact
+// ARGUMENTS:    G:    the plate grid
+//               SD:   the simulation data for the case
+//               ck:   the checkpoint state
+//               iter: iterations done
+// RETURN VALUE: false if the file cannot be written
+bool WriteCheckpoint(const PLATEGRID* G, const SIMULATION_DATA* SD, CHECKPOINT* ck, int iter)
+{
+	CHECKPOINT_HEADER header = {}; // zeroed, so the reserved field is written as zero
+	char strTempFile[MAX_BUFF_SIZE + 4]; // the snapshot being written
+	size_t nValues = G->stride * G->J; // doubles in the plane
+	FILE* fout = NULL;
+	errno_t err;
+	bool bOk;
+
+	memcpy(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_FILE_VERSION;
+	header.nSolver = SD->solver.nSolver;
+	header.I = G->I;
+	header.J = G->J;
+	header.stride = G->stride;
+	header.dx = G->dx;
+	header.dy = G->dy;
+	header.iter = iter;
+	header.nRecords = ck->nRecords;
+
+	sprintf_s(strTempFile, sizeof(strTempFile), "%s.tmp", ck->strFile);
+	err = fopen_s(&fout, strTempFile, "wb");
+	if (err != 0 || fout == NULL) return false;
+	bOk = fwrite(&header, sizeof(header), 1, fout) == 1;
+	bOk = bOk && fwrite(G->T_fd, sizeof(double), nValues, fout) == nValues;
+	bOk = bOk && fwrite(ck->records, sizeof(CONVERGENCE_RECORD), ck->nRecords, fout) == ck->nRecords;
+	bOk = fclose(fout) == 0 && bOk;
+	if (bOk && rename(strTempFile, ck->strFile) != 0) // Windows does not replace an existing file
+	{
+		remove(ck->strFile);
+		bOk = rename(strTempFile, ck->strFile) == 0;
+	}
+	if (!bOk)
+	{
+		remove(strTempFile);
+		return false;
+	}
+	ck->iterSaved = iter;
+	ck->lastSave = std::chrono::steady_clock::now();
+	ck->bSaved = true;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Reads the snapshot of a resumed case into T_fd and the checkpoint state.  Only the nodes
+//               the solver updates are taken from the file, so the boundary conditions always come from
+//               simulations.in.  A snapshot of a different grid is ignored
+// ARGUMENTS:    G:  the plate grid (boundary conditions set)
+//               SD: the simulation data for the case
+//               ck: the checkpoint state, strFile set
+// RETURN VALUE: true if the solve continues from the snapshot
+bool LoadCheckpoint(PLATEGRID* G, const SIMULATION_DATA* SD, CHECKPOINT* ck)
+{
+	CHECKPOINT_HEADER header;  // the snapshot's header
+	double* plane = NULL;      // the snapshot's T_fd
+	size_t nValues = G->stride * G->J; // doubles in the plane
+	size_t iLast = SD->bc[RIGHT].nType == BC_TYPE_INSULATED ? G->I - 1 : G->I - 2; // last updated column
+	size_t j;                  // row counter
+	FILE* fin = NULL;
+	errno_t err;
+	bool bOk;
+
+	err = fopen_s(&fin, ck->strFile, "rb");
+	if (err != 0 || fin == NULL) return false; // nothing to resume, start from scratch
+	bOk = fread(&header, sizeof(header), 1, fin) == 1 && memcmp(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+		header.version == CHECKPOINT_FILE_VERSION && header.I == G->I && header.J == G->J && header.stride == G->stride &&
+		header.dx == G->dx && header.dy == G->dy && header.iter >= 0 && header.nRecords <= (uint64_t)header.iter;
+	if (bOk)
+	{
+		plane = (double*)malloc(nValues * sizeof(double));
+		ck->records = (CONVERGENCE_RECORD*)malloc((size_t)(header.nRecords > 0 ? header.nRecords : 1) * sizeof(CONVERGENCE_RECORD));
+		bOk = plane != NULL && ck->records != NULL && fread(plane, sizeof(double), nValues, fin) == nValues &&
+			fread(ck->records, sizeof(CONVERGENCE_RECORD), (size_t)header.nRecords, fin) == header.nRecords;
+	}
+	fclose(fin);
+	if (!bOk)
+	{
+		reportf("\nIgnoring \"%s\", it does not belong to this grid or cannot be read", ck->strFile);
+		free(plane);
+		FreeCheckpoint(ck);
+		return false;
+	}
+	for (j = 1; j < G->J - 1; j++)
+		memcpy(G->T_fd + gridIndex(G, 1, j), plane + gridIndex(G, 1, j), iLast * sizeof(double));
+	free(plane);
+	ck->nRecords = ck->nCapacity = (size_t)header.nRecords;
+	ck->iterStart = ck->iterSaved = header.iter;
+	ck->lastSave = std::chrono::steady_clock::now();
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees the convergence history of a checkpoint state
+// ARGUMENTS:    ck: the checkpoint state
+// RETURN VALUE: none
+void FreeCheckpoint(CHECKPOINT* ck)
+{
+	free(ck->records);
+	ck->records = NULL;
+	ck->nRecords = ck->nCapacity = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Fills the cache key of a case: everything that decides its converged field.  Threads and
+//               SIMD kernels give bit-identical results and are left out, so they share entries
+// ARGUMENTS:    SD:  the simulation data of the case
+//               key: returns the key (zeroed first, so the reserved field and any padding hash the same)
+// RETURN VALUE: none
+void makeCacheKey(const SIMULATION_DATA* SD, CACHE_KEY* key)
+{
+	int n; // wall counter
+
+	memset(key, 0, sizeof(CACHE_KEY));
+	key->w = SD->w;
+	key->h = SD->h;
+	key->dx = SD->dx;
+	key->dy = SD->dy;
+	for (n = 0; n < NUM_WALLS; n++)
+	{
+		key->bcType[n] = SD->bc[n].nType;
+		key->bc[n][0] = SD->bc[n].Ta;
+		key->bc[n][1] = SD->bc[n].Tb;
+		key->bc[n][2] = SD->bc[n].za;
+		key->bc[n][3] = SD->bc[n].zb;
+		key->bc[n][4] = SD->bc[n].ma;
+		key->bc[n][5] = SD->bc[n].mb;
+		key->bc[n][6] = SD->bc[n].k;
+	}
+	key->nSolver = SD->solver.nSolver;
+	key->nPrecond = SD->solver.nPrecond;
+	key->bFused = SD->solver.bFused;
+	key->nTileSweeps = SD->solver.nTileSweeps;
+	key->nTileWidth = SD->solver.nTileWidth;
+	key->nWarmStart = SD->solver.nWarmStart;
+	key->maxIter = SD->solver.nMaxIter > 0 ? SD->solver.nMaxIter : MAX_ITER;
+	key->bMixed = SD->solver.bMixed;
+	key->nLines = SD->solver.nLines;
+	key->nTransient = SD->solver.nTransient;
+	key->omega = SD->solver.omega;
+	key->tolerance = MAX_RESIDUAL;
+	if (SD->solver.nTransient != TRANSIENT_NONE) // ignored without a march
+	{
+		key->timeStep = SD->solver.timeStep;
+		key->diffusivity = SD->solver.diffusivity;
+		key->endTime = SD->solver.endTime;
+		key->frameTime = SD->solver.frameTime;
+	}
+	key->nAmrLevels = SD->solver.nAmrLevels;
+	if (SD->solver.nAmrLevels > 0) // ignored on the uniform grid
+	{
+		key->amrTolerance = SD->solver.amrTolerance;
+		key->amrGradient = SD->solver.amrGradient;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  64-bit FNV-1a hash
+// ARGUMENTS:    p: the bytes
+//               n: number of bytes
+// RETURN VALUE: the hash
+uint64_t hashBytes(const void* p, size_t n)
+{
+	const unsigned char* b = (const unsigned char*)p; // the bytes
+	uint64_t hash = 14695981039346656037ull;           // FNV offset basis
+	size_t i;                                          // counter
+
+	for (i = 0; i < n; i++)
+	{
+		hash ^= b[i];
+		hash *= 1099511628211ull; // FNV prime
+	}
+	return hash;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Looks a case up in the solution cache.  On a hit T_fd and res are loaded, the convergence
+//               history is replayed into the log and the entry becomes the most recently used.  The whole 
+//               entry is checked (full key, grid and file size) before anything in G is touched, so a
+//               hash collision or a truncated file is just a miss
+// ARGUMENTS:    G:     the plate grid (boundary conditions set)
+//               SD:    the simulation data of the case
+//               log:   the convergence log
+//               pInfo: returns the iterations and residuals of the cached solve
+// RETURN VALUE: true on a hit
+bool LoadCachedSolution(PLATEGRID* G, const SIMULATION_DATA* SD, CONVERGENCE_LOG* log, SOLVE_INFO* pInfo)
+{
+	CACHE_KEY key;                   // the case's key
+	CACHE_FILE_HEADER header;        // the entry's header
+	CONVERGENCE_RECORD* records = NULL; // the entry's history
+	size_t nValues = G->stride * G->J; // doubles in a plane
+	std::error_code ec;              // filesystem errors are misses
+	char strFile[MAX_BUFF_SIZE];     // the entry
+	FILE* fin = NULL;
+	errno_t err;
+	bool bOk;
+	size_t n;                        // counter
+
+	makeCacheKey(SD, &key);
+	sprintf_s(strFile, MAX_BUFF_SIZE, "%s/%016llx.htc", SOLUTION_CACHE_DIR, (unsigned long long)hashBytes(&key, sizeof(key)));
+	err = fopen_s(&fin, strFile, "rb");
+	if (err != 0 || fin == NULL) return false;
+	bOk = fread(&header, sizeof(header), 1, fin) == 1 && memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+		header.version == CACHE_FILE_VERSION && memcmp(&header.key, &key, sizeof(key)) == 0 &&
+		header.I == G->I && header.J == G->J && header.stride == G->stride && header.nRecords <= (uint64_t)header.iter &&
+		std::filesystem::file_size(strFile, ec) == sizeof(header) + 2 * nValues * sizeof(double) + header.nRecords * sizeof(CONVERGENCE_RECORD);
+	if (bOk)
+	{
+		records = (CONVERGENCE_RECORD*)malloc((size_t)(header.nRecords > 0 ? header.nRecords : 1) * sizeof(CONVERGENCE_RECORD));
+		bOk = records != NULL && fread(G->T_fd, sizeof(double), nValues, fin) == nValues &&
+			fread(G->res, sizeof(double), nValues, fin) == nValues &&
+			fread(records, sizeof(CONVERGENCE_RECORD), (size_t)header.nRecords, fin) == header.nRecords;
+	}
+	fclose(fin);
+	if (!bOk)
+	{
+		free(records);
+		return false; // T_fd is rewritten by the solve that follows, res by its residual passes
+	}
+	for (n = 0; n < header.nRecords; n++) logConvergence(log, records[n].rmax, records[n].RMS, records[n].seconds, records[n].iter);
+	free(records);
+	std::filesystem::last_write_time(strFile, std::filesystem::file_time_type::clock::now(), ec); // least recently used last
+
+	pInfo->iter = header.iter;
+	pInfo->rmax = header.rmax;
+	pInfo->RMS = header.RMS;
+	pInfo->bConverged = header.bConverged != 0;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Whether the solution cache has an entry for a case (header check only), so work that a hit
+//               would throw away, such as a warm start, can be skipped
+// ARGUMENTS:    SD: the simulation data of the case
+// RETURN VALUE: true if there is an entry with the case's key
+bool hasCachedSolution(const SIMULATION_DATA* SD)
+{
+	CACHE_KEY key;                   // the case's key
+	CACHE_FILE_HEADER header;        // the entry's header
+	char strFile[MAX_BUFF_SIZE];     // the entry
+	FILE* fin = NULL;
+	errno_t err;
+	bool bFound;
+
+	makeCacheKey(SD, &key);
+	sprintf_s(strFile, MAX_BUFF_SIZE, "%s/%016llx.htc", SOLUTION_CACHE_DIR, (unsigned long long)hashBytes(&key, sizeof(key)));
+	err = fopen_s(&fin, strFile, "rb");
+	if (err != 0 || fin == NULL) return false;
+	bFound = fread(&header, sizeof(header), 1, fin) == 1 && memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+		header.version == CACHE_FILE_VERSION && memcmp(&header.key, &key, sizeof(key)) == 0;
+	fclose(fin);
+	return bFound;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Adds a solved case to the solution cache.  The entry is written under a name no other 
+//               thread or process uses and then renamed into place, so readers only ever see complete
+//               entries; if another process stored the same key first its entry is kept.  Then the least
+//               recently used entries are evicted until the cache fits in CACHE_MB
+// ARGUMENTS:    G:     the solved grid (res filled)
+//               SD:    the simulation data of the case
+//               ck:    holds the convergence history of the solve
+//               pInfo: the iterations and residuals of the solve
+// RETURN VALUE: false if the entry cannot be written
+bool StoreCachedSolution(const PLATEGRID* G, const SIMULATION_DATA* SD, const CHECKPOINT* ck, const SOLVE_INFO* pInfo)
+{
+	CACHE_FILE_HEADER header = {};   // zeroed, so the reserved field is written as zero
+	size_t nValues = G->stride * G->J; // doubles in a plane
+	std::error_code ec;              // filesystem errors
+	char strFile[MAX_BUFF_SIZE];     // the entry
+	char strTempFile[MAX_BUFF_SIZE + TEMP_SUFFIX_SIZE]; // the entry while it is written
+	FILE* fout = NULL;
+	errno_t err;
+	bool bOk;
+
+	memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic));
+	header.version = CACHE_FILE_VERSION;
+	header.iter = pInfo->iter;
+	makeCacheKey(SD, &header.key);
+	header.I = G->I;
+	header.J = G->J;
+	header.stride = G->stride;
+	header.nRecords = ck->nRecords;
+	header.rmax = pInfo->rmax;
+	header.RMS = pInfo->RMS;
+	header.bConverged = pInfo->bConverged;
+
+	std::filesystem::create_directories(SOLUTION_CACHE_DIR, ec);
+	sprintf_s(strFile, MAX_BUFF_SIZE, "%s/%016llx.htc", SOLUTION_CACHE_DIR, (unsigned long long)hashBytes(&header.key, sizeof(header.key)));
+	// steady clock ticks and the thread make the temporary name unique across threads and processes
+	sprintf_s(strTempFile, sizeof(strTempFile), "%s.%llx.%zx.tmp", strFile,
+		(unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count(), std::hash<std::thread::id>()(std::this_thread::get_id()));
+	err = fopen_s(&fout, strTempFile, "wb");
+	if (err != 0 || fout == NULL) return false;
+	bOk = fwrite(&header, sizeof(header), 1, fout) == 1;
+	bOk = bOk && fwrite(G->T_fd, sizeof(double), nValues, fout) == nValues;
+	bOk = bOk && fwrite(G->res, sizeof(double), nValues, fout) == nValues;
+	bOk = bOk && fwrite(ck->records, sizeof(CONVERGENCE_RECORD), ck->nRecords, fout) == ck->nRecords;
+	bOk = fclose(fout) == 0 && bOk;
+	if (!bOk)
+	{
+		remove(strTempFile);
+		return false;
+	}
+	std::filesystem::rename(strTempFile, strFile, ec); // atomic on POSIX; on Windows fails if the entry exists
+	if (ec) remove(strTempFile);                       // and then the existing (identical) entry stays
+	evictSolutionCache((uint64_t)(SD->solver.nCacheMB > 0 ? SD->solver.nCacheMB : DEFAULT_CACHE_MB) << 20);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Deletes the least recently used cache entries, solutions and factors alike (oldest 
+//               modification time, which a hit refreshes) until the entries take at most maxBytes.  Entries
+//               that another process has already deleted, or that are open, are skipped
+// ARGUMENTS:    maxBytes: size limit of the cache
+// RETURN VALUE: none
+void evictSolutionCache(uint64_t maxBytes)
+{
+	std::vector<CACHE_ENTRY> entries; // the .htc and .hcf files
+	std::error_code ec;               // filesystem errors, entries that vanish are ignored
+	uint64_t total = 0;               // bytes in the cache
+	size_t n;                         // counter
+
+	for (std::filesystem::directory_iterator it(SOLUTION_CACHE_DIR, ec), end; !ec && it != end; it.increment(ec))
+	{
+		CACHE_ENTRY e;
+		if (it->path().extension() != ".htc" && it->path().extension() != ".hcf") continue;
+		e.path = it->path();
+		e.size = it->file_size(ec);
+		if (ec) continue;
+		e.time = it->last_write_time(ec);
+		if (ec) continue;
+		total += e.size;
+		entries.push_back(e);
+	}
+	if (total <= maxBytes) return;
+	std::sort(entries.begin(), entries.end(), [](const CACHE_ENTRY& a, const CACHE_ENTRY& b) { return a.time < b.time; });
+	for (n = 0; n < entries.size() && total > maxBytes; n++)
+	{
+		if (std::filesystem::remove(entries[n].path, ec)) total -= entries[n].size;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Whether a case writes checkpoint snapshots (CHECKPOINT or CHECKPOINT_SECONDS set)
+// ARGUMENTS:    pSolver: the solver data of the case
+// RETURN VALUE: true if it does
+bool isCheckpointing(const SOLVER_DATA* pSolver)
+{
+	return pSolver->nCheckpointIter > 0 || pSolver->checkpointSeconds > 0.0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Lets SIGINT and SIGTERM stop the solvers at the end of the current iteration, after a 
+//               last snapshot, instead of killing the process.  Nothing is installed unless one of the 
+//               cases is checkpointing, so Ctrl+C behaves as before for everything else
+// ARGUMENTS:    SD: the cases that will run
+//               NS: the number of cases
+// RETURN VALUE: none
+void installStopHandlers(const SIMULATION_DATA* SD, int NS)
+{
+	int n; // counter
+
+	for (n = 0; n < NS; n++)
+	{
+		if (!isCheckpointing(&SD[n].solver)) continue;
+		signal(SIGINT, requestStop);
+		signal(SIGTERM, requestStop);
+		return;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Signal handler of SIGINT and SIGTERM: only records the signal, the solver loops poll it
+// ARGUMENTS:    nSignal: the signal
+// RETURN VALUE: none
+void requestStop(int nSignal)
+{
+	nStopSignal = nSignal;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One lexicographic Gauss-Seidel sweep over the interior nodes (and the insulated right wall)
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+// RETURN VALUE: none
+void SweepGaussSeidel(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda)
+{
+	int I = (int)G->I; // number of nodes in x
+	int J = (int)G->J; // number of nodes in y
+	int i = 0, j = 0; // counters 
+	size_t s = G->stride; // distance between vertically adjacent nodes
+	double* T, * Tn, * Ts; // current, north and south rows of T_fd
+
+	for (j = 1; j < J - 1; j++) // sweeping through the nodes vertically 
+	{
+		T = G->T_fd + j * s; // row j and its neighbours are contiguous runs of I doubles
+		Tn = T + s;
+		Ts = T - s;
+		for (i = 1; i < I - 1; i++) // sweeping through the nodes horizontally 
+		{
+			// calculates value for temperature finite difference by using the formula found in 
+			//finite difference laplace.pdf
+			T[i] = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) / (2.0 * (1.0 + lamda));
+		}
+		if (SD->bc[RIGHT].nType == BC_TYPE_INSULATED) // special formula used for insulated right wall
+		{
+			T[I - 1] = (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1])) / (2.0 * (1.0 + lamda));
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Lexicographic Gauss-Seidel sweep that also returns the residual, so no second pass over 
+//               the grid is needed.  A node's residual is taken just before it is updated (it is the size of
+//               the update), i.e. with its west and south neighbours already new.  res is not written
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+//               rmax:  returns the largest residual
+//               RMS:   returns the RMS residual
+// RETURN VALUE: none
+void SweepGaussSeidelFused(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double* rmax, double* RMS)
+{
+	int I = (int)G->I; // number of nodes in x
+	int J = (int)G->J; // number of nodes in y
+	int i = 0, j = 0; // counters 
+	size_t s = G->stride; // distance between vertically adjacent nodes
+	double* T, * Tn, * Ts; // current, north and south rows of T_fd
+	double Tnew, r; // updated node, size of the update
+	double rm = 0.0, sumSq = 0.0; // largest and sum of squared residuals (locals, they cannot alias T)
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight, a multiply keeps the divide off the i-1 chain
+
+	for (j = 1; j < J - 1; j++)
+	{
+		T = G->T_fd + j * s;
+		Tn = T + s;
+		Ts = T - s;
+		for (i = 1; i < I - 1; i++)
+		{
+			Tnew = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c;
+			r = fabs(Tnew - T[i]);
+			rm = r > rm ? r : rm;
+			sumSq += r * r;
+			T[i] = Tnew;
+		}
+		if (SD->bc[RIGHT].nType == BC_TYPE_INSULATED)
+		{
+			Tnew = (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1])) * c;
+			r = fabs(Tnew - T[I - 1]);
+			rm = r > rm ? r : rm;
+			sumSq += r * r;
+			T[I - 1] = Tnew;
+		}
+	}
+	*rmax = rm;
+	*RMS = sqrt(sumSq / (((double)G->I - 2) * ((double)G->J - 2)));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One red-black SOR sweep: all nodes with (i + j) even are over-relaxed first, then all 
+//               nodes with (i + j) odd.  Every node of one colour only has neighbours of the other colour,
+//               so the order inside a colour does not matter.  The insulated right wall is relaxed with 
+//               its colour using the same ghost-node formula as Gauss-Seidel
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+//               omega: relaxation factor (1 = red-black Gauss-Seidel)
+//               rmax:  NULL, or returns the largest pre-update residual of the sweep (fused residual)
+//               RMS:   returns the RMS of the pre-update residuals when rmax is not NULL
+// RETURN VALUE: none
+void SweepRedBlackSOR(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double omega, double* rmax, double* RMS)
+{
+	int color; // 0 = red (i + j even), 1 = black
+	double sumSq = 0.0; // sum of squared residuals
+
+	if (rmax != NULL) *rmax = 0.0;
+	for (color = 0; color < 2; color++)
+		RelaxRedBlackRows(G, SD, lamda, omega, color, 1, G->J - 1, rmax, rmax != NULL ? &sumSq : NULL);
+	if (rmax != NULL) *RMS = sqrt(sumSq / (((double)G->I - 2) * ((double)G->J - 2)));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Over-relaxes the nodes of one colour in rows j0 <= j < j1.  Nodes of one colour never 
+//               read each other, so any split of the rows can run concurrently
+// ARGUMENTS:    G:      the plate grid
+//               SD:     the simulation data for the selected case
+//               lamda:  (dx/dy)^2
+//               omega:  relaxation factor
+//               color:  0 = red (i + j even), 1 = black
+//               j0, j1: first row and one past the last row
+//               rmax:   NULL, or the largest residual so far, raised by the pre-update residuals of these nodes
+//               sumSq:  sum of squared residuals so far, increased likewise (unused when rmax is NULL)
+// RETURN VALUE: none
+void RelaxRedBlackRows(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double omega, int color,
+	size_t j0, size_t j1, double* rmax, double* sumSq)
+{
+	int I = (int)G->I; // number of nodes in x
+	int j = 0; // counter
+	size_t s = G->stride; // distance between vertically adjacent nodes
+	double* T, * Tn, * Ts; // current, north and south rows of T_fd
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	double r; // pre-update residual of the insulated wall node
+	bool bInsulated = SD->bc[RIGHT].nType == BC_TYPE_INSULATED;
+	const STENCIL_KERNELS* K = GetStencilKernels(SD->solver.nSimd);
+
+	for (j = (int)j0; j < (int)j1; j++)
+	{
+		T = G->T_fd + j * s;
+		Tn = T + s;
+		Ts = T - s;
+		// nodes of this colour in row j have i % 2 == (color + j) % 2
+		if (rmax != NULL) K->relaxResidualRow(T, Tn, Ts, G->I, (color + j) % 2, lamda, omega, rmax, sumSq);
+		else K->relaxRow(T, Tn, Ts, G->I, (color + j) % 2, lamda, omega);
+		if (bInsulated && (I - 1 + j) % 2 == color)
+		{
+			r = (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1])) * c - T[I - 1];
+			T[I - 1] += omega * r;
+			if (rmax != NULL && fabs(r) > *rmax) *rmax = fabs(r);
+			if (rmax != NULL) *sumSq += r * r;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Computes the optimal SOR factor for the 5-point stencil on the rectangle.  The Jacobi 
+//               spectral radius is rho = (cos(pi/(I-1)) + lamda*cos(pi/(J-1))) / (1 + lamda); an insulated
+//               right wall doubles the effective width in x.  omega = 2 / (1 + sqrt(1 - rho^2))
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+// RETURN VALUE: omega
+double GetOptimalOmega(const PLATEGRID* G, const SIMULATION_DATA* SD, double lamda)
+{
+	double Mx = (double)G->I - 1.0; // number of cells in x
+	double My = (double)G->J - 1.0; // number of cells in y
+	double rho;                     // Jacobi spectral radius
+
+	if (SD->bc[RIGHT].nType == BC_TYPE_INSULATED) Mx *= 2.0; // mirror image across the insulated wall
+	rho = (cos(PI / Mx) + lamda * cos(PI / My)) / (1.0 + lamda);
+
+	return 2.0 / (1.0 + sqrt(1.0 - rho * rho));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Runs nTileSweeps Gauss-Seidel or red-black SOR sweeps in one pass over the plate, so a band
+//               of rows (and with TILE_WIDTH, a strip of columns) is relaxed several times while it is 
+//               still in cache.  A stage is one sweep (GS) or one colour of a sweep (SOR).  Stage s works 
+//               on row k - s while the wavefront is at row k, and each stage of a strip is shifted one 
+//               column left of the stage before, so every node sees exactly the neighbour values it would
+//               see in nTileSweeps plain sweeps and the result is identical to them
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+//               omega: SOR relaxation factor (unused for GS)
+//               rmax:  NULL, or returns the largest pre-update residual of the last sweep (fused residual)
+//               RMS:   returns the RMS of those residuals when rmax is not NULL
+// RETURN VALUE: none
+void SweepTiled(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double omega, double* rmax, double* RMS)
+{
+	bool bRedBlack = SD->solver.nSolver == SOLVER_SOR;
+	long nStagesPerSweep = bRedBlack ? 2 : 1; // colours per sweep
+	long nStages = SD->solver.nTileSweeps * nStagesPerSweep; // stages per pass
+	long nFirstFused = rmax != NULL ? nStages - nStagesPerSweep : nStages; // stages of the last sweep reduce
+	long J = (long)G->J; // number of nodes in y
+	long iEnd = SD->bc[RIGHT].nType == BC_TYPE_INSULATED ? (long)G->I : (long)G->I - 1; // past the last unknown
+	long W = SD->solver.nTileWidth > 0 ? SD->solver.nTileWidth : iEnd + nStages; // strip width
+	long nStrips = (iEnd - 2 + nStages) / W + 1; // the last strip must reach iEnd at the last stage
+	long b, k, s, j, i0, i1; // strip, wavefront row, stage, row, first and one past the last column
+	double sumSq = 0.0; // sum of squared residuals
+
+	if (rmax != NULL) *rmax = 0.0;
+	for (b = 0; b < nStrips; b++)
+	{
+		for (k = 1; k < J - 2 + nStages; k++)
+		{
+			for (s = 0; s < nStages; s++)
+			{
+				j = k - s;
+				if (j < 1 || j > J - 2) continue;
+				i0 = 1 + b * W - s;
+				i1 = i0 + W;
+				if (i0 < 1) i0 = 1;
+				if (i1 > iEnd) i1 = iEnd;
+				if (i0 >= i1) continue;
+				RelaxTileSegment(G, SD, lamda, omega, bRedBlack ? (int)(s % 2) : -1, j, i0, i1,
+					s >= nFirstFused ? rmax : NULL, &sumSq);
+			}
+		}
+	}
+	if (rmax != NULL) *RMS = sqrt(sumSq / (((double)G->I - 2) * ((double)G->J - 2)));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Relaxes the nodes i0 <= i < i1 of row j for one stage of SweepTiled.  i1 = I means the 
+//               insulated right wall node is included
+// ARGUMENTS:    G:      the plate grid
+//               SD:     the simulation data for the selected case
+//               lamda:  (dx/dy)^2
+//               omega:  SOR relaxation factor
+//               color:  -1 = lexicographic Gauss-Seidel, else the red-black colour (0 = red, i + j even)
+//               j:      row
+//               i0, i1: first column and one past the last column
+//               rmax:   NULL, or the largest residual so far, raised by the pre-update residuals of these nodes
+//               sumSq:  sum of squared residuals so far, increased likewise (unused when rmax is NULL)
+// RETURN VALUE: none
+void RelaxTileSegment(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double omega, int color,
+	size_t j, size_t i0, size_t i1, double* rmax, double* sumSq)
+{
+	size_t I = G->I; // number of nodes in x
+	size_t i; // counter
+	size_t iLast = i1 < I - 1 ? i1 : I - 1; // one past the last interior node of the segment
+	size_t s = G->stride; // distance between vertically adjacent nodes
+	double* T = G->T_fd + j * s, * Tn = T + s, * Ts = T - s; // current, north and south rows of T_fd
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	double Tnew, r; // updated node, pre-update residual
+	const STENCIL_KERNELS* K = GetStencilKernels(SD->solver.nSimd);
+
+	if (color < 0) // lexicographic Gauss-Seidel, same arithmetic as SweepGaussSeidel
+	{
+		for (i = i0; i < iLast; i++)
+		{
+			Tnew = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) / (2.0 * (1.0 + lamda));
+			if (rmax != NULL && fabs(Tnew - T[i]) > *rmax) *rmax = fabs(Tnew - T[i]);
+			if (rmax != NULL) *sumSq += (Tnew - T[i]) * (Tnew - T[i]);
+			T[i] = Tnew;
+		}
+		if (i1 == I) // insulated right wall
+		{
+			Tnew = (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1])) / (2.0 * (1.0 + lamda));
+			if (rmax != NULL && fabs(Tnew - T[I - 1]) > *rmax) *rmax = fabs(Tnew - T[I - 1]);
+			if (rmax != NULL) *sumSq += (Tnew - T[I - 1]) * (Tnew - T[I - 1]);
+			T[I - 1] = Tnew;
+		}
+		return;
+	}
+
+	// the kernels number the segment from 1, so node i is their node i - i0 + 1
+	if (iLast > i0 && rmax != NULL)
+		K->relaxResidualRow(T + i0 - 1, Tn + i0 - 1, Ts + i0 - 1, iLast - i0 + 2, (int)((color + j + i0 + 1) % 2),
+			lamda, omega, rmax, sumSq);
+	else if (iLast > i0)
+		K->relaxRow(T + i0 - 1, Tn + i0 - 1, Ts + i0 - 1, iLast - i0 + 2, (int)((color + j + i0 + 1) % 2), lamda, omega);
+	if (i1 == I && (I - 1 + j) % 2 == (size_t)color) // insulated right wall
+	{
+		r = (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1])) * c - T[I - 1];
+		T[I - 1] += omega * r;
+		if (rmax != NULL && fabs(r) > *rmax) *rmax = fabs(r);
+		if (rmax != NULL) *sumSq += r * r;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Computes the residual of every interior node (and the insulated right wall), the maximum
+//               residual and the RMS residual
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+//               rmax:  returns the largest residual
+//               RMS:   returns the RMS residual
+// RETURN VALUE: none
+void GetResidual(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double* rmax, double* RMS)
+{
+	double sumSq; // sum of squared residuals
+
+	GetResidualRows(G, SD, lamda, 1, G->J - 1, rmax, &sumSq);
+	*RMS = sqrt(sumSq / (((double)G->I - 2) * ((double)G->J - 2))); // calculates RMS
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Computes the residual of the nodes in rows j0 <= j < j1, their maximum and the sum of 
+//               their squares
+// ARGUMENTS:    G:      the plate grid
+//               SD:     the simulation data for the selected case
+//               lamda:  (dx/dy)^2
+//               j0, j1: first row and one past the last row
+//               rmax:   returns the largest residual
+//               RMS:    returns the sum of the squared residuals
+// RETURN VALUE: none
+void GetResidualRows(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, size_t j0, size_t j1,
+	double* rmax, double* RMS)
+{
+	int I = (int)G->I; // number of nodes in x
+	int j = 0; // counter
+	size_t s = G->stride; // distance between vertically adjacent nodes
+	double* T, * Tn, * Ts, * R; // current, north and south rows of T_fd and the current row of res
+	const STENCIL_KERNELS* K = GetStencilKernels(SD->solver.nSimd);
+
+	*RMS = 0.0; // resets RMS to zero
+	*rmax = 0.0; // resets rmax to zero
+	for (j = (int)j0; j < (int)j1; j++) // sweeping through the nodes vertically 
+	{
+		T = G->T_fd + j * s;
+		Tn = T + s;
+		Ts = T - s;
+		R = G->res + j * s;
+		// residual of the interior nodes by using the formula found in finite difference laplace.pdf
+		K->residualRow(T, Tn, Ts, R, G->I, lamda, rmax, RMS);
+		if (SD->bc[RIGHT].nType == BC_TYPE_INSULATED) // for insulated right wall 
+		{
+			R[I - 1] = fabs(T[I - 1] - (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1])) / (2.0 * (1.0 + lamda)));
+			if (R[I - 1] > *rmax) *rmax = R[I - 1];
+			*RMS += R[I - 1] * R[I - 1];
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  The PRECISION MIXED solver loop, run by SolvePlate for serial GS and SOR.  The sweeps are 
+//               bandwidth bound, so they run on float32 planes (half the bytes, twice the SIMD lanes) in two
+//               phases.  First T itself is relaxed in float32 until the update falls to MIXED_SWITCH_ULPS
+//               float ulps of the largest |T|, where float32 has no digits left.  Then defect correction:
+//               the residual of T_fd is taken in float64, the correction e it asks for is relaxed from zero
+//               in float32 for at most MIXED_CYCLE_SWEEPS sweeps (or until its residual estimate fell by
+//               MIXED_CYCLE_REDUCTION), and T_fd += e in float64.  Relaxing e is the same linear iteration
+//               as relaxing T, so the iteration count matches the float64 solver; e is small, so float32
+//               rounding stays far below the residual.  Convergence is only accepted on the float64 
+//               residual.  Should a correction stop helping, float64 sweeps take over (pInfo->iterDouble)
+// ARGUMENTS:    G:             the plate grid (boundary conditions set)
+//               SD:            the simulation data for the case
+//               lamda, omega:  (dx/dy)^2, relaxation factor (1 for GS)
+//               maxIter:       iteration limit
+//               log, ck:       as for SolvePlate
+//               start:         start of the solve timer
+//               secondsBefore: elapsed time of the run being resumed
+//               pIter:         iterations done, updated
+//               rmax, RMS:     return the float64 residual of T_fd
+//               pInfo:         returns the precision switches
+// RETURN VALUE: HTS_OK or HTS_ERROR_INTERRUPTED (HTS_OK with pInfo->bMixed false if out of memory)
+int SolveMixedPrecision(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double omega, int maxIter,
+	CONVERGENCE_LOG* log, CHECKPOINT* ck, std::chrono::steady_clock::time_point start, double secondsBefore,
+	int* pIter, double* rmax, double* RMS, SOLVE_INFO* pInfo)
+{
+	MIXED_PRECISION M = {};   // the float32 planes
+	int iter = *pIter;        // iteration counter
+	int nStatus = HTS_OK;     // checkpoint status
+	int nSweeps = 0;          // sweeps of the current correction
+	double est = 0.0, estRMS = 0.0; // float32 residual estimate of the last sweep
+	double r0 = 0.0;          // float64 rmax when the current correction started
+	double Tscale = 0.0;      // largest |T| on the grid
+	double seconds;           // elapsed time of a record
+	size_t i, j;              // counters
+
+	if (!CreateMixedPrecision(G, &M)) return HTS_OK; // plain float64 sweeps instead
+	pInfo->bMixed = true;
+
+	if (iter == 0) // float32 sweeps of T itself (a resumed solve is already past them)
+	{
+		for (j = 0; j < G->J; j++)
+		{
+			for (i = 0; i < G->I; i++)
+			{
+				M.E[j * M.stride + i] = (float)G->T_fd[gridIndex(G, i, j)];
+				if (fabs(G->T_fd[gridIndex(G, i, j)]) > Tscale) Tscale = fabs(G->T_fd[gridIndex(G, i, j)]);
+			}
+		}
+		do
+		{
+			SweepMixedPrecision(&M, SD, (float)lamda, (float)omega, false, &est, &estRMS);
+			iter++;
+			seconds = secondsBefore + secondsSince(start);
+			if (log != NULL) logConvergence(log, est, estRMS, seconds, iter);
+			if (ck != NULL) nStatus = UpdateCheckpoint(G, SD, ck, est, estRMS, seconds, iter);
+		} while (nStatus == HTS_OK && iter <= maxIter && est >= MIXED_SWITCH_ULPS * FLT_EPSILON * Tscale &&
+			est >= MAX_RESIDUAL && estRMS >= MAX_RESIDUAL);
+		ApplyMixedCorrection(G, SD, &M, true);
+		pInfo->iterFloat = iter;
+	}
+
+	for (;;) // float64 residual, float32 correction, float64 update
+	{
+		GetMixedResidual(G, SD, lamda, &M, rmax, RMS);
+		if (nStatus != HTS_OK || iter > maxIter || *rmax < MAX_RESIDUAL || *RMS < MAX_RESIDUAL) break;
+		if (nSweeps > 0 && est < 0.5 * r0 && *rmax >= 0.5 * r0) // the estimate fell but T_fd did not follow
+		{
+			pInfo->iterDouble = iter + 1;
+			break;
+		}
+		r0 = *rmax;
+		memset(M.E, 0, M.stride * M.J * sizeof(float));
+		nSweeps = 0;
+		do
+		{
+			SweepMixedPrecision(&M, SD, (float)lamda, (float)omega, true, &est, &estRMS);
+			iter++;
+			nSweeps++;
+			seconds = secondsBefore + secondsSince(start);
+			if (log != NULL) logConvergence(log, est, estRMS, seconds, iter);
+			if (ck != NULL) nStatus = UpdateCheckpoint(G, SD, ck, est, estRMS, seconds, iter);
+		} while (nStatus == HTS_OK && iter <= maxIter && nSweeps < MIXED_CYCLE_SWEEPS && 
+			est >= MIXED_CYCLE_REDUCTION * r0 && est >= MAX_RESIDUAL && estRMS >= MAX_RESIDUAL);
+		ApplyMixedCorrection(G, SD, &M, false);
+		pInfo->nRefinements++;
+	}
+
+	free(M.block);
+	*pIter = iter;
+	return nStatus;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Allocates the two zeroed float32 planes of the mixed-precision solver, rows padded to whole
+//               cache lines like the grid
+// ARGUMENTS:    G: the plate grid
+//               M: returns the planes
+// RETURN VALUE: false if out of memory
+bool CreateMixedPrecision(const PLATEGRID* G, MIXED_PRECISION* M)
+{
+	size_t rowAlign = GRID_ALIGNMENT / sizeof(float); // floats per cache line
+	size_t planeSize;                                 // floats in one padded plane
+	uintptr_t base;                                   // first aligned address of the block
+
+	M->I = G->I;
+	M->J = G->J;
+	M->stride = (G->I + rowAlign - 1) / rowAlign * rowAlign;
+	planeSize = M->stride * M->J;
+	M->block = calloc(2 * planeSize * sizeof(float) + GRID_ALIGNMENT, 1);
+	if (M->block == NULL) return false;
+	base = ((uintptr_t)M->block + GRID_ALIGNMENT - 1) & ~(uintptr_t)(GRID_ALIGNMENT - 1);
+	M->E = (float*)base;
+	M->F = M->E + planeSize;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One float32 sweep of E: lexicographic Gauss-Seidel for SOLVER_GS, red-black SOR otherwise,
+//               the insulated right wall with its ghost-node formula.  With bRhs the sweep relaxes the 
+//               correction equation e = c (neighbours of e) + F, otherwise plain Laplace.  The residual 
+//               estimate is the size of the updates, as in the fused float64 sweeps
+// ARGUMENTS:    M:            the float32 planes
+//               SD:           the simulation data for the case
+//               lamda, omega: (dx/dy)^2, relaxation factor
+//               bRhs:         add F
+//               rmax:         returns the largest update
+//               RMS:          returns the RMS update
+// RETURN VALUE: none
+void SweepMixedPrecision(MIXED_PRECISION* M, const SIMULATION_DATA* SD, float lamda, float omega, bool bRhs,
+	double* rmax, double* RMS)
+{
+	size_t I = M->I, s = M->stride; // row length, distance between vertically adjacent nodes
+	size_t i, j;                    // counters
+	int color;                      // 0 = red (i + j even), 1 = black
+	float* E, * En, * Es;           // current, north and south rows of E
+	const float* F;                 // current row of F, NULL without a right-hand side
+	float c = 1.0f / (2.0f * (1.0f + lamda)); // stencil weight
+	float r;                        // update of a node
+	double rm = 0.0, sumSq = 0.0;   // reductions
+	bool bInsulated = SD->bc[RIGHT].nType == BC_TYPE_INSULATED;
+	const STENCIL_KERNELS* K = GetStencilKernels(SD->solver.nSimd);
+
+	for (color = 0; color < (SD->solver.nSolver == SOLVER_GS ? 1 : 2); color++)
+	{
+		for (j = 1; j < M->J - 1; j++)
+		{
+			E = M->E + j * s;
+			En = E + s;
+			Es = E - s;
+			F = bRhs ? M->F + j * s : NULL;
+			if (SD->solver.nSolver == SOLVER_GS) // lexicographic, one node after the other
+			{
+				for (i = 1; i < I - 1; i++)
+				{
+					r = (E[i + 1] + E[i - 1] + lamda * (En[i] + Es[i])) * c - E[i];
+					if (F != NULL) r += F[i];
+					E[i] += r;
+					rm = fabs(r) > rm ? fabs(r) : rm;
+					sumSq += (double)r * r;
+				}
+			}
+			else K->relaxRowFloat(E, En, Es, F, I, (int)((color + j) % 2), lamda, omega, &rm, &sumSq);
+			if (bInsulated && (SD->solver.nSolver == SOLVER_GS || (I - 1 + j) % 2 == (size_t)color))
+			{
+				r = (2.0f * E[I - 2] + lamda * (En[I - 1] + Es[I - 1])) * c - E[I - 1];
+				if (F != NULL) r += F[I - 1];
+				E[I - 1] += omega * r;
+				rm = fabs(r) > rm ? fabs(r) : rm;
+				sumSq += (double)r * r;
+			}
+		}
+	}
+	*rmax = rm;
+	*RMS = sqrt(sumSq / (((double)M->I - 2) * ((double)M->J - 2)));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Residual of T_fd in float64, stored signed in F as the update a Gauss-Seidel step would 
+//               make, c (neighbours) - T, which is the right-hand side of the correction equation
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data for the case
+//               lamda: (dx/dy)^2
+//               M:     the float32 planes, F is filled
+//               rmax:  returns the largest residual
+//               RMS:   returns the RMS residual
+// RETURN VALUE: none
+void GetMixedResidual(const PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, MIXED_PRECISION* M,
+	double* rmax, double* RMS)
+{
+	size_t I = G->I, s = G->stride; // row length, distance between vertically adjacent nodes
+	size_t i, j;                    // counters
+	const double* T, * Tn, * Ts;    // current, north and south rows of T_fd
+	float* F;                       // current row of F
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	double r;                       // residual of a node
+	double rm = 0.0, sumSq = 0.0;   // reductions
+
+	for (j = 1; j < G->J - 1; j++)
+	{
+		T = G->T_fd + j * s;
+		Tn = T + s;
+		Ts = T - s;
+		F = M->F + j * M->stride;
+		for (i = 1; i < I - 1; i++)
+		{
+			r = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c - T[i];
+			F[i] = (float)r;
+			rm = fabs(r) > rm ? fabs(r) : rm;
+			sumSq += r * r;
+		}
+		if (SD->bc[RIGHT].nType == BC_TYPE_INSULATED)
+		{
+			r = (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1])) * c - T[I - 1];
+			F[I - 1] = (float)r;
+			rm = fabs(r) > rm ? fabs(r) : rm;
+			sumSq += r * r;
+		}
+	}
+	*rmax = rm;
+	*RMS = sqrt(sumSq / (((double)G->I - 2) * ((double)G->J - 2)));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Copies E into the unknowns of T_fd (bReplace) or adds it to them, in float64.  The fixed
+//               wall temperatures are never touched, so they keep their float64 values
+// ARGUMENTS:    G:        the plate grid
+//               SD:       the simulation data for the case
+//               M:        the float32 planes
+//               bReplace: T_fd = E rather than T_fd += E
+// RETURN VALUE: none
+void ApplyMixedCorrection(PLATEGRID* G, const SIMULATION_DATA* SD, const MIXED_PRECISION* M, bool bReplace)
+{
+	size_t iEnd = SD->bc[RIGHT].nType == BC_TYPE_INSULATED ? G->I : G->I - 1; // one past the last unknown column
+	size_t i, j;      // counters
+	double* T;        // current row of T_fd
+	const float* E;   // current row of E
+
+	for (j = 1; j < G->J - 1; j++)
+	{
+		T = G->T_fd + j * G->stride;
+		E = M->E + j * M->stride;
+		if (bReplace) for (i = 1; i < iEnd; i++) T[i] = E[i];
+		else for (i = 1; i < iEnd; i++) T[i] += E[i];
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  SOLVER DST: solves the plate directly, with no iterations.  Every wall except an insulated 
+//               right wall holds fixed temperatures, so the unknowns satisfy the 5-point Laplace equation
+//               with the wall values folded into the right-hand side.  A sine transform along x turns it 
+//               into one tridiagonal system along y per mode, solved with the Thomas algorithm, and the
+//               inverse transform gives T_fd.  With fixed walls left and right the modes are sin(pi k i/(n+1))
+//               (DST-I); an insulated right wall makes them quarter-wave sines sin(pi (2k-1) i/(2n)), which
+//               satisfy the ghost-node condition of the wall node.  Both transforms are evaluated as one 
+//               complex DFT per row, O(n log n).  The initial T_fd is not used
+// ARGUMENTS:    G:     the plate grid (boundary conditions set)
+//               SD:    the simulation data for the case
+//               lamda: (dx/dy)^2
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT if a wall other than the right one is insulated, HTS_ERROR_MEMORY
+int SolveDirectDST(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda)
+{
+	bool bInsulated = SD->bc[RIGHT].nType == BC_TYPE_INSULATED; // quarter-wave modes
+	size_t n = bInsulated ? G->I - 1 : G->I - 2; // unknowns per row, columns 1..n
+	size_t m = G->J - 2;                         // unknown rows 1..m
+	size_t M = bInsulated ? 4 * n : 2 * (n + 1); // DFT length: sin(pi k i/(n+1)) = sin(2 pi k i/M), etc.
+	size_t i, j, k;                              // counters
+	DFT_PLAN P = {};                             // the row transform
+	std::complex<double>* x = NULL;              // one row on its way through the DFT
+	double* B = NULL, * C = NULL;                // right-hand side then solution in mode space, Thomas factors
+	double* diag = NULL;                         // diagonal of the tridiagonal system of each mode
+	double* T;                                   // current row of T_fd
+	double b, denom;                             // right-hand side of a node, Thomas pivot
+	int nStatus = HTS_OK;                        // return code
+
+	for (i = 0; i < (size_t)NUM_WALLS; i++)
+		if (i != (size_t)RIGHT && SD->bc[i].nType == BC_TYPE_INSULATED) return HTS_ERROR_ARGUMENT;
+	B = (double*)malloc(n * m * sizeof(double));
+	C = (double*)malloc(n * m * sizeof(double));
+	diag = (double*)malloc(n * sizeof(double));
+	x = new (std::nothrow) std::complex<double>[M];
+	if (B == NULL || C == NULL || diag == NULL || x == NULL || !CreateDFTPlan(M, &P)) nStatus = HTS_ERROR_MEMORY;
+
+	for (k = 0; k < n && nStatus == HTS_OK; k++) // x eigenvalue of mode k + 1 less the y part of the stencil
+		diag[k] = 2.0 * cos(bInsulated ? PI * (2.0 * k + 1.0) / (2.0 * n) : PI * (k + 1.0) / (n + 1.0)) - 2.0 - 2.0 * lamda;
+	for (j = 1; j <= m && nStatus == HTS_OK; j++) // fold the walls in and transform each row
+	{
+		T = G->T_fd + gridIndex(G, 0, j);
+		for (i = 0; i < M; i++) x[i] = 0.0;
+		for (i = 1; i <= n; i++)
+		{
+			b = 0.0;
+			if (i == 1) b -= T[0];
+			if (i == n && !bInsulated) b -= T[n + 1];
+			if (j == 1) b -= lamda * T[i - G->stride];
+			if (j == m) b -= lamda * T[i + G->stride];
+			if (i == n && bInsulated) b *= 0.5; // half weight of the wall node makes the quarter-wave modes orthogonal
+			x[i] = b;
+		}
+		RunDFT(&P, x);
+		for (k = 0; k < n; k++) // sum over i of b_i sin(2 pi i q / M) is -Im of the DFT at q
+			B[(j - 1) * n + k] = -x[bInsulated ? 2 * k + 1 : k + 1].imag() * (bInsulated ? 2.0 / n : 1.0);
+	}
+	for (j = 0; j < m && nStatus == HTS_OK; j++) // Thomas forward sweep, all modes side by side
+	{
+		for (k = 0; k < n; k++)
+		{
+			denom = j == 0 ? diag[k] : diag[k] - lamda * C[(j - 1) * n + k];
+			C[j * n + k] = lamda / denom;
+			B[j * n + k] = (j == 0 ? B[k] : B[j * n + k] - lamda * B[(j - 1) * n + k]) / denom;
+		}
+	}
+	for (j = m - 1; j-- > 0 && nStatus == HTS_OK; ) // back substitution
+		for (k = 0; k < n; k++) B[j * n + k] -= C[j * n + k] * B[(j + 1) * n + k];
+	for (j = 1; j <= m && nStatus == HTS_OK; j++) // back to x: T_i = scale * sum over k of u_k sin(...)
+	{
+		T = G->T_fd + gridIndex(G, 0, j);
+		for (i = 0; i < M; i++) x[i] = 0.0;
+		for (k = 0; k < n; k++) x[bInsulated ? 2 * k + 1 : k + 1] = B[(j - 1) * n + k];
+		RunDFT(&P, x);
+		for (i = 1; i <= n; i++) T[i] = -x[i].imag() * (bInsulated ? 1.0 : 2.0 / (n + 1.0));
+	}
+
+	FreeDFTPlan(&P);
+	delete[] x;
+	free(B);
+	free(C);
+	free(diag);
+	return nStatus;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Prepares a length-M complex DFT.  A power-of-two M runs the radix-2 FFT directly; any other
+//               M goes through Bluestein's algorithm, which writes the DFT as a convolution with the chirp 
+//               e^(i pi m^2 / M) and does that with power-of-two FFTs of length N >= 2M - 1
+// ARGUMENTS:    M: transform length
+//               P: returns the plan
+// RETURN VALUE: false if out of memory (P is freed)
+bool CreateDFTPlan(size_t M, DFT_PLAN* P)
+{
+	size_t m; // counter
+
+	P->M = M;
+	for (P->N = 1; P->N < ((M & (M - 1)) == 0 ? M : 2 * M - 1); P->N *= 2);
+	P->twiddle = new (std::nothrow) std::complex<double>[P->N / 2 + 1];
+	if (P->twiddle == NULL) return false;
+	for (m = 0; m < P->N / 2; m++) P->twiddle[m] = std::polar(1.0, -2.0 * PI * (double)m / (double)P->N);
+	if (P->N == M) return true;
+
+	P->chirp = new (std::nothrow) std::complex<double>[M];
+	P->filter = new (std::nothrow) std::complex<double>[P->N];
+	P->work = new (std::nothrow) std::complex<double>[P->N];
+	if (P->chirp == NULL || P->filter == NULL || P->work == NULL)
+	{
+		FreeDFTPlan(P);
+		return false;
+	}
+	for (m = 0; m < M; m++) // m^2 mod 2M keeps the angle small and exact
+		P->chirp[m] = std::polar(1.0, PI * (double)((unsigned long long)m * m % (2ULL * M)) / (double)M);
+	for (m = 0; m < P->N; m++) P->filter[m] = 0.0;
+	for (m = 0; m < M; m++)
+	{
+		P->filter[m] = P->chirp[m];
+		if (m > 0) P->filter[P->N - m] = P->chirp[m];
+	}
+	fftRadix2(P->filter, P);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees the tables of a DFT plan
+// ARGUMENTS:    P: the plan
+// RETURN VALUE: none
+void FreeDFTPlan(DFT_PLAN* P)
+{
+	delete[] P->twiddle;
+	delete[] P->chirp;
+	delete[] P->filter;
+	delete[] P->work;
+	P->twiddle = P->chirp = P->filter = P->work = NULL;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  In-place forward DFT, X_q = sum over p of x_p e^(-2 pi i p q / M)
+// ARGUMENTS:    P: the plan
+//               x: M values, replaced by their transform
+// RETURN VALUE: none
+void RunDFT(DFT_PLAN* P, std::complex<double>* x)
+{
+	size_t m; // counter
+
+	if (P->N == P->M)
+	{
+		fftRadix2(x, P);
+		return;
+	}
+	// X_q = conj(w_q) sum over p of (x_p conj(w_p)) w_(q-p), with w_m the chirp
+	for (m = 0; m < P->N; m++) P->work[m] = m < P->M ? x[m] * std::conj(P->chirp[m]) : 0.0;
+	fftRadix2(P->work, P);
+	for (m = 0; m < P->N; m++) P->work[m] = std::conj(P->work[m] * P->filter[m]); // inverse FFT by conjugation
+	fftRadix2(P->work, P);
+	for (m = 0; m < P->M; m++) x[m] = std::conj(P->work[m]) * std::conj(P->chirp[m]) / (double)P->N;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  In-place iterative radix-2 FFT of length P->N (forward, e^(-2 pi i / N))
+// ARGUMENTS:    a: N values
+//               P: the plan (length and twiddles)
+// RETURN VALUE: none
+void fftRadix2(std::complex<double>* a, const DFT_PLAN* P)
+{
+	size_t N = P->N;              // length
+	size_t i, j, bit, len, k;     // counters
+	std::complex<double> u, v;    // butterfly inputs
+
+	for (i = 1, j = 0; i < N; i++) // bit-reversal permutation
+	{
+		for (bit = N >> 1; j & bit; bit >>= 1) j ^= bit;
+		j ^= bit;
+		if (i < j) std::swap(a[i], a[j]);
+	}
+	for (len = 2; len <= N; len <<= 1)
+	{
+		for (i = 0; i < N; i += len)
+		{
+			for (k = 0; k < len / 2; k++)
+			{
+				u = a[i + k];
+				v = a[i + k + len / 2] * P->twiddle[k * (N / len)];
+				a[i + k] = u + v;
+				a[i + k + len / 2] = u - v;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  SOLVER CHOLESKY: solves the plate directly with a banded Cholesky factor of the 5-point 
+//               operator.  The operator depends only on the mesh (I, J, lamda) and on whether the right wall
+//               is insulated, so sweeps over boundary temperatures reuse one factor from memory or, with
+//               CACHE YES, from SOLUTION_CACHE_DIR: each solve is then one right-hand side and a pair of 
+//               triangular solves.  The initial T_fd is not used
+// ARGUMENTS:    G:     the plate grid (boundary conditions set)
+//               SD:    the simulation data for the case
+//               lamda: (dx/dy)^2
+//               pInfo: returns the bandwidth, where the factor came from and the time to get it
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT if a wall other than the right one is insulated, HTS_ERROR_MEMORY
+//               if the factor would exceed FACTOR_MAX_MB or cannot be allocated
+int SolveDirectCholesky(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, SOLVE_INFO* pInfo)
+{
+	FACTOR_KEY key = {};          // the operator, zeroed so the reserved field hashes the same
+	BANDED_FACTOR* F;             // its factor
+	double* x;                    // right-hand side, then the solution, in factor order
+	double* T;                    // current row of T_fd
+	double b;                     // right-hand side of a node
+	size_t i, j, p, r, r0;        // counters, node and column of the factor, first column of a row
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // factor timer
+
+	for (i = 0; i < (size_t)NUM_WALLS; i++)
+		if (i != (size_t)RIGHT && SD->bc[i].nType == BC_TYPE_INSULATED) return HTS_ERROR_ARGUMENT;
+	key.I = G->I;
+	key.J = G->J;
+	key.lamda = lamda;
+	key.bInsulated = SD->bc[RIGHT].nType == BC_TYPE_INSULATED;
+	F = AcquireFactor(&key, &SD->solver, &pInfo->nFactorSource);
+	pInfo->factorSeconds = secondsSince(start);
+	if (F == NULL) return HTS_ERROR_MEMORY;
+	pInfo->nBandwidth = F->b;
+	x = (double*)malloc(F->N * sizeof(double));
+	if (x == NULL)
+	{
+		ReleaseFactor(F);
+		return HTS_ERROR_MEMORY;
+	}
+
+	for (j = 1; j <= F->m; j++) // the known neighbours of every unknown
+	{
+		T = G->T_fd + gridIndex(G, 0, j);
+		for (i = 1; i <= F->n; i++)
+		{
+			b = 0.0;
+			if (i == 1) b += T[0];
+			if (i == F->n && !key.bInsulated) b += T[i + 1];
+			if (j == 1) b += lamda * T[i - G->stride];
+			if (j == F->m) b += lamda * T[i + G->stride];
+			if (i == F->n && key.bInsulated) b *= 0.5; // the wall row is halved to keep the operator symmetric
+			x[factorIndex(F, i, j)] = b;
+		}
+	}
+	for (p = 0; p < F->N; p++) // L y = b, row by row
+	{
+		r0 = p > F->b ? p - F->b : 0;
+		x[p] = (x[p] - dotBand(F->L + p * (F->b + 1) + r0 + F->b - p, x + r0, p - r0)) / F->L[p * (F->b + 1) + F->b];
+	}
+	for (p = F->N; p-- > 0; ) // L^T x = y, column by column so the factor is still read along its rows
+	{
+		x[p] /= F->L[p * (F->b + 1) + F->b];
+		r0 = p > F->b ? p - F->b : 0;
+		for (r = r0; r < p; r++) x[r] -= F->L[p * (F->b + 1) + r + F->b - p] * x[p];
+	}
+	for (j = 1; j <= F->m; j++)
+	{
+		T = G->T_fd + gridIndex(G, 0, j);
+		for (i = 1; i <= F->n; i++) T[i] = x[factorIndex(F, i, j)];
+	}
+
+	free(x);
+	ReleaseFactor(F);
+	return HTS_OK;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Position of unknown (i, j) in a factor.  Unknowns are numbered along the shorter side of 
+//               the plate first, which makes that side the bandwidth
+// ARGUMENTS:    F: the factor
+//               i: node column, 1..n
+//               j: node row, 1..m
+// RETURN VALUE: the position, 0..N-1
+size_t factorIndex(const BANDED_FACTOR* F, size_t i, size_t j)
+{
+	return F->bColumns ? (i - 1) * F->m + (j - 1) : (j - 1) * F->n + (i - 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Gets the factor of an operator for one solve: from the in-memory cache, else from the disk 
+//               cache, else by factoring it, and then keeps it in memory.  Two threads that miss at once
+//               both factor and the second keeps the first one's entry.  Unused factors are dropped, least 
+//               recently used first, while the cache holds more than FACTOR_MEMORY_MB
+// ARGUMENTS:    key:     the operator
+//               pSolver: the solver settings, CACHE YES also looks in and stores to SOLUTION_CACHE_DIR
+//               pSource: returns FACTOR_FROM_MEMORY, FACTOR_FROM_DISK or FACTOR_COMPUTED
+// RETURN VALUE: the factor, to be given back with ReleaseFactor; NULL if it cannot be had
+BANDED_FACTOR* AcquireFactor(const FACTOR_KEY* key, const SOLVER_DATA* pSolver, int* pSource)
+{
+	uint64_t cacheBytes = (uint64_t)(pSolver->nCacheMB > 0 ? pSolver->nCacheMB : DEFAULT_CACHE_MB) << 20; // disk limit
+	FACTOR_CACHE* C = getFactorCache(); // the in-memory cache
+	BANDED_FACTOR* F = NULL;            // the factor
+	size_t n;                           // counter
+
+	{
+		std::lock_guard<std::mutex> guard(C->lock);
+		for (n = 0; n < C->entries.size(); n++)
+		{
+			if (memcmp(&C->entries[n].F->key, key, sizeof(FACTOR_KEY)) != 0) continue;
+			C->entries[n].nUsers++;
+			C->entries[n].lastUse = ++C->clock;
+			*pSource = FACTOR_FROM_MEMORY;
+			return C->entries[n].F;
+		}
+	}
+
+	*pSource = FACTOR_FROM_DISK;
+	if (pSolver->bCache) F = LoadFactor(key);
+	if (F == NULL)
+	{
+		*pSource = FACTOR_COMPUTED;
+		F = CreateFactor(key);
+		if (F == NULL) return NULL;
+		if (pSolver->bCache && factorBytes(F->N, F->b) < cacheBytes) StoreFactor(F, cacheBytes);
+	}
+
+	std::lock_guard<std::mutex> guard(C->lock);
+	for (n = 0; n < C->entries.size(); n++) // another thread got here first
+	{
+		if (memcmp(&C->entries[n].F->key, key, sizeof(FACTOR_KEY)) != 0) continue;
+		FreeFactor(F);
+		C->entries[n].nUsers++;
+		C->entries[n].lastUse = ++C->clock;
+		return C->entries[n].F;
+	}
+	C->entries.push_back({ F, 1, ++C->clock });
+	C->bytes += factorBytes(F->N, F->b);
+	while (C->bytes > ((size_t)FACTOR_MEMORY_MB << 20))
+	{
+		size_t victim = C->entries.size(); // least recently used factor nobody is solving with
+		for (n = 0; n < C->entries.size(); n++)
+			if (C->entries[n].nUsers == 0 && (victim == C->entries.size() || C->entries[n].lastUse < C->entries[victim].lastUse))
+				victim = n;
+		if (victim == C->entries.size()) break;
+		C->bytes -= factorBytes(C->entries[victim].F->N, C->entries[victim].F->b);
+		FreeFactor(C->entries[victim].F);
+		C->entries.erase(C->entries.begin() + victim);
+	}
+	return F;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Gives back a factor from AcquireFactor, so the cache may drop it
+// ARGUMENTS:    F: the factor
+// RETURN VALUE: none
+void ReleaseFactor(BANDED_FACTOR* F)
+{
+	FACTOR_CACHE* C = getFactorCache(); // the in-memory cache
+	size_t n;                           // counter
+
+	std::lock_guard<std::mutex> guard(C->lock);
+	for (n = 0; n < C->entries.size(); n++)
+		if (C->entries[n].F == F) C->entries[n].nUsers--;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  The process-wide factor cache, shared by every case and every library plate (emptied by
+//               hts_release_caches)
+// ARGUMENTS:    none
+// RETURN VALUE: the cache
+FACTOR_CACHE* getFactorCache()
+{
+	static FACTOR_CACHE cache; // constructed on first use, thread-safe
+	return &cache;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Bytes of a banded factor
+// ARGUMENTS:    N: unknowns
+//               b: bandwidth
+// RETURN VALUE: the size of its band
+size_t factorBytes(size_t N, size_t b)
+{
+	return N * (b + 1) * sizeof(double);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Assembles and factors the operator, A = L L^T.  A is the negated 5-point stencil: 2(1 + lamda)
+//               on the diagonal, -1 to the x neighbours and -lamda to the y neighbours, with every fixed 
+//               wall node moved to the right-hand side.  On an insulated right wall the ghost node doubles
+//               the west neighbour, so that row is halved to keep A symmetric.  Row p of L holds columns 
+//               p-b..p contiguously, which makes every update a dot product of two contiguous runs
+// ARGUMENTS:    key: the operator
+// RETURN VALUE: the factor, NULL if it would exceed FACTOR_MAX_MB, is out of memory or is not positive definite
+BANDED_FACTOR* CreateFactor(const FACTOR_KEY* key)
+{
+	BANDED_FACTOR* F;             // the factor
+	double* Lp, * Lq;             // rows p and q of L
+	double s;                     // entry being eliminated
+	double wall;                  // 0.5 on the insulated wall column, else 1
+	size_t i, j, p, q, r0;        // counters, row, column, first column of row p
+
+	F = (BANDED_FACTOR*)calloc(1, sizeof(BANDED_FACTOR));
+	if (F == NULL) return NULL;
+	F->key = *key;
+	F->n = key->bInsulated ? (size_t)key->I - 1 : (size_t)key->I - 2;
+	F->m = (size_t)key->J - 2;
+	F->N = F->n * F->m;
+	F->bColumns = F->m < F->n;
+	F->b = F->bColumns ? F->m : F->n;
+	if (factorBytes(F->N, F->b) > ((size_t)FACTOR_MAX_MB << 20) ||
+		(F->L = (double*)calloc(F->N * (F->b + 1), sizeof(double))) == NULL)
+	{
+		free(F);
+		return NULL;
+	}
+
+	for (j = 1; j <= F->m; j++) // lower triangle of A, in band storage
+	{
+		for (i = 1; i <= F->n; i++)
+		{
+			p = factorIndex(F, i, j);
+			wall = key->bInsulated && i == F->n ? 0.5 : 1.0;
+			Lp = F->L + p * (F->b + 1) + F->b - p; // Lp[q] is column q of row p
+			Lp[p] = 2.0 * (1.0 + key->lamda) * wall;
+			if (i > 1) Lp[factorIndex(F, i - 1, j)] = -1.0; // both orderings put the west and south
+			if (j > 1) Lp[factorIndex(F, i, j - 1)] = -key->lamda * wall; // neighbours before p
+		}
+	}
+	for (p = 0; p < F->N; p++)
+	{
+		r0 = p > F->b ? p - F->b : 0;
+		Lp = F->L + p * (F->b + 1) + F->b - p;
+		for (q = r0; q <= p; q++)
+		{
+			Lq = F->L + q * (F->b + 1) + F->b - q;
+			s = Lp[q] - dotBand(Lp + r0, Lq + r0, q - r0);
+			if (q < p) Lp[q] = s / Lq[q];
+			else if (s > 0.0) Lp[p] = sqrt(s);
+			else
+			{
+				FreeFactor(F);
+				return NULL;
+			}
+		}
+	}
+	return F;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Dot product of two contiguous runs, with four partial sums so the adds do not wait on each
+//               other (the band sweeps are otherwise bound by that one chain)
+// ARGUMENTS:    a, b: the runs
+//               n:    their length
+// RETURN VALUE: a . b
+double dotBand(const double* a, const double* b, size_t n)
+{
+	double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0; // partial sums
+	size_t r;                                      // counter
+
+	for (r = 0; r + 4 <= n; r += 4)
+	{
+		s0 += a[r] * b[r];
+		s1 += a[r + 1] * b[r + 1];
+		s2 += a[r + 2] * b[r + 2];
+		s3 += a[r + 3] * b[r + 3];
+	}
+	for (; r < n; r++) s0 += a[r] * b[r];
+	return (s0 + s1) + (s2 + s3);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees a factor (NULL is ignored)
+// ARGUMENTS:    F: the factor
+// RETURN VALUE: none
+void FreeFactor(BANDED_FACTOR* F)
+{
+	if (F == NULL) return;
+	free(F->L);
+	free(F);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Reads a factor from SOLUTION_CACHE_DIR.  The header (full key and sizes) and the file size
+//               are checked first, so a hash collision or a truncated file is just a miss
+// ARGUMENTS:    key: the operator
+// RETURN VALUE: the factor, NULL on a miss
+BANDED_FACTOR* LoadFactor(const FACTOR_KEY* key)
+{
+	FACTOR_FILE_HEADER header;    // the entry's header
+	BANDED_FACTOR* F;             // the factor
+	std::error_code ec;           // filesystem errors are misses
+	char strFile[MAX_BUFF_SIZE];  // the entry
+	FILE* fin = NULL;
+	errno_t err;
+	bool bOk;
+
+	sprintf_s(strFile, MAX_BUFF_SIZE, "%s/%016llx.hcf", SOLUTION_CACHE_DIR, (unsigned long long)hashBytes(key, sizeof(FACTOR_KEY)));
+	err = fopen_s(&fin, strFile, "rb");
+	if (err != 0 || fin == NULL) return NULL;
+	F = (BANDED_FACTOR*)calloc(1, sizeof(BANDED_FACTOR));
+	bOk = F != NULL && fread(&header, sizeof(header), 1, fin) == 1 && memcmp(header.magic, FACTOR_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+		header.version == FACTOR_FILE_VERSION && memcmp(&header.key, key, sizeof(FACTOR_KEY)) == 0 &&
+		factorBytes((size_t)header.N, (size_t)header.b) <= ((size_t)FACTOR_MAX_MB << 20) &&
+		std::filesystem::file_size(strFile, ec) == sizeof(header) + factorBytes((size_t)header.N, (size_t)header.b);
+	if (bOk)
+	{
+		F->key = *key;
+		F->n = (size_t)header.n;
+		F->m = (size_t)header.m;
+		F->N = (size_t)header.N;
+		F->b = (size_t)header.b;
+		F->bColumns = header.bColumns != 0;
+		F->L = (double*)malloc(factorBytes(F->N, F->b));
+		bOk = F->L != NULL && fread(F->L, sizeof(double), F->N * (F->b + 1), fin) == F->N * (F->b + 1);
+	}
+	fclose(fin);
+	if (!bOk)
+	{
+		FreeFactor(F);
+		return NULL;
+	}
+	std::filesystem::last_write_time(strFile, std::filesystem::file_time_type::clock::now(), ec); // least recently used last
+	return F;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Writes a factor to SOLUTION_CACHE_DIR the way StoreCachedSolution writes a solution: under a
+//               temporary name, renamed into place, then the cache is evicted down to CACHE_MB.  Failures
+//               are ignored, the factor is only recomputed next time
+// ARGUMENTS:    F:        the factor
+//               maxBytes: size limit of the cache
+// RETURN VALUE: none
+void StoreFactor(const BANDED_FACTOR* F, uint64_t maxBytes)
+{
+	FACTOR_FILE_HEADER header = {};  // zeroed, so the reserved field is written as zero
+	std::error_code ec;              // filesystem errors
+	char strFile[MAX_BUFF_SIZE];     // the entry
+	char strTempFile[MAX_BUFF_SIZE + TEMP_SUFFIX_SIZE]; // the entry while it is written
+	FILE* fout = NULL;
+	errno_t err;
+	bool bOk;
+
+	memcpy(header.magic, FACTOR_FILE_MAGIC, sizeof(header.magic));
+	header.version = FACTOR_FILE_VERSION;
+	header.bColumns = F->bColumns;
+	header.key = F->key;
+	header.n = F->n;
+	header.m = F->m;
+	header.N = F->N;
+	header.b = F->b;
+
+	std::filesystem::create_directories(SOLUTION_CACHE_DIR, ec);
+	sprintf_s(strFile, MAX_BUFF_SIZE, "%s/%016llx.hcf", SOLUTION_CACHE_DIR, (unsigned long long)hashBytes(&F->key, sizeof(FACTOR_KEY)));
+	sprintf_s(strTempFile, sizeof(strTempFile), "%s.%llx.%zx.tmp", strFile,
+		(unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count(), std::hash<std::thread::id>()(std::this_thread::get_id()));
+	err = fopen_s(&fout, strTempFile, "wb");
+	if (err != 0 || fout == NULL) return;
+	bOk = fwrite(&header, sizeof(header), 1, fout) == 1;
+	bOk = bOk && fwrite(F->L, sizeof(double), F->N * (F->b + 1), fout) == F->N * (F->b + 1);
+	bOk = fclose(fout) == 0 && bOk;
+	if (!bOk)
+	{
+		remove(strTempFile);
+		return;
+	}
+	std::filesystem::rename(strTempFile, strFile, ec); // as in StoreCachedSolution, an existing entry is kept
+	if (ec) remove(strTempFile);
+	evictSolutionCache(maxBytes);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  PROCESSES n: red-black SOR on a plate split into n bands of rows, each owned by one rank 
+//               with its own copy of the band (so a worker process allocates it on its own memory node).
+//               Ranks swap their edge rows after every colour, so each node sees exactly the neighbours it
+//               would in the serial sweep: the iterations and T_fd match SOLVER SOR without PROCESSES.
+//               Every iteration ends with a global max/sum of the band residuals, which also carries rank 
+//               0's stop request.  Rank 0 is the calling thread and does the logging; ranks 1..n-1 are
+//               started by the transport (TRANSPORT THREADS: threads, TRANSPORT SHM: worker processes).  If
+//               SHM cannot start its workers the ranks run as threads, and pInfo says so
+// ARGUMENTS:    G:     the plate grid (boundary conditions set)
+//               SD:    the simulation data for the case
+//               lamda: (dx/dy)^2
+//               omega: SOR relaxation factor
+//               log:   the convergence log, may be NULL
+//               ck:    the checkpoint (history only, decomposed solves do not write snapshots), may be NULL
+//               pInfo: returns the iterations, residuals and ranks
+// RETURN VALUE: HTS_OK, HTS_ERROR_NOT_CONVERGED, HTS_ERROR_MEMORY (also when a rank cannot be started or 
+//               fails), or the checkpoint status
+int SolveDecomposed(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, double omega, CONVERGENCE_LOG* log,
+	CHECKPOINT* ck, SOLVE_INFO* pInfo)
+{
+	DD_RUN* R;                    // the run
+	size_t m = G->J - 2;          // unknown rows
+	size_t j;                     // row counter
+	int r;                        // rank counter
+	int nStatus;                  // rank 0's status
+	bool bOpen;                   // the transport has its shared region
+	bool bOk;                     // the transport started and joined every rank
+
+	R = new (std::nothrow) DD_RUN();
+	if (R == NULL) return HTS_ERROR_MEMORY;
+	R->G = G;
+	R->SD = SD;
+	R->lamda = lamda;
+	R->omega = omega;
+	R->nRanks = SD->solver.nProcesses < MAX_PROCESSES ? SD->solver.nProcesses : MAX_PROCESSES;
+	if ((size_t)R->nRanks > m) R->nRanks = (int)m; // at least one row each
+	for (r = 0; r <= R->nRanks; r++) R->rowStart[r] = 1 + m * r / R->nRanks;
+	R->iterStart = ck != NULL ? ck->iterStart : 0;
+	R->maxIter = SD->solver.nMaxIter > 0 ? SD->solver.nMaxIter : MAX_ITER;
+	R->transport = GetHaloTransport(SD->solver.nTransport);
+	GetStencilKernels(SD->solver.nSimd); // the CPU query runs once, before the ranks start
+	R->haloOffset = (sizeof(DD_SHARED) + GRID_ALIGNMENT - 1) / GRID_ALIGNMENT * GRID_ALIGNMENT;
+	R->resultOffset = R->haloOffset + 2 * 2 * (size_t)R->nRanks * G->stride * sizeof(double);
+	R->memBytes = R->resultOffset + 2 * G->stride * G->J * sizeof(double);
+	bOpen = R->transport->open(R);
+	bOk = bOpen && R->transport->launch(R);
+	if (!bOk && R->transport != GetHaloTransport(TRANSPORT_THREADS)) // no worker processes, the ranks run as threads
+	{
+		if (bOpen)
+		{
+			R->transport->join(R); // the workers already started see bAbort and leave
+			R->transport->close(R);
+		}
+		pInfo->bTransportFallback = true;
+		R->transport = GetHaloTransport(TRANSPORT_THREADS);
+		bOpen = R->transport->open(R);
+		bOk = bOpen && R->transport->launch(R);
+	}
+	if (!bOpen)
+	{
+		delete R;
+		return HTS_ERROR_MEMORY;
+	}
+
+	nStatus = RunSubdomain(R, 0, log, ck);
+	bOk = R->transport->join(R) && bOk;
+	if (bOk) // every rank gathered its band
+	{
+		for (j = 1; j <= m; j++)
+		{
+			memcpy(G->T_fd + j * G->stride, ddResultT(R) + j * G->stride, G->I * sizeof(double));
+			memcpy(G->res + j * G->stride, ddResultRes(R) + j * G->stride, G->I * sizeof(double));
+		}
+	}
+	R->transport->close(R);
+
+	pInfo->nProcesses = R->nRanks;
+	pInfo->strTransport = R->transport->strName;
+	pInfo->bConverged = R->rmax < MAX_RESIDUAL || R->RMS < MAX_RESIDUAL;
+	pInfo->iter = R->iter;
+	pInfo->iterRun = R->iter - R->iterStart;
+	pInfo->rmax = R->rmax;
+	pInfo->RMS = R->RMS;
+	delete R;
+	if (!bOk) return HTS_ERROR_MEMORY;
+	if (nStatus != HTS_OK) return nStatus;
+	return pInfo->bConverged ? HTS_OK : HTS_ERROR_NOT_CONVERGED;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  The iteration loop of one rank of a decomposed solve, on its own band of rows.  Rank 0 also
+//               logs every iteration and keeps the history the solution cache stores.  A stop signal seen by
+//               rank 0 reaches the other ranks through the next reduction, so all of them leave the loop 
+//               after the same iteration (one unlogged sweep later; an interrupted field is not kept)
+// ARGUMENTS:    R:    the run
+//               rank: this rank
+//               log:  rank 0: the convergence log, may be NULL
+//               ck:   rank 0: the checkpoint, may be NULL
+// RETURN VALUE: HTS_OK, HTS_ERROR_MEMORY, or rank 0's checkpoint status
+int RunSubdomain(DD_RUN* R, int rank, CONVERGENCE_LOG* log, CHECKPOINT* ck)
+{
+	DD_RANK D = {};               // this rank's band and message counters
+	const PLATEGRID* G = R->G;    // the whole plate
+	int color;                    // 0 = red, 1 = black
+	int iter = R->iterStart;      // iteration counter
+	int nStatus = HTS_OK;         // rank 0's checkpoint status
+	int bStop;                    // rank 0 asked every rank to stop
+	double rmax = 0.0, sumSq = 0.0, RMS = 0.0; // band residuals, then global ones
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // solve timer
+	double secondsBefore = ck != NULL && ck->nRecords > 0 ? ck->records[ck->nRecords - 1].seconds : 0.0; // resumed
+	double seconds;               // elapsed time of a record
+
+	D.rank = rank;
+	D.j0 = R->rowStart[rank];
+	D.j1 = R->rowStart[rank + 1];
+	D.strip = CreateSubdomainGrid(G, D.j0, D.j1);
+	if (D.strip == NULL)
+	{
+		R->transport->abort(R);
+		return HTS_ERROR_MEMORY;
+	}
+	do
+	{
+		for (color = 0; color < 2; color++) // the band's row 0 is plate row j0 - 1, so shift the colour
+		{
+			RelaxRedBlackRows(D.strip, R->SD, R->lamda, R->omega, (int)((color + D.j0 - 1) % 2), 1, D.strip->J - 1, NULL, NULL);
+			if (!R->transport->exchange(R, &D)) nStatus = HTS_ERROR_MEMORY;
+		}
+		GetResidualRows(D.strip, R->SD, R->lamda, 1, D.strip->J - 1, &rmax, &sumSq);
+		bStop = nStatus != HTS_OK;
+		if (nStatus == HTS_ERROR_MEMORY || !R->transport->reduce(R, &D, &rmax, &sumSq, &bStop))
+		{
+			nStatus = HTS_ERROR_MEMORY;
+			break;
+		}
+		if (bStop) break;
+		RMS = sqrt(sumSq / (((double)G->I - 2) * ((double)G->J - 2)));
+		iter++;
+		if (rank == 0 && (log != NULL || ck != NULL)) seconds = secondsBefore + secondsSince(start);
+		if (rank == 0 && log != NULL) logConvergence(log, rmax, RMS, seconds, iter);
+		if (rank == 0 && ck != NULL) nStatus = UpdateCheckpoint(G, R->SD, ck, rmax, RMS, seconds, iter);
+	} while (iter <= R->maxIter && rmax >= MAX_RESIDUAL && RMS >= MAX_RESIDUAL);
+
+	if (nStatus != HTS_ERROR_MEMORY) R->transport->gather(R, &D);
+	else R->transport->abort(R); // the others are, or will be, waiting for this rank
+	FreeSubdomainGrid(D.strip);
+	if (rank == 0)
+	{
+		R->iter = iter;
+		R->rmax = rmax;
+		R->RMS = RMS;
+	}
+	return nStatus;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Allocates the band of one rank: plate rows j0 - 1 .. j1 (the owned rows and a halo row on
+//               each side, the wall where the band touches one) with the plate's row layout, T_fd copied
+//               from the plate and res zeroed.  T_a is not allocated
+// ARGUMENTS:    G:      the plate grid
+//               j0, j1: first owned row and one past the last
+// RETURN VALUE: the band, NULL if out of memory
+PLATEGRID* CreateSubdomainGrid(const PLATEGRID* G, size_t j0, size_t j1)
+{
+	PLATEGRID* B;          // the band
+	size_t planeSize;      // doubles in one plane of the band
+	uintptr_t base;        // address of the raw block, rounded up to the alignment
+
+	B = (PLATEGRID*)calloc(1, sizeof(PLATEGRID));
+	if (B == NULL) return NULL;
+	B->I = G->I;
+	B->J = j1 - j0 + 2;
+	B->stride = G->stride;
+	B->dx = G->dx;
+	B->dy = G->dy;
+	planeSize = B->stride * B->J;
+	B->block = calloc(2 * planeSize * sizeof(double) + GRID_ALIGNMENT, 1);
+	if (B->block == NULL)
+	{
+		free(B);
+		return NULL;
+	}
+	base = ((uintptr_t)B->block + GRID_ALIGNMENT - 1) & ~(uintptr_t)(GRID_ALIGNMENT - 1);
+	B->T_fd = (double*)base;
+	B->res = B->T_fd + planeSize;
+	memcpy(B->T_fd, G->T_fd + (j0 - 1) * G->stride, planeSize * sizeof(double));
+	return B;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees a band from CreateSubdomainGrid (NULL is ignored)
+// ARGUMENTS:    B: the band
+// RETURN VALUE: none
+void FreeSubdomainGrid(PLATEGRID* B)
+{
+	if (B == NULL) return;
+	free(B->block);
+	free(B);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  The transport of a TRANSPORT setting.  A transport is a table of functions (see 
+//               HALO_TRANSPORT), so another one, such as MPI across machines, only has to fill the table
+// ARGUMENTS:    nTransport: TRANSPORT_THREADS or TRANSPORT_SHM
+// RETURN VALUE: the transport (THREADS where there is no SHM)
+const HALO_TRANSPORT* GetHaloTransport(int nTransport)
+{
+	static const HALO_TRANSPORT THREADS = { "threads", threadsOpen, threadsLaunch, sharedExchange, sharedReduce,
+		sharedGather, sharedAbort, threadsAlive, threadsJoin, threadsClose };
+#ifdef HTS_POSIX_SHM
+	static const HALO_TRANSPORT SHM = { "worker processes", shmOpen, shmLaunch, sharedExchange, sharedReduce,
+		sharedGather, sharedAbort, shmAlive, shmJoin, shmClose };
+	if (nTransport == TRANSPORT_SHM) return &SHM;
+#endif
+	(void)nTransport;
+	return &THREADS;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Halo exchange through the shared region: the rank publishes its first and last owned rows,
+//               waits for every rank, then copies its neighbours' edge rows into its halo rows.  The slots
+//               alternate between two sets, so a rank may publish the next exchange while a slower
+//               neighbour is still reading this one
+// ARGUMENTS:    R: the run
+//               D: this rank
+// RETURN VALUE: false if a rank failed
+bool sharedExchange(DD_RUN* R, DD_RANK* D)
+{
+	int p = D->nExchanges++ % 2;  // slot set
+	size_t n = R->G->I;           // doubles in a row
+	PLATEGRID* B = D->strip;      // the band
+
+	memcpy(ddHaloRow(R, p, D->rank, 0), B->T_fd + B->stride, n * sizeof(double));
+	memcpy(ddHaloRow(R, p, D->rank, 1), B->T_fd + (B->J - 2) * B->stride, n * sizeof(double));
+	if (!ddBarrier(R, D->rank)) return false;
+	if (D->rank > 0) memcpy(B->T_fd, ddHaloRow(R, p, D->rank - 1, 1), n * sizeof(double));
+	if (D->rank < R->nRanks - 1) memcpy(B->T_fd + (B->J - 1) * B->stride, ddHaloRow(R, p, D->rank + 1, 0), n * sizeof(double));
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Global reduction through the shared region: largest rmax, sum of sumSq (added in rank order,
+//               so every rank gets the same bits) and rank 0's stop flag
+// ARGUMENTS:    R:     the run
+//               D:     this rank
+//               rmax:  the band's largest residual, returns the global one
+//               sumSq: the band's sum of squared residuals, returns the global one
+//               bStop: rank 0's stop request, returns it on every rank
+// RETURN VALUE: false if a rank failed
+bool sharedReduce(DD_RUN* R, DD_RANK* D, double* rmax, double* sumSq, int* bStop)
+{
+	int p = D->nReductions++ % 2; // slot set
+	DD_SLOT* slot = R->shared->slot[p]; // one per rank
+	int r;                        // rank counter
+
+	slot[D->rank].rmax = *rmax;
+	slot[D->rank].sumSq = *sumSq;
+	slot[D->rank].bStop = *bStop;
+	if (!ddBarrier(R, D->rank)) return false;
+	*rmax = 0.0;
+	*sumSq = 0.0;
+	for (r = 0; r < R->nRanks; r++)
+	{
+		if (slot[r].rmax > *rmax) *rmax = slot[r].rmax;
+		*sumSq += slot[r].sumSq;
+	}
+	*bStop = slot[0].bStop;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Copies the owned rows of a band (T_fd and res) into the result planes of the shared region
+// ARGUMENTS:    R: the run
+//               D: this rank
+// RETURN VALUE: none
+void sharedGather(DD_RUN* R, DD_RANK* D)
+{
+	size_t j;                     // plate row
+	size_t s = R->G->stride;      // row length
+
+	for (j = D->j0; j < D->j1; j++)
+	{
+		memcpy(ddResultT(R) + j * s, D->strip->T_fd + (j - D->j0 + 1) * s, R->G->I * sizeof(double));
+		memcpy(ddResultRes(R) + j * s, D->strip->res + (j - D->j0 + 1) * s, R->G->I * sizeof(double));
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Tells every rank of the shared region to give up: their barriers return false from now on
+// ARGUMENTS:    R: the run
+// RETURN VALUE: none
+void sharedAbort(DD_RUN* R)
+{
+	R->shared->bAbort.store(1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Generation-counting barrier on the atomics of the shared region, which works between threads
+//               and between processes alike.  Waiting ranks yield, so more ranks than cores still progress.
+//               A rank asks the transport now and then whether the others are still alive, so a worker that
+//               died, or a rank 0 that did, does not leave the others waiting for ever
+// ARGUMENTS:    R:    the run
+//               rank: the waiting rank
+// RETURN VALUE: false if a rank failed
+bool ddBarrier(DD_RUN* R, int rank)
+{
+	DD_SHARED* S = R->shared;                      // the shared region
+	int nGeneration = S->nGeneration.load();       // generation this barrier waits out
+	unsigned long spins = 0;                       // polls so far
+
+	if (S->nArrived.fetch_add(1) + 1 == R->nRanks)
+	{
+		S->nArrived.store(0);
+		S->nGeneration.fetch_add(1);
+		return S->bAbort.load() == 0;
+	}
+	while (S->nGeneration.load() == nGeneration)
+	{
+		if (S->bAbort.load() != 0) return false;
+		if (++spins % DD_SPINS_PER_YIELD == 0) std::this_thread::yield();
+		if (spins % DD_SPINS_PER_CHECK == 0 && !R->transport->alive(R, rank)) S->bAbort.store(1);
+	}
+	return S->bAbort.load() == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Halo row of a rank in the shared region
+// ARGUMENTS:    R:    the run
+//               p:    slot set, 0 or 1
+//               rank: the publishing rank
+//               edge: 0 = its first owned row, 1 = its last
+// RETURN VALUE: the row
+double* ddHaloRow(DD_RUN* R, int p, int rank, int edge)
+{
+	return (double*)((char*)R->mem + R->haloOffset) + (((size_t)p * R->nRanks + rank) * 2 + edge) * R->G->stride;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Result planes of the shared region, laid out like T_fd and res of the plate
+// ARGUMENTS:    R: the run
+// RETURN VALUE: the T_fd (ddResultT) or res (ddResultRes) plane
+double* ddResultT(DD_RUN* R)
+{
+	return (double*)((char*)R->mem + R->resultOffset);
+}
+double* ddResultRes(DD_RUN* R)
+{
+	return ddResultT(R) + R->G->stride * R->G->J;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  TRANSPORT THREADS: ranks 1..n-1 are threads of this process and the shared region is 
+//               ordinary memory.  Used where there are no worker processes, and to test decompositions
+// ARGUMENTS:    R: the run
+// RETURN VALUE: open, launch, join: false on failure; alive: true
+bool threadsOpen(DD_RUN* R)
+{
+	R->mem = calloc(R->memBytes, 1);
+	if (R->mem == NULL) return false;
+	R->shared = new (R->mem) DD_SHARED();
+	return true;
+}
+bool threadsLaunch(DD_RUN* R)
+{
+	int r; // rank counter
+
+	R->threads = new (std::nothrow) std::thread[MAX_PROCESSES];
+	if (R->threads == NULL)
+	{
+		R->shared->bAbort.store(1);
+		return false;
+	}
+	for (r = 1; r < R->nRanks; r++)
+	{
+		try
+		{
+			R->threads[r] = std::thread([R, r]() { R->status[r] = RunSubdomain(R, r, NULL, NULL); });
+		}
+		catch (...)
+		{
+			R->status[r] = HTS_ERROR_MEMORY;
+			R->shared->bAbort.store(1);
+			return false;
+		}
+	}
+	return true;
+}
+bool threadsAlive(DD_RUN*, int)
+{
+	return true; // a failing thread sets bAbort itself
+}
+bool threadsJoin(DD_RUN* R)
+{
+	bool bOk = true; // every rank finished its loop
+	int r;           // rank counter
+
+	for (r = 1; r < R->nRanks && R->threads != NULL; r++)
+	{
+		if (R->threads[r].joinable()) R->threads[r].join();
+		else bOk = false;
+		bOk = bOk && R->status[r] != HTS_ERROR_MEMORY;
+	}
+	return bOk && R->threads != NULL && R->shared->bAbort.load() == 0;
+}
+void threadsClose(DD_RUN* R)
+{
+	delete[] R->threads;
+	R->threads = NULL;
+	R->shared->~DD_SHARED();
+	free(R->mem);
+}
+
+#ifdef HTS_POSIX_SHM
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  TRANSPORT SHM: ranks 1..n-1 are worker processes, new runs of this program started with
+//               posix_spawn (no fork, which is unsafe once the output thread or the batch workers run) and
+//               DD_WORKER_OPTION.  The shared region is a named POSIX shared memory object holding, besides
+//               the barrier and the halo rows, a DD_IMAGE of the run and the starting T_fd in the result
+//               plane, which is all a worker needs (see RunSubdomainWorker).  The name is unlinked by close
+// ARGUMENTS:    R:    the run
+//               rank: alive: the asking rank
+// RETURN VALUE: open, launch, join: false on failure; alive: false once a worker, or rank 0, has died
+bool shmOpen(DD_RUN* R)
+{
+	static std::atomic<int> nRegions(0); // regions opened, so concurrent cases get different names
+	void* mem;  // the mapping
+	int fd;     // the shared memory object
+
+	snprintf(R->strRegion, sizeof(R->strRegion), "/hts-dd-%d-%d", (int)getpid(), nRegions.fetch_add(1));
+	fd = shm_open(R->strRegion, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0) return false;
+	mem = ftruncate(fd, (off_t)R->memBytes) == 0 ?
+		mmap(NULL, R->memBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (mem == MAP_FAILED)
+	{
+		shm_unlink(R->strRegion);
+		return false;
+	}
+	R->mem = mem;
+	R->shared = new (R->mem) DD_SHARED();
+	return true;
+}
+bool shmLaunch(DD_RUN* R)
+{
+	DD_IMAGE* M = &R->shared->image; // the run, for the workers
+	const char* strPath = access("/proc/self/exe", X_OK) == 0 ? "/proc/self/exe" : strProgram; // this program
+	char strRank[16];  // argv[3] of a worker
+	char* args[5];     // its argv
+	pid_t pid;         // a worker
+	size_t j;          // row counter
+	int r;             // rank counter
+
+	M->SD = *R->SD;
+	M->I = R->G->I;
+	M->J = R->G->J;
+	M->stride = R->G->stride;
+	M->dx = R->G->dx;
+	M->dy = R->G->dy;
+	M->lamda = R->lamda;
+	M->omega = R->omega;
+	M->nRanks = R->nRanks;
+	memcpy(M->rowStart, R->rowStart, sizeof(M->rowStart));
+	M->iterStart = R->iterStart;
+	M->maxIter = R->maxIter;
+	M->memBytes = R->memBytes;
+	M->haloOffset = R->haloOffset;
+	M->resultOffset = R->resultOffset;
+	M->nParent = (int)getpid();
+	for (j = 0; j < R->G->J; j++) // each band starts from here, rank 0 overwrites its rows only in the gather
+		memcpy(ddResultT(R) + j * R->G->stride, R->G->T_fd + j * R->G->stride, R->G->I * sizeof(double));
+
+	args[0] = (char*)strPath;
+	args[1] = (char*)DD_WORKER_OPTION;
+	args[2] = R->strRegion;
+	args[3] = strRank;
+	args[4] = NULL;
+	for (r = 1; r < R->nRanks; r++)
+	{
+		snprintf(strRank, sizeof(strRank), "%d", r);
+		if (strPath == NULL || posix_spawn(&pid, strPath, NULL, NULL, args, environ) != 0)
+		{
+			R->shared->bAbort.store(1);
+			return false;
+		}
+		R->pid[r] = pid;
+	}
+	return true;
+}
+bool shmAlive(DD_RUN* R, int rank)
+{
+	int r;      // rank counter
+	int status; // exit status of a worker
+
+	if (rank > 0) return (int)getppid() == R->shared->image.nParent; // a worker outlives a killed rank 0
+	for (r = 1; r < R->nRanks; r++)
+	{
+		if (R->pid[r] > 0 && waitpid(R->pid[r], &status, WNOHANG) == R->pid[r])
+		{
+			R->pid[r] = 0; // reaped: it can only have died, a healthy worker is still in the loop
+			return false;
+		}
+	}
+	return true;
+}
+bool shmJoin(DD_RUN* R)
+{
+	bool bOk = R->shared->bAbort.load() == 0; // no rank failed
+	int r;      // rank counter
+	int status; // exit status of a worker
+
+	for (r = 1; r < R->nRanks; r++)
+	{
+		if (R->pid[r] <= 0)
+		{
+			bOk = false;
+			continue;
+		}
+		bOk = waitpid(R->pid[r], &status, 0) == R->pid[r] && WIFEXITED(status) && WEXITSTATUS(status) == 0 && bOk;
+		R->pid[r] = 0;
+	}
+	return bOk;
+}
+void shmClose(DD_RUN* R)
+{
+	R->shared->~DD_SHARED();
+	munmap(R->mem, R->memBytes);
+	shm_unlink(R->strRegion);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  The whole life of a TRANSPORT SHM worker, run by main for DD_WORKER_OPTION before it reads
+//               simulations.in.  Maps the named region, rebuilds the run from its DD_IMAGE (the plate is 
+//               only the sizes and the starting T_fd in the result plane) and runs one rank.  SIGINT and 
+//               SIGTERM are ignored: a Ctrl+C reaches the whole process group, and rank 0 stops the workers
+//               through the next reduction after saving its checkpoint
+// ARGUMENTS:    strRegion: name of the shared memory object
+//               rank:      the rank to run, 1 .. nRanks - 1
+// RETURN VALUE: the exit status of the process: 0 if the rank gathered its band, 1 otherwise
+int RunSubdomainWorker(const char* strRegion, int rank)
+{
+	DD_RUN* R;         // the run
+	PLATEGRID G = {};  // the plate: sizes and T_fd only
+	DD_IMAGE* M;       // the run as rank 0 wrote it
+	struct stat st;    // size of the shared memory object
+	void* mem;         // the mapping
+	int fd;            // the shared memory object
+	int nStatus;       // status of the rank
+
+	signal(SIGINT, SIG_IGN);
+	signal(SIGTERM, SIG_IGN);
+	fd = shm_open(strRegion, O_RDWR, 0);
+	if (fd < 0) return 1;
+	mem = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(DD_SHARED) ?
+		mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (mem == MAP_FAILED) return 1;
+	M = &((DD_SHARED*)mem)->image;
+	R = new (std::nothrow) DD_RUN();
+	if (R == NULL || rank < 1 || rank >= M->nRanks || M->memBytes != (size_t)st.st_size)
+	{
+		((DD_SHARED*)mem)->bAbort.store(1);
+		munmap(mem, (size_t)st.st_size);
+		delete R;
+		return 1;
+	}
+	G.I = M->I;
+	G.J = M->J;
+	G.stride = M->stride;
+	G.dx = M->dx;
+	G.dy = M->dy;
+	R->G = &G;
+	R->SD = &M->SD;
+	R->lamda = M->lamda;
+	R->omega = M->omega;
+	R->nRanks = M->nRanks;
+	memcpy(R->rowStart, M->rowStart, sizeof(R->rowStart));
+	R->iterStart = M->iterStart;
+	R->maxIter = M->maxIter;
+	R->transport = GetHaloTransport(TRANSPORT_SHM);
+	R->mem = mem;
+	R->memBytes = M->memBytes;
+	R->haloOffset = M->haloOffset;
+	R->resultOffset = M->resultOffset;
+	R->shared = (DD_SHARED*)mem;
+	G.T_fd = ddResultT(R);
+
+	nStatus = RunSubdomain(R, rank, NULL, NULL);
+	munmap(mem, R->memBytes);
+	delete R;
+	return nStatus == HTS_ERROR_MEMORY ? 1 : 0;
+}
+#endif
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Starts a pool of nThreads - 1 helper threads that wait for jobs from RunThreadPool.  If the
+//               system runs out of threads part way, the pool keeps the helpers it got
+// ARGUMENTS:    nThreads: threads per job including the calling thread
+// RETURN VALUE: the pool, NULL if out of memory
+THREAD_POOL* CreateThreadPool(int nThreads)
+{
+	THREAD_POOL* pool = new (std::nothrow) THREAD_POOL(); // zeroed, with constructed mutex and condition variables
+	int n; // counter
+
+	if (pool == NULL) return NULL;
+	if (nThreads > MAX_THREADS) nThreads = MAX_THREADS;
+	if (nThreads < 1) nThreads = 1;
+	pool->workers = new (std::nothrow) std::thread[nThreads - 1];
+	if (pool->workers == NULL)
+	{
+		delete pool;
+		return NULL;
+	}
+	for (n = 1; n < nThreads; n++)
+	{
+		try
+		{
+			pool->workers[n - 1] = std::thread(threadPoolWorker, pool, n);
+		}
+		catch (const std::system_error&)
+		{
+			break;
+		}
+	}
+	pool->nThreads = n; // no job has run yet, so the helpers see this before they read it
+
+	return pool;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Stops and joins the helper threads and frees the pool
+// ARGUMENTS:    pool: the pool, may be NULL
+// RETURN VALUE: none
+void FreeThreadPool(THREAD_POOL* pool)
+{
+	int n; // counter
+
+	if (pool == NULL) return;
+	{
+		std::lock_guard<std::mutex> guard(pool->lock);
+		pool->bQuit = true;
+	}
+	pool->wake.notify_all();
+	for (n = 0; n < pool->nThreads - 1; n++) pool->workers[n].join();
+	delete[] pool->workers;
+	delete pool;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Runs a job on every thread of the pool (the caller is thread 0) and returns once all of 
+//               them have finished, so consecutive jobs are separated by a full barrier
+// ARGUMENTS:    pool:  the pool
+//               job:   the work, called as job(pArgs, iThread, nThreads)
+//               pArgs: arguments for the job
+// RETURN VALUE: none
+void RunThreadPool(THREAD_POOL* pool, POOL_JOB job, void* pArgs)
+{
+	{
+		std::lock_guard<std::mutex> guard(pool->lock);
+		pool->job = job;
+		pool->pArgs = pArgs;
+		pool->nBusy = pool->nThreads - 1;
+		pool->generation++;
+	}
+	pool->wake.notify_all();
+	job(pArgs, 0, pool->nThreads);
+	std::unique_lock<std::mutex> guard(pool->lock);
+	pool->done.wait(guard, [pool] { return pool->nBusy == 0; });
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Helper thread main loop: wait for a new job generation, run it, report back
+// ARGUMENTS:    pool:    the pool
+//               iThread: this helper's thread index (1 .. nThreads - 1)
+// RETURN VALUE: none
+void threadPoolWorker(THREAD_POOL* pool, int iThread)
+{
+	unsigned long seen = 0; // last generation this helper ran
+	POOL_JOB job;           // local copies taken under the lock
+	void* pArgs;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(pool->lock);
+			pool->wake.wait(guard, [pool, seen] { return pool->bQuit || pool->generation != seen; });
+			if (pool->bQuit) return;
+			seen = pool->generation;
+			job = pool->job;
+			pArgs = pool->pArgs;
+		}
+		job(pArgs, iThread, pool->nThreads);
+		{
+			std::lock_guard<std::mutex> guard(pool->lock);
+			if (--pool->nBusy == 0) pool->done.notify_one();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Splits the interior rows 1 .. J-2 into nThreads contiguous bands
+// ARGUMENTS:    iThread, nThreads: this thread and the number of threads
+//               J:                 number of nodes in y
+//               j0, j1:            return the first row and one past the last row of the band
+// RETURN VALUE: none
+void getRowRange(int iThread, int nThreads, size_t J, size_t* j0, size_t* j1)
+{
+	size_t nRows = J - 2; // interior rows
+
+	*j0 = 1 + nRows * (size_t)iThread / (size_t)nThreads;
+	*j1 = 1 + nRows * (size_t)(iThread + 1) / (size_t)nThreads;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One red-black SOR sweep with the rows split across the pool.  All red nodes are finished
+//               (barrier) before any black node is relaxed, so the result matches the serial sweep
+// ARGUMENTS:    pool: the pool
+//               job:  plate, lamda and omega of the sweep, receives the partial reductions of a fused sweep
+//               rmax: returns the largest pre-update residual if job->bFused
+//               RMS:  returns the RMS of the pre-update residuals if job->bFused
+// RETURN VALUE: none
+void SweepRedBlackSORParallel(THREAD_POOL* pool, SWEEP_JOB* job, double* rmax, double* RMS)
+{
+	for (job->color = 0; job->color < 2; job->color++) RunThreadPool(pool, relaxRowsJob, job);
+	if (job->bFused) combineResidualPartials(pool, job, rmax, RMS);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Residual pass with the rows split across the pool.  Each thread reduces its own rows
+//               into its own cache line and the caller combines the partial rmax and sums
+// ARGUMENTS:    pool: the pool
+//               job:  plate and lamda of the sweep, receives the partial reductions
+//               rmax: returns the largest residual
+//               RMS:  returns the RMS residual
+// RETURN VALUE: none
+void GetResidualParallel(THREAD_POOL* pool, SWEEP_JOB* job, double* rmax, double* RMS)
+{
+	RunThreadPool(pool, residualRowsJob, job);
+	combineResidualPartials(pool, job, rmax, RMS);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Combines the per-thread residual reductions of a residual pass or a fused sweep
+// ARGUMENTS:    pool: the pool
+//               job:  holds the partial reductions
+//               rmax: returns the largest residual
+//               RMS:  returns the RMS residual
+// RETURN VALUE: none
+void combineResidualPartials(const THREAD_POOL* pool, const SWEEP_JOB* job, double* rmax, double* RMS)
+{
+	double sumSq = 0.0; // sum of squared residuals
+	int n;              // counter
+
+	*rmax = 0.0;
+	for (n = 0; n < pool->nThreads; n++)
+	{
+		if (job->partial[n].rmax > *rmax) *rmax = job->partial[n].rmax;
+		sumSq += job->partial[n].sumSq;
+	}
+	*RMS = sqrt(sumSq / (((double)job->G->I - 2) * ((double)job->G->J - 2)));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Pool job: relaxes the current colour in this thread's band of rows.  A fused sweep 
+//               accumulates both colours into the thread's partial reduction slot
+// ARGUMENTS:    pArgs:             the SWEEP_JOB
+//               iThread, nThreads: this thread and the number of threads
+// RETURN VALUE: none
+void relaxRowsJob(void* pArgs, int iThread, int nThreads)
+{
+	SWEEP_JOB* job = (SWEEP_JOB*)pArgs;
+	RESIDUAL_PARTIAL* p = &job->partial[iThread]; // this thread's reductions
+	size_t j0, j1; // this thread's rows
+
+	getRowRange(iThread, nThreads, job->G->J, &j0, &j1);
+	if (job->bFused && job->color == 0) p->rmax = p->sumSq = 0.0;
+	RelaxRedBlackRows(job->G, job->SD, job->lamda, job->omega, job->color, j0, j1,
+		job->bFused ? &p->rmax : NULL, &p->sumSq);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Pool job: residual of this thread's band of rows into its partial reduction slot
+// ARGUMENTS:    pArgs:             the SWEEP_JOB
+//               iThread, nThreads: this thread and the number of threads
+// RETURN VALUE: none
+void residualRowsJob(void* pArgs, int iThread, int nThreads)
+{
+	SWEEP_JOB* job = (SWEEP_JOB*)pArgs;
+	size_t j0, j1; // this thread's rows
+
+	getRowRange(iThread, nThreads, job->G->J, &j0, &j1);
+	GetResidualRows(job->G, job->SD, job->lamda, j0, j1, &job->partial[iThread].rmax, &job->partial[iThread].sumSq);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Picks the row kernels.  The CPU is queried once; a requested instruction set the CPU (or
+//               this build) does not support falls back to the next narrower one
+// ARGUMENTS:    nSimd: SIMD_AUTO, SIMD_SCALAR, SIMD_AVX2 or SIMD_AVX512
+// RETURN VALUE: the kernel table
+const STENCIL_KERNELS* GetStencilKernels(int nSimd)
+{
+	static const STENCIL_KERNELS kernels[] =  // indexed by SIMD_SCALAR .. SIMD_AVX512, less one
+	{
+		{ "scalar", relaxRowScalar, relaxResidualRowScalar, residualRowScalar, relaxRowFloatScalar },
+#ifdef HTS_X86_SIMD
+		{ "AVX2", relaxRowAVX2, relaxResidualRowAVX2, residualRowAVX2, relaxRowFloatAVX2 },
+		{ "AVX-512", relaxRowAVX512, relaxResidualRowAVX512, residualRowAVX512, relaxRowFloatAVX512 },
+#endif
+	};
+	static const int nCpuLevel = getCpuSimdLevel(); // widest level the CPU and OS support
+
+	if (nSimd == SIMD_AUTO || nSimd > nCpuLevel) nSimd = nCpuLevel;
+	return &kernels[nSimd - SIMD_SCALAR];
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Finds the widest SIMD instruction set this CPU and operating system support
+// ARGUMENTS:    none
+// RETURN VALUE: SIMD_SCALAR, SIMD_AVX2 or SIMD_AVX512
+int getCpuSimdLevel()
+{
+#ifdef HTS_X86_SIMD
+#if defined(_MSC_VER)
+	int info[4];               // eax, ebx, ecx, edx
+	unsigned long long xcr0;   // register state the OS saves on a context switch
+
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0) return SIMD_SCALAR; // no OSXSAVE, so no AVX state
+	xcr0 = _xgetbv(0);
+	__cpuidex(info, 7, 0);
+	if ((info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6) return SIMD_AVX512;
+	if ((info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6) return SIMD_AVX2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#endif
+#endif
+	return SIMD_SCALAR;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Scalar row kernels (and the reference for the SIMD ones).  relaxRow visits only the nodes
+//               of one colour; residualRow visits every node
+// ARGUMENTS:    see STENCIL_KERNELS
+// RETURN VALUE: none
+void relaxRowScalar(double* T, const double* Tn, const double* Ts, size_t I, int parity, double lamda, double omega)
+{
+	size_t i;                               // counter
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+
+	for (i = 2 - parity; i < I - 1; i += 2) // first interior node with i % 2 == parity
+		T[i] += omega * ((T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c - T[i]);
+}
+
+void relaxResidualRowScalar(double* T, const double* Tn, const double* Ts, size_t I, int parity, double lamda,
+	double omega, double* rmax, double* sumSq)
+{
+	size_t i;                               // counter
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	double r;                               // pre-update residual
+	double rm = *rmax, sum = *sumSq;        // local reductions, they cannot alias T
+
+	for (i = 2 - parity; i < I - 1; i += 2)
+	{
+		r = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c - T[i];
+		T[i] += omega * r;
+		rm = fabs(r) > rm ? fabs(r) : rm;
+		sum += r * r;
+	}
+	*rmax = rm;
+	*sumSq = sum;
+}
+
+void residualRowScalar(const double* T, const double* Tn, const double* Ts, double* R, size_t I, double lamda,
+	double* rmax, double* sumSq)
+{
+	size_t i; // counter
+
+	for (i = 1; i < I - 1; i++)
+	{
+		R[i] = fabs(T[i] - (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) / (2.0 * (1.0 + lamda)));
+		if (R[i] > *rmax) *rmax = R[i];
+		*sumSq += R[i] * R[i];
+	}
+}
+
+void relaxRowFloatScalar(float* E, const float* En, const float* Es, const float* F, size_t I, int parity,
+	float lamda, float omega, double* rmax, double* sumSq)
+{
+	size_t i;                               // counter
+	float c = 1.0f / (2.0f * (1.0f + lamda)); // stencil weight
+	float r;                                // pre-update residual
+	double rm = *rmax, sum = *sumSq;        // local reductions, they cannot alias E
+
+	for (i = 2 - parity; i < I - 1; i += 2)
+	{
+		r = (E[i + 1] + E[i - 1] + lamda * (En[i] + Es[i])) * c - E[i];
+		if (F != NULL) r += F[i];
+		E[i] += omega * r;
+		rm = fabs(r) > rm ? fabs(r) : rm;
+		sum += (double)r * r;
+	}
+	*rmax = rm;
+	*sumSq = sum;
+}
+
+#ifdef HTS_X86_SIMD
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  AVX2 row kernels, 4 nodes per instruction.  relaxRow computes the update for every lane
+//               and blends in only the lanes of the colour being relaxed; their neighbours all have the 
+//               other colour, so no lane depends on another and the result is bit-for-bit the scalar one.
+//               No FMA is used for the same reason.  The east and west neighbours are shuffled out of 
+//               registers rather than reloaded from T, because an unaligned load overlapping the previous
+//               store cannot be forwarded and stalls every iteration.  Leftover nodes run scalar
+// ARGUMENTS:    see STENCIL_KERNELS
+// RETURN VALUE: none
+// lanes 1..3 of t and lane 0 of next, i.e. the east neighbours of t
+TARGET_AVX2 inline __m256d shiftEastAVX2(__m256d t, __m256d next)
+{
+	return _mm256_permute4x64_pd(_mm256_blend_pd(t, next, 0x1), 0x39);
+}
+
+// lane 3 of prev and lanes 0..2 of t, i.e. the west neighbours of t
+TARGET_AVX2 inline __m256d shiftWestAVX2(__m256d t, __m256d prev)
+{
+	return _mm256_permute4x64_pd(_mm256_blend_pd(t, prev, 0x8), 0x93);
+}
+
+TARGET_AVX2 void relaxRowAVX2(double* T, const double* Tn, const double* Ts, size_t I, int parity, double lamda,
+	double omega)
+{
+	size_t i = 1;                           // first interior node, lane k of a vector holds node i + k
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	__m256d vl = _mm256_set1_pd(lamda), vc = _mm256_set1_pd(c), vw = _mm256_set1_pd(omega);
+	__m256d t, tnew;                        // old and relaxed nodes
+	__m256d tprev = _mm256_set1_pd(T[0]);   // old nodes of the previous vector (lane 3 is the west neighbour)
+	// vectors start at odd i, so lanes 0 and 2 are the odd nodes
+	__m256d mask = _mm256_castsi256_pd(parity == 1 ? _mm256_set_epi64x(0, -1, 0, -1) : _mm256_set_epi64x(-1, 0, -1, 0));
+
+	for (; i + 4 <= I - 1; i += 4)
+	{
+		t = _mm256_loadu_pd(T + i);
+		tnew = _mm256_add_pd(shiftEastAVX2(t, _mm256_broadcast_sd(T + i + 4)), shiftWestAVX2(t, tprev));
+		tnew = _mm256_add_pd(tnew, _mm256_mul_pd(vl, _mm256_add_pd(_mm256_loadu_pd(Tn + i), _mm256_loadu_pd(Ts + i))));
+		tnew = _mm256_add_pd(t, _mm256_mul_pd(vw, _mm256_sub_pd(_mm256_mul_pd(tnew, vc), t)));
+		_mm256_storeu_pd(T + i, _mm256_blendv_pd(t, tnew, mask));
+		tprev = t;
+	}
+	for (; i < I - 1; i++)
+		if (i % 2 == (size_t)parity) T[i] += omega * ((T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c - T[i]);
+}
+
+TARGET_AVX2 void relaxResidualRowAVX2(double* T, const double* Tn, const double* Ts, size_t I, int parity,
+	double lamda, double omega, double* rmax, double* sumSq)
+{
+	size_t i = 1;                           // first interior node, lane k of a vector holds node i + k
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	double r;                               // pre-update residual of a leftover node
+	double lanes[4];                        // horizontal reduction buffer
+	__m256d vl = _mm256_set1_pd(lamda), vc = _mm256_set1_pd(c), vw = _mm256_set1_pd(omega);
+	__m256d sign = _mm256_set1_pd(-0.0);    // clears the sign bit for fabs
+	__m256d vmax = _mm256_setzero_pd(), vsum = _mm256_setzero_pd();
+	__m256d t, g;                           // old nodes, their pre-update residuals
+	__m256d tprev = _mm256_set1_pd(T[0]);   // old nodes of the previous vector (lane 3 is the west neighbour)
+	__m256d mask = _mm256_castsi256_pd(parity == 1 ? _mm256_set_epi64x(0, -1, 0, -1) : _mm256_set_epi64x(-1, 0, -1, 0));
+
+	for (; i + 4 <= I - 1; i += 4)
+	{
+		t = _mm256_loadu_pd(T + i);
+		g = _mm256_add_pd(shiftEastAVX2(t, _mm256_broadcast_sd(T + i + 4)), shiftWestAVX2(t, tprev));
+		g = _mm256_add_pd(g, _mm256_mul_pd(vl, _mm256_add_pd(_mm256_loadu_pd(Tn + i), _mm256_loadu_pd(Ts + i))));
+		g = _mm256_sub_pd(_mm256_mul_pd(g, vc), t);
+		_mm256_storeu_pd(T + i, _mm256_blendv_pd(t, _mm256_add_pd(t, _mm256_mul_pd(vw, g)), mask));
+		tprev = t;
+		g = _mm256_and_pd(mask, _mm256_andnot_pd(sign, g)); // the other colour's lanes count as zero
+		vmax = _mm256_max_pd(vmax, g);
+		vsum = _mm256_add_pd(vsum, _mm256_mul_pd(g, g));
+	}
+	_mm256_storeu_pd(lanes, vmax);
+	for (int k = 0; k < 4; k++) if (lanes[k] > *rmax) *rmax = lanes[k];
+	_mm256_storeu_pd(lanes, vsum);
+	*sumSq += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < I - 1; i++)
+	{
+		if (i % 2 != (size_t)parity) continue;
+		r = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c - T[i];
+		T[i] += omega * r;
+		if (fabs(r) > *rmax) *rmax = fabs(r);
+		*sumSq += r * r;
+	}
+}
+
+TARGET_AVX2 void residualRowAVX2(const double* T, const double* Tn, const double* Ts, double* R, size_t I,
+	double lamda, double* rmax, double* sumSq)
+{
+	size_t i = 1;                                // counter
+	double d = 2.0 * (1.0 + lamda);              // stencil divisor
+	double lanes[4];                             // horizontal reduction buffer
+	__m256d vl = _mm256_set1_pd(lamda), vd = _mm256_set1_pd(d);
+	__m256d sign = _mm256_set1_pd(-0.0);         // clears the sign bit for fabs
+	__m256d vmax = _mm256_setzero_pd(), vsum = _mm256_setzero_pd();
+	__m256d r;                                   // residuals of 4 nodes
+
+	for (; i + 4 <= I - 1; i += 4)
+	{
+		r = _mm256_add_pd(_mm256_loadu_pd(T + i + 1), _mm256_loadu_pd(T + i - 1));
+		r = _mm256_add_pd(r, _mm256_mul_pd(vl, _mm256_add_pd(_mm256_loadu_pd(Tn + i), _mm256_loadu_pd(Ts + i))));
+		r = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(T + i), _mm256_div_pd(r, vd)));
+		_mm256_storeu_pd(R + i, r);
+		vmax = _mm256_max_pd(vmax, r);
+		vsum = _mm256_add_pd(vsum, _mm256_mul_pd(r, r));
+	}
+	_mm256_storeu_pd(lanes, vmax);
+	for (int k = 0; k < 4; k++) if (lanes[k] > *rmax) *rmax = lanes[k];
+	_mm256_storeu_pd(lanes, vsum);
+	*sumSq += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < I - 1; i++)
+	{
+		R[i] = fabs(T[i] - (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) / d);
+		if (R[i] > *rmax) *rmax = R[i];
+		*sumSq += R[i] * R[i];
+	}
+}
+
+// float32 kernel of PRECISION MIXED, 8 nodes per instruction; lanes 1..7 of t and lane 0 of next
+TARGET_AVX2 inline __m256 shiftEastFloatAVX2(__m256 t, __m256 next)
+{
+	return _mm256_permutevar8x32_ps(_mm256_blend_ps(t, next, 0x01), _mm256_set_epi32(0, 7, 6, 5, 4, 3, 2, 1));
+}
+
+// lane 7 of prev and lanes 0..6 of t
+TARGET_AVX2 inline __m256 shiftWestFloatAVX2(__m256 t, __m256 prev)
+{
+	return _mm256_permutevar8x32_ps(_mm256_blend_ps(t, prev, 0x80), _mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 7));
+}
+
+TARGET_AVX2 void relaxRowFloatAVX2(float* E, const float* En, const float* Es, const float* F, size_t I, int parity,
+	float lamda, float omega, double* rmax, double* sumSq)
+{
+	size_t i = 1;                           // first interior node, lane k of a vector holds node i + k
+	float c = 1.0f / (2.0f * (1.0f + lamda)); // stencil weight
+	float r;                                // pre-update residual of a leftover node
+	float lanes[8];                         // horizontal reduction buffer
+	__m256 vl = _mm256_set1_ps(lamda), vc = _mm256_set1_ps(c), vw = _mm256_set1_ps(omega);
+	__m256 sign = _mm256_set1_ps(-0.0f);    // clears the sign bit for fabs
+	__m256 vmax = _mm256_setzero_ps(), vsum = _mm256_setzero_ps();
+	__m256 t, g;                            // old nodes, their pre-update residuals
+	__m256 tprev = _mm256_set1_ps(E[0]);    // old nodes of the previous vector (lane 7 is the west neighbour)
+	// vectors start at odd i, so the even lanes are the odd nodes
+	__m256 mask = _mm256_castsi256_ps(parity == 1 ? _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1) :
+		_mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0));
+
+	for (; i + 8 <= I - 1; i += 8)
+	{
+		t = _mm256_loadu_ps(E + i);
+		g = _mm256_add_ps(shiftEastFloatAVX2(t, _mm256_broadcast_ss(E + i + 8)), shiftWestFloatAVX2(t, tprev));
+		g = _mm256_add_ps(g, _mm256_mul_ps(vl, _mm256_add_ps(_mm256_loadu_ps(En + i), _mm256_loadu_ps(Es + i))));
+		g = _mm256_sub_ps(_mm256_mul_ps(g, vc), t);
+		if (F != NULL) g = _mm256_add_ps(g, _mm256_loadu_ps(F + i));
+		_mm256_storeu_ps(E + i, _mm256_blendv_ps(t, _mm256_add_ps(t, _mm256_mul_ps(vw, g)), mask));
+		tprev = t;
+		g = _mm256_and_ps(mask, _mm256_andnot_ps(sign, g)); // the other colour's lanes count as zero
+		vmax = _mm256_max_ps(vmax, g);
+		vsum = _mm256_add_ps(vsum, _mm256_mul_ps(g, g));
+	}
+	_mm256_storeu_ps(lanes, vmax);
+	for (int k = 0; k < 8; k++) if (lanes[k] > *rmax) *rmax = lanes[k];
+	_mm256_storeu_ps(lanes, vsum);
+	for (int k = 0; k < 8; k++) *sumSq += lanes[k];
+	for (; i < I - 1; i++)
+	{
+		if (i % 2 != (size_t)parity) continue;
+		r = (E[i + 1] + E[i - 1] + lamda * (En[i] + Es[i])) * c - E[i];
+		if (F != NULL) r += F[i];
+		E[i] += omega * r;
+		if (fabs(r) > *rmax) *rmax = fabs(r);
+		*sumSq += (double)r * r;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  AVX-512 row kernels, 8 nodes per instruction.  Same scheme as the AVX2 kernels, with a
+//               masked store writing only the lanes of the colour being relaxed and valignq building the
+//               east and west neighbours
+// ARGUMENTS:    see STENCIL_KERNELS
+// RETURN VALUE: none
+// lanes 1..7 of t and lane 0 of next, i.e. the east neighbours of t
+TARGET_AVX512 inline __m512d shiftEastAVX512(__m512d t, __m512d next)
+{
+	return _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(next), _mm512_castpd_si512(t), 1));
+}
+
+// lane 7 of prev and lanes 0..6 of t, i.e. the west neighbours of t
+TARGET_AVX512 inline __m512d shiftWestAVX512(__m512d t, __m512d prev)
+{
+	return _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(t), _mm512_castpd_si512(prev), 7));
+}
+
+TARGET_AVX512 void relaxRowAVX512(double* T, const double* Tn, const double* Ts, size_t I, int parity, double lamda,
+	double omega)
+{
+	size_t i = 1;                           // first interior node, lane k of a vector holds node i + k
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	__m512d vl = _mm512_set1_pd(lamda), vc = _mm512_set1_pd(c), vw = _mm512_set1_pd(omega);
+	__m512d t, tnew;                        // old and relaxed nodes
+	__m512d tprev = _mm512_set1_pd(T[0]);   // old nodes of the previous vector (lane 7 is the west neighbour)
+	__mmask8 mask = parity == 1 ? 0x55 : 0xAA; // vectors start at odd i, so the even lanes are odd nodes
+
+	for (; i + 8 <= I - 1; i += 8)
+	{
+		t = _mm512_loadu_pd(T + i);
+		tnew = _mm512_add_pd(shiftEastAVX512(t, _mm512_set1_pd(T[i + 8])), shiftWestAVX512(t, tprev));
+		tnew = _mm512_add_pd(tnew, _mm512_mul_pd(vl, _mm512_add_pd(_mm512_loadu_pd(Tn + i), _mm512_loadu_pd(Ts + i))));
+		tnew = _mm512_add_pd(t, _mm512_mul_pd(vw, _mm512_sub_pd(_mm512_mul_pd(tnew, vc), t)));
+		_mm512_mask_storeu_pd(T + i, mask, tnew);
+		tprev = t;
+	}
+	for (; i < I - 1; i++)
+		if (i % 2 == (size_t)parity) T[i] += omega * ((T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c - T[i]);
+}
+
+TARGET_AVX512 void relaxResidualRowAVX512(double* T, const double* Tn, const double* Ts, size_t I, int parity,
+	double lamda, double omega, double* rmax, double* sumSq)
+{
+	size_t i = 1;                           // first interior node, lane k of a vector holds node i + k
+	double c = 1.0 / (2.0 * (1.0 + lamda)); // stencil weight
+	double r, m;                            // pre-update residual of a leftover node, largest lane
+	__m512d vl = _mm512_set1_pd(lamda), vc = _mm512_set1_pd(c), vw = _mm512_set1_pd(omega);
+	__m512d vmax = _mm512_setzero_pd(), vsum = _mm512_setzero_pd();
+	__m512d t, g;                           // old nodes, their pre-update residuals
+	__m512d tprev = _mm512_set1_pd(T[0]);   // old nodes of the previous vector (lane 7 is the west neighbour)
+	__mmask8 mask = parity == 1 ? 0x55 : 0xAA; // vectors start at odd i, so the even lanes are odd nodes
+
+	for (; i + 8 <= I - 1; i += 8)
+	{
+		t = _mm512_loadu_pd(T + i);
+		g = _mm512_add_pd(shiftEastAVX512(t, _mm512_set1_pd(T[i + 8])), shiftWestAVX512(t, tprev));
+		g = _mm512_add_pd(g, _mm512_mul_pd(vl, _mm512_add_pd(_mm512_loadu_pd(Tn + i), _mm512_loadu_pd(Ts + i))));
+		g = _mm512_sub_pd(_mm512_mul_pd(g, vc), t);
+		_mm512_mask_storeu_pd(T + i, mask, _mm512_add_pd(t, _mm512_mul_pd(vw, g)));
+		tprev = t;
+		g = _mm512_maskz_mov_pd(mask, _mm512_abs_pd(g)); // the other colour's lanes count as zero
+		vmax = _mm512_max_pd(vmax, g);
+		vsum = _mm512_add_pd(vsum, _mm512_mul_pd(g, g));
+	}
+	m = _mm512_reduce_max_pd(vmax);
+	if (m > *rmax) *rmax = m;
+	*sumSq += _mm512_reduce_add_pd(vsum);
+	for (; i < I - 1; i++)
+	{
+		if (i % 2 != (size_t)parity) continue;
+		r = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) * c - T[i];
+		T[i] += omega * r;
+		if (fabs(r) > *rmax) *rmax = fabs(r);
+		*sumSq += r * r;
+	}
+}
+
+TARGET_AVX512 void residualRowAVX512(const double* T, const double* Tn, const double* Ts, double* R, size_t I,
+	double lamda, double* rmax, double* sumSq)
+{
+	size_t i = 1;                                // counter
+	double d = 2.0 * (1.0 + lamda);              // stencil divisor
+	double m;                                    // largest lane
+	__m512d vl = _mm512_set1_pd(lamda), vd = _mm512_set1_pd(d);
+	__m512d vmax = _mm512_setzero_pd(), vsum = _mm512_setzero_pd();
+	__m512d r;                                   // residuals of 8 nodes
+
+	for (; i + 8 <= I - 1; i += 8)
+	{
+		r = _mm512_add_pd(_mm512_loadu_pd(T + i + 1), _mm512_loadu_pd(T + i - 1));
+		r = _mm512_add_pd(r, _mm512_mul_pd(vl, _mm512_add_pd(_mm512_loadu_pd(Tn + i), _mm512_loadu_pd(Ts + i))));
+		r = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(T + i), _mm512_div_pd(r, vd)));
+		_mm512_storeu_pd(R + i, r);
+		vmax = _mm512_max_pd(vmax, r);
+		vsum = _mm512_add_pd(vsum, _mm512_mul_pd(r, r));
+	}
+	m = _mm512_reduce_max_pd(vmax);
+	if (m > *rmax) *rmax = m;
+	*sumSq += _mm512_reduce_add_pd(vsum);
+	for (; i < I - 1; i++)
+	{
+		R[i] = fabs(T[i] - (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i])) / d);
+		if (R[i] > *rmax) *rmax = R[i];
+		*sumSq += R[i] * R[i];
+	}
+}
+
+TARGET_AVX512 void relaxRowFloatAVX512(float* E, const float* En, const float* Es, const float* F, size_t I,
+	int parity, float lamda, float omega, double* rmax, double* sumSq)
+{
+	size_t i = 1;                           // first interior node, lane k of a vector holds node i + k
+	float c = 1.0f / (2.0f * (1.0f + lamda)); // stencil weight
+	float r;                                // pre-update residual of a leftover node
+	__m512 vl = _mm512_set1_ps(lamda), vc = _mm512_set1_ps(c), vw = _mm512_set1_ps(omega);
+	__m512 vmax = _mm512_setzero_ps(), vsum = _mm512_setzero_ps();
+	__m512 t, g, east, west;                // old nodes, their pre-update residuals, neighbours
+	__m512 tprev = _mm512_set1_ps(E[0]);    // old nodes of the previous vector (lane 15 is the west neighbour)
+	__mmask16 mask = parity == 1 ? 0x5555 : 0xAAAA; // vectors start at odd i, so the even lanes are odd nodes
+
+	for (; i + 16 <= I - 1; i += 16)
+	{
+		t = _mm512_loadu_ps(E + i);
+		east = _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(_mm512_set1_ps(E[i + 16])), _mm512_castps_si512(t), 1));
+		west = _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(t), _mm512_castps_si512(tprev), 15));
+		g = _mm512_add_ps(east, west);
+		g = _mm512_add_ps(g, _mm512_mul_ps(vl, _mm512_add_ps(_mm512_loadu_ps(En + i), _mm512_loadu_ps(Es + i))));
+		g = _mm512_sub_ps(_mm512_mul_ps(g, vc), t);
+		if (F != NULL) g = _mm512_add_ps(g, _mm512_loadu_ps(F + i));
+		_mm512_mask_storeu_ps(E + i, mask, _mm512_add_ps(t, _mm512_mul_ps(vw, g)));
+		tprev = t;
+		g = _mm512_maskz_mov_ps(mask, _mm512_abs_ps(g)); // the other colour's lanes count as zero
+		vmax = _mm512_max_ps(vmax, g);
+		vsum = _mm512_add_ps(vsum, _mm512_mul_ps(g, g));
+	}
+	if (_mm512_reduce_max_ps(vmax) > *rmax) *rmax = _mm512_reduce_max_ps(vmax);
+	*sumSq += _mm512_reduce_add_ps(vsum);
+	for (; i < I - 1; i++)
+	{
+		if (i % 2 != (size_t)parity) continue;
+		r = (E[i + 1] + E[i - 1] + lamda * (En[i] + Es[i])) * c - E[i];
+		if (F != NULL) r += F[i];
+		E[i] += omega * r;
+		if (fabs(r) > *rmax) *rmax = fabs(r);
+		*sumSq += (double)r * r;
+	}
+}
+#endif
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Builds the multigrid hierarchy.  Each coarser level has about half the cells of the one
+//               above it in both directions (rounded up, so odd cell counts such as A-2's 85 x 115 still
+//               coarsen); the grids need not be nested because the transfers interpolate bilinearly.
+//               Level 0 shares T_fd with the plate grid
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for the selected case
+// RETURN VALUE: the hierarchy, NULL if out of memory
+MULTIGRID* CreateMultigrid(PLATEGRID* G, const SIMULATION_DATA* SD)
+{
+	MULTIGRID* MG;                  // the hierarchy
+	MG_LEVEL* L;                    // level being set up
+	size_t Mx = G->I - 1;           // number of cells in x
+	size_t My = G->J - 1;           // number of cells in y
+	size_t planeSize;               // doubles per plane
+	double w = (double)Mx * G->dx;  // plate width covered by the grid
+	double h = (double)My * G->dy;  // plate height covered by the grid
+	int l;                          // level counter
+
+	MG = (MULTIGRID*)calloc(1, sizeof(MULTIGRID));
+	if (MG == NULL) return NULL;
+	MG->bInsulated = SD->bc[RIGHT].nType == BC_TYPE_INSULATED;
+	for (l = 0; l < MAX_MG_LEVELS; l++)
+	{
+		L = &MG->level[l];
+		L->I = Mx + 1;
+		L->J = My + 1;
+		L->stride = l == 0 ? G->stride : L->I;
+		L->dx = w / (double)Mx;
+		L->dy = h / (double)My;
+		L->lamda = (L->dx / L->dy) * (L->dx / L->dy);
+		planeSize = L->stride * L->J;
+		// level 0 relaxes the plate itself, the others own u as well as f and r
+		L->block = calloc((l == 0 ? 2 : 3) * planeSize, sizeof(double));
+		if (L->block == NULL)
+		{
+			FreeMultigrid(MG); // frees the levels allocated so far
+			return NULL;
+		}
+		L->f = (double*)L->block;
+		L->r = L->f + planeSize;
+		L->u = l == 0 ? G->T_fd : L->r + planeSize;
+		MG->nLevels = l + 1;
+		if (Mx <= MG_MIN_CELLS || My <= MG_MIN_CELLS) break;
+		Mx = (Mx + 1) / 2;
+		My = (My + 1) / 2;
+	}
+	return MG;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees the multigrid hierarchy (level 0's u belongs to the plate grid)
+// ARGUMENTS:    MG: the hierarchy, may be NULL
+// RETURN VALUE: none
+void FreeMultigrid(MULTIGRID* MG)
+{
+	int l;
+	if (MG == NULL) return;
+	for (l = 0; l < MG->nLevels; l++) free(MG->level[l].block);
+	free(MG);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Full-multigrid start.  The wall temperatures are carried down to every level, the 
+//               coarsest level is solved, and each finer level starts from the bilinear interpolation of
+//               the level below and is improved by MG_FMG_CYCLES V-cycles.  Level 0 finishes with an 
+//               initial guess that is already close to discretization accuracy
+// ARGUMENTS:    MG: the hierarchy (level 0 holds the boundary conditions)
+// RETURN VALUE: none
+void SolveFullMultigrid(MULTIGRID* MG)
+{
+	int l, n; // level and cycle counters
+
+	// boundary values of every coarse level, sampled from the level above
+	for (l = 1; l < MG->nLevels; l++)
+	{
+		memset(MG->level[l].u, 0, MG->level[l].stride * MG->level[l].J * sizeof(double));
+		ProlongMultigrid(&MG->level[l - 1], &MG->level[l], MG->bInsulated, true);
+	}
+	// coarsest level solve, then interpolate and cycle on the way up
+	MultigridVCycle(MG, MG->nLevels - 1);
+	for (l = MG->nLevels - 2; l >= 0; l--)
+	{
+		ProlongMultigrid(&MG->level[l + 1], &MG->level[l], MG->bInsulated, false);
+		for (n = 0; n < MG_FMG_CYCLES; n++) MultigridVCycle(MG, l);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One V-cycle: smooth, restrict the residual, solve for the correction on the next level 
+//               down (recursively), interpolate the correction back and smooth again
+// ARGUMENTS:    MG: the hierarchy
+//               l:  the level to cycle on (0 = the plate)
+// RETURN VALUE: none
+void MultigridVCycle(MULTIGRID* MG, int l)
+{
+	MG_LEVEL* L = &MG->level[l]; // this level
+	MG_LEVEL* C;                 // next coarser level
+	int n;                       // sweep counter
+
+	if (l == MG->nLevels - 1) // coarsest level: only a handful of nodes, just relax it to death
+	{
+		for (n = 0; n < MG_COARSE_SWEEPS; n++) SmoothMultigridLevel(L, MG->bInsulated);
+		return;
+	}
+	C = &MG->level[l + 1];
+	for (n = 0; n < MG_PRE_SWEEPS; n++) SmoothMultigridLevel(L, MG->bInsulated);
+	GetMultigridResidual(L, MG->bInsulated);
+	RestrictMultigridResidual(L, C);
+	memset(C->u, 0, C->stride * C->J * sizeof(double)); // correction starts at zero with zero walls
+	MultigridVCycle(MG, l + 1);
+	ProlongMultigrid(C, L, MG->bInsulated, false);
+	for (n = 0; n < MG_POST_SWEEPS; n++) SmoothMultigridLevel(L, MG->bInsulated);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One red-black Gauss-Seidel sweep of a u - laplacian(u) = f on a multigrid level, using the 
+//               same stencil (and insulated wall ghost node) as the plate solver
+// ARGUMENTS:    L:          the level
+//               bInsulated: right wall is insulated
+// RETURN VALUE: none
+void SmoothMultigridLevel(MG_LEVEL* L, bool bInsulated)
+{
+	int I = (int)L->I, J = (int)L->J; // nodes in x and y
+	int i, j, color;                  // counters, 0 = red (i + j even), 1 = black
+	size_t s = L->stride;             // distance between vertically adjacent nodes
+	double lamda = L->lamda;
+	double h2 = L->dx * L->dx;              // scales the right-hand side to the stencil
+	double c = 1.0 / (2.0 * (1.0 + lamda) + h2 * L->shift); // stencil weight
+	double* T, * Tn, * Ts, * F;             // current, north and south rows of u and the row of f
+
+	for (color = 0; color < 2; color++)
+	{
+		for (j = 1; j < J - 1; j++)
+		{
+			T = L->u + j * s;
+			Tn = T + s;
+			Ts = T - s;
+			F = L->f + j * s;
+			for (i = 1 + (1 + j + color) % 2; i < I - 1; i += 2)
+				T[i] = (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i]) + h2 * F[i]) * c;
+			if (bInsulated && (I - 1 + j) % 2 == color)
+				T[I - 1] = (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1]) + h2 * F[I - 1]) * c;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Computes r = f - a u + laplacian(u) at every unknown node of a level, r = 0 on the walls
+// ARGUMENTS:    L:          the level
+//               bInsulated: right wall is insulated
+// RETURN VALUE: none
+void GetMultigridResidual(MG_LEVEL* L, bool bInsulated)
+{
+	int I = (int)L->I, J = (int)L->J; // nodes in x and y
+	int i, j;                         // counters
+	size_t s = L->stride;             // distance between vertically adjacent nodes
+	double lamda = L->lamda;
+	double rh2 = 1.0 / (L->dx * L->dx); // 1/dx^2
+	double d = 2.0 * (1.0 + lamda) + L->dx * L->dx * L->shift; // diagonal of the scaled stencil
+	double* T, * Tn, * Ts, * F, * R;    // rows of u, f and r
+
+	memset(L->r, 0, s * J * sizeof(double));
+	for (j = 1; j < J - 1; j++)
+	{
+		T = L->u + j * s;
+		Tn = T + s;
+		Ts = T - s;
+		F = L->f + j * s;
+		R = L->r + j * s;
+		for (i = 1; i < I - 1; i++)
+			R[i] = F[i] + (T[i + 1] + T[i - 1] + lamda * (Tn[i] + Ts[i]) - d * T[i]) * rh2;
+		if (bInsulated)
+			R[I - 1] = F[I - 1] + (2.0 * T[I - 2] + lamda * (Tn[I - 1] + Ts[I - 1]) - d * T[I - 1]) * rh2;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Restricts the residual of a fine level to the right-hand side of the next coarser level.
+//               Every fine node spreads its residual to the four coarse nodes around it with the bilinear
+//               weights (the transpose of ProlongMultigrid), and each coarse value is divided by the sum of
+//               weights it received, so a constant residual restricts to the same constant
+// ARGUMENTS:    F: the fine level (r filled in)
+//               C: the coarse level (f is written, r is used for the weight sums)
+// RETURN VALUE: none
+void RestrictMultigridResidual(const MG_LEVEL* F, MG_LEVEL* C)
+{
+	size_t i, j, k, m;  // fine and coarse node indices
+	double sx = (double)(C->I - 1) / (double)(F->I - 1); // fine -> coarse index scale in x
+	double sy = (double)(C->J - 1) / (double)(F->J - 1); // fine -> coarse index scale in y
+	double p, q, t, v;  // coarse position, interpolation fractions in x and y
+	double* W = C->r;   // sum of weights per coarse node
+	double rf;          // fine residual
+
+	memset(C->f, 0, C->stride * C->J * sizeof(double));
+	memset(W, 0, C->stride * C->J * sizeof(double));
+	for (j = 0; j < F->J; j++)
+	{
+		q = (double)j * sy;
+		m = (size_t)q;
+		if (m >= C->J - 1) m = C->J - 2;
+		v = q - (double)m;
+		for (i = 0; i < F->I; i++)
+		{
+			p = (double)i * sx;
+			k = (size_t)p;
+			if (k >= C->I - 1) k = C->I - 2;
+			t = p - (double)k;
+			rf = F->r[j * F->stride + i];
+			C->f[m * C->stride + k] += (1.0 - t) * (1.0 - v) * rf;
+			C->f[m * C->stride + k + 1] += t * (1.0 - v) * rf;
+			C->f[(m + 1) * C->stride + k] += (1.0 - t) * v * rf;
+			C->f[(m + 1) * C->stride + k + 1] += t * v * rf;
+			W[m * C->stride + k] += (1.0 - t) * (1.0 - v);
+			W[m * C->stride + k + 1] += t * (1.0 - v);
+			W[(m + 1) * C->stride + k] += (1.0 - t) * v;
+			W[(m + 1) * C->stride + k + 1] += t * v;
+		}
+	}
+	for (k = 0; k < C->stride * C->J; k++)
+		if (W[k] > 0.0) C->f[k] /= W[k];
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Bilinear transfer of u between two levels.  With bBoundary false the coarse u of level A is
+//               added to the unknown nodes of the finer level B: a correction during a V-cycle, or during 
+//               FMG (where B's unknowns are still zero) the initial guess.  With bBoundary true the transfer
+//               runs the other way and the wall values of the coarser level B are sampled from level A
+// ARGUMENTS:    A:          source level
+//               B:          destination level
+//               bInsulated: right wall is insulated (its column is unknown, not a wall)
+//               bBoundary:  sample wall values instead of updating unknowns
+// RETURN VALUE: none
+void ProlongMultigrid(const MG_LEVEL* A, MG_LEVEL* B, bool bInsulated, bool bBoundary)
+{
+	size_t i, j, k, m;  // destination and source node indices
+	size_t iLast = bInsulated ? B->I - 1 : B->I - 2; // last unknown column of B
+	double sx = (double)(A->I - 1) / (double)(B->I - 1); // destination -> source index scale in x
+	double sy = (double)(A->J - 1) / (double)(B->J - 1); // destination -> source index scale in y
+	double p, q, t, v;  // source position, interpolation fractions in x and y
+	double e;           // interpolated value
+	bool bWall;         // destination node is a wall node
+
+	for (j = 0; j < B->J; j++)
+	{
+		q = (double)j * sy;
+		m = (size_t)q;
+		if (m >= A->J - 1) m = A->J - 2;
+		v = q - (double)m;
+		for (i = 0; i < B->I; i++)
+		{
+			bWall = j == 0 || j == B->J - 1 || i == 0 || i > iLast;
+			if (bWall != bBoundary) continue;
+			p = (double)i * sx;
+			k = (size_t)p;
+			if (k >= A->I - 1) k = A->I - 2;
+			t = p - (double)k;
+			e = (1.0 - t) * (1.0 - v) * A->u[m * A->stride + k] + t * (1.0 - v) * A->u[m * A->stride + k + 1]
+				+ (1.0 - t) * v * A->u[(m + 1) * A->stride + k] + t * v * A->u[(m + 1) * A->stride + k + 1];
+			if (bBoundary) B->u[j * B->stride + i] = e;
+			else B->u[j * B->stride + i] += e;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Sets up matrix-free preconditioned conjugate gradient on the plate.  The unknowns are the
+//               interior nodes plus, with an insulated right wall, the wall column; the walls' fixed 
+//               temperatures move to the right-hand side.  The wall column's ghost-node rows are halved so
+//               the operator is symmetric positive definite:
+//                 interior:  2(1+lamda) T - (T_e + T_w) - lamda (T_n + T_s)
+//                 insulated: (1+lamda) T - T_w - lamda/2 (T_n + T_s)
+//               For IC(0) the pivots are d = a_C - a_W^2 / d_W - a_S^2 / d_S (no fill-in on a 5-point grid)
+// ARGUMENTS:    G:     the plate grid (T_fd holds the walls and the starting guess)
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+// RETURN VALUE: the PCG work planes with r, z and p of the first step, NULL if out of memory
+PCG_DATA* CreatePCG(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda)
+{
+	PCG_DATA* CG;                // the work planes
+	size_t planeSize = G->stride * G->J; // doubles per plane
+	size_t i, j, s = G->stride;  // counters, distance between vertically adjacent nodes
+	double aC, aW, aS;           // diagonal and west/south couplings of a node
+
+	CG = (PCG_DATA*)calloc(1, sizeof(PCG_DATA));
+	if (CG == NULL) return NULL;
+	CG->I = G->I;
+	CG->J = G->J;
+	CG->stride = s;
+	CG->iLast = SD->bc[RIGHT].nType == BC_TYPE_INSULATED ? G->I - 1 : G->I - 2;
+	CG->lamda = lamda;
+	CG->nPrecond = SD->solver.nPrecond;
+	CG->block = calloc(5 * planeSize, sizeof(double));
+	if (CG->block == NULL)
+	{
+		free(CG);
+		return NULL;
+	}
+	CG->r = (double*)CG->block;
+	CG->z = CG->r + planeSize;
+	CG->p = CG->z + planeSize;
+	CG->q = CG->p + planeSize;
+	CG->d = CG->q + planeSize;
+
+	// preconditioner diagonal, row by row so the IC pivots to the west and south are ready
+	for (j = 1; j < G->J - 1; j++)
+	{
+		for (i = 1; i <= CG->iLast; i++)
+		{
+			bool bWall = i == G->I - 1;                  // insulated wall row (halved)
+			aC = bWall ? 1.0 + lamda : 2.0 * (1.0 + lamda);
+			CG->d[j * s + i] = aC;
+			if (CG->nPrecond != PRECOND_IC) continue;
+			aW = i > 1 ? 1.0 : 0.0;                      // coupling to the west unknown
+			aS = j > 1 ? (bWall ? 0.5 * lamda : lamda) : 0.0; // coupling to the south unknown
+			if (aW > 0.0) CG->d[j * s + i] -= aW * aW / CG->d[j * s + i - 1];
+			if (aS > 0.0) CG->d[j * s + i] -= aS * aS / CG->d[(j - 1) * s + i];
+		}
+	}
+
+	// r = b - A x, z = M^-1 r, p = z
+	ApplyPCGOperator(CG, G->T_fd, CG->r, true);
+	ApplyPreconditioner(CG);
+	memcpy(CG->p, CG->z, planeSize * sizeof(double));
+	CG->rz = dotPCG(CG, CG->r, CG->z);
+
+	return CG;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees the PCG work planes
+// ARGUMENTS:    CG: the work planes, may be NULL
+// RETURN VALUE: none
+void FreePCG(PCG_DATA* CG)
+{
+	if (CG == NULL) return;
+	free(CG->block);
+	free(CG);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One preconditioned conjugate gradient iteration, updating T_fd in place
+// ARGUMENTS:    CG: the work planes from CreatePCG
+//               G:  the plate grid
+// RETURN VALUE: none
+void StepPCG(PCG_DATA* CG, PLATEGRID* G)
+{
+	size_t i, j, k;        // counters, flat node index
+	double alpha, beta;    // step length, direction update factor
+	double pq, rz;         // p . A p, new r . z
+
+	if (CG->rz == 0.0) return; // already exact
+	ApplyPCGOperator(CG, CG->p, CG->q, false);
+	pq = dotPCG(CG, CG->p, CG->q);
+	alpha = CG->rz / pq;
+	for (j = 1; j < CG->J - 1; j++)
+	{
+		for (i = 1; i <= CG->iLast; i++)
+		{
+			k = j * CG->stride + i;
+			G->T_fd[k] += alpha * CG->p[k];
+			CG->r[k] -= alpha * CG->q[k];
+		}
+	}
+	ApplyPreconditioner(CG);
+	rz = dotPCG(CG, CG->r, CG->z);
+	beta = rz / CG->rz;
+	CG->rz = rz;
+	for (j = 1; j < CG->J - 1; j++)
+	{
+		for (i = 1; i <= CG->iLast; i++)
+		{
+			k = j * CG->stride + i;
+			CG->p[k] = CG->z[k] + beta * CG->p[k];
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Applies the symmetric plate operator without assembling it.  With bResidual false it 
+//               returns y = A x for a field whose wall entries are zero; with bResidual true x is the
+//               temperature field (walls included) and y = b - A x, the walls acting as the right-hand side
+// ARGUMENTS:    CG:        the work planes (dimensions, lamda)
+//               x:         the input plane
+//               y:         the output plane (only unknowns are written)
+//               bResidual: compute b - A x instead of A x
+// RETURN VALUE: none
+void ApplyPCGOperator(const PCG_DATA* CG, const double* x, double* y, bool bResidual)
+{
+	size_t i, j, k, s = CG->stride; // counters, flat node index, row distance
+	size_t I = CG->I;               // nodes in x
+	double lamda = CG->lamda;
+	double Ax;                      // operator applied at one node
+	double sign = bResidual ? -1.0 : 1.0;
+
+	for (j = 1; j < CG->J - 1; j++)
+	{
+		for (i = 1; i < I - 1; i++)
+		{
+			k = j * s + i;
+			Ax = 2.0 * (1.0 + lamda) * x[k] - (x[k + 1] + x[k - 1]) - lamda * (x[k + s] + x[k - s]);
+			y[k] = sign * Ax;
+		}
+		if (CG->iLast == I - 1) // halved ghost-node row of the insulated wall
+		{
+			k = j * s + I - 1;
+			Ax = (1.0 + lamda) * x[k] - x[k - 1] - 0.5 * lamda * (x[k + s] + x[k - s]);
+			y[k] = sign * Ax;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  z = M^-1 r.  Jacobi divides by the diagonal.  Symmetric Gauss-Seidel and IC(0) share 
+//               M = (D + L) D^-1 (D + U), with D the operator diagonal or the IC pivots: a forward sweep 
+//               solves (D + L) y = r, a backward sweep solves (D + U) z = D y.  Wall entries of z stay zero
+//               so the sweeps can read every neighbour without checking for walls
+// ARGUMENTS:    CG: the work planes (r in, z out)
+// RETURN VALUE: none
+void ApplyPreconditioner(PCG_DATA* CG)
+{
+	size_t i, j, k, s = CG->stride;   // counters, flat node index, row distance
+	size_t I = CG->I;                 // nodes in x
+	double lamda = CG->lamda;
+	double* z = CG->z, * r = CG->r, * d = CG->d;
+	double aEW, aNS;                  // couplings of a node to its east/west and north/south neighbours
+
+	if (CG->nPrecond == PRECOND_JACOBI)
+	{
+		for (j = 1; j < CG->J - 1; j++)
+			for (i = 1; i <= CG->iLast; i++)
+				z[j * s + i] = r[j * s + i] / d[j * s + i];
+		return;
+	}
+	// forward sweep
+	for (j = 1; j < CG->J - 1; j++)
+	{
+		for (i = 1; i <= CG->iLast; i++)
+		{
+			k = j * s + i;
+			aNS = i == I - 1 ? 0.5 * lamda : lamda;
+			z[k] = (r[k] + z[k - 1] + aNS * z[k - s]) / d[k];
+		}
+	}
+	// backward sweep
+	for (j = CG->J - 2; j >= 1; j--)
+	{
+		for (i = CG->iLast; i >= 1; i--)
+		{
+			k = j * s + i;
+			aNS = i == I - 1 ? 0.5 * lamda : lamda;
+			aEW = i < CG->iLast ? 1.0 : 0.0;
+			z[k] += (aEW * z[k + 1] + aNS * z[k + s]) / d[k];
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Dot product of two planes over the unknown nodes
+// ARGUMENTS:    CG:   the work planes (dimensions)
+//               a, b: the planes
+// RETURN VALUE: a . b
+double dotPCG(const PCG_DATA* CG, const double* a, const double* b)
+{
+	size_t i, j, k;   // counters, flat node index
+	double sum = 0.0; // the dot product
+
+	for (j = 1; j < CG->J - 1; j++)
+	{
+		for (i = 1; i <= CG->iLast; i++)
+		{
+			k = j * CG->stride + i;
+			sum += a[k] * b[k];
+		}
+	}
+	return sum;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Sets up line relaxation (SOLVER LINE) or Peaceman-Rachford ADI (SOLVER ADI).  A line solve
+//               takes one whole row or column implicitly, so the strong coupling of a stretched mesh (1 
+//               along x, lamda along y) is handled exactly instead of creeping one node per sweep.  LINES 
+//               AUTO picks x-lines when lamda < 1, y-lines when lamda > 1 and alternates on a square mesh.
+//               ADI splits the operator into its x part H and y part V and cycles through nShifts shifts
+//               spread geometrically between the smallest and largest eigenvalues of H and V, so every
+//               error mode is damped strongly by some shift of the cycle
+// ARGUMENTS:    G:     the plate grid (T_fd holds the walls and the starting guess)
+//               SD:    the simulation data for the selected case
+//               lamda: (dx/dy)^2
+//               iter:  iterations already done (a resumed ADI solve continues its shift cycle)
+// RETURN VALUE: the work space, NULL if out of memory
+LINE_DATA* CreateLineSolver(PLATEGRID* G, const SIMULATION_DATA* SD, double lamda, int iter)
+{
+	LINE_DATA* L;                // the work space
+	size_t planeSize = G->stride * G->J; // doubles per plane
+	size_t nLine = G->I > G->J ? G->I : G->J; // longest line
+	double hMin, hMax, vMin, vMax; // eigenvalue ranges of H and V
+	double a, b;                 // range of the shifts
+	int k;                       // shift counter
 
-		// bottom right node
-		P[I - 1][0].T_a = (P[I - 2][0].T_a + P[I - 1][1].T_a) / 2.0;
-		P[I - 1][0].T_fd = P[I - 1][0].T_a;
+	L = (LINE_DATA*)calloc(1, sizeof(LINE_DATA));
+	if (L == NULL) return NULL;
+	L->I = G->I;
+	L->J = G->J;
+	L->stride = G->stride;
+	L->iLast = SD->bc[RIGHT].nType == BC_TYPE_INSULATED ? G->I - 1 : G->I - 2;
+	L->bInsulated = SD->bc[RIGHT].nType == BC_TYPE_INSULATED;
+	L->lamda = lamda;
+	L->bADI = SD->solver.nSolver == SOLVER_ADI;
+	L->nLines = SD->solver.nLines;
+	if (L->nLines == LINES_AUTO) L->nLines = lamda < 1.0 ? LINES_X : lamda > 1.0 ? LINES_Y : LINES_ALTERNATE;
+	L->nStep = iter;
+	L->block = calloc((L->bADI ? planeSize : 0) + 2 * nLine, sizeof(double));
+	if (L->block == NULL)
+	{
+		free(L);
+		return NULL;
 	}
+	L->x = (double*)L->block;
+	L->c = L->x + nLine;
+	if (!L->bADI) return L;
 
-	return P;
+	L->Tstar = L->c + nLine;
+	memcpy(L->Tstar, G->T_fd, planeSize * sizeof(double)); // the walls stay, the interior is rewritten each step
+	// H = -d2/dx2 on n unknowns (quarter-wave modes with an insulated wall), V = -lamda d2/dy2 on J - 2
+	hMin = L->bInsulated ? 2.0 - 2.0 * cos(PI / (2.0 * (G->I - 1))) : 2.0 - 2.0 * cos(PI / (G->I - 1.0));
+	hMax = 4.0;
+	vMin = lamda * (2.0 - 2.0 * cos(PI / (G->J - 1.0)));
+	vMax = 4.0 * lamda;
+	a = hMin < vMin ? hMin : vMin;
+	b = hMax > vMax ? hMax : vMax;
+	L->nShifts = (int)ceil(log(b / a) / log(ADI_SHIFT_RATIO));
+	if (L->nShifts < 1) L->nShifts = 1;
+	if (L->nShifts > MAX_ADI_SHIFTS) L->nShifts = MAX_ADI_SHIFTS;
+	for (k = 0; k < L->nShifts; k++) L->shift[k] = a * pow(b / a, (k + 0.5) / L->nShifts);
+	return L;
 }
 
 //-----------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  Uses Finite-difference method to numerically solve for the temperature of each node 
-//               Cycles through each node and finds the temperature based on the average of neighbouring nodes
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
-//               SD: the simulation data for the selected case
+// DESCRIPTION:  Frees the line solver work space
+// ARGUMENTS:    L: the work space, may be NULL
 // RETURN VALUE: none
-void GetNumericalSolution(PLATEPOINT** P, const SIMULATION_DATA SD)
+void FreeLineSolver(LINE_DATA* L)
 {
-	FILE* fConverge = NULL;
-	errno_t err;
-	double rmax = 0; // defines and initializes rmax to zero
-	int I = nint((SD.w / SD.dx) + 1.0); // calculates values for I
-	int J = nint((SD.h / SD.dy) + 1.0); // calculates values for J
-	int i = 0, j = 0; // counters 
-	char strConvergenceFile[MAX_BUFF_SIZE]; // convergence file string name
-	double RMS = 0.0; // variable holder for RMS value
-	double dy = SD.dy; // defines dy from structure 
-	double dx = SD.dx; // defines dx from structure 
-	double lamda = pow(SD.dx / SD.dy, 2.0); // calculates lamda 
-	int iter = 0; // iteration counter
+	if (L == NULL) return;
+	free(L->block);
+	free(L);
+}
 
-	sprintf_s(strConvergenceFile, MAX_BUFF_SIZE, "%s convergence.dat", SD.strCase);
-	err = fopen_s(&fConverge, strConvergenceFile, "w");
-	if (err != 0 || fConverge == NULL)
-	{
-		printf("Cannot open \"%s\" for writing...", strConvergenceFile);
-		waitForEnterKey();
-		EXIT_FAILURE;
-	}
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One line Gauss-Seidel iteration, updating T_fd in place.  Each x-line solves
+//                 2(1+lamda) T_i - T_(i-1) - T_(i+1) = lamda (T_n + T_s)
+//               along a row with the rows below already updated; each y-line solves
+//                 2(1+lamda) T_j - lamda (T_(j-1) + T_(j+1)) = T_e + T_w
+//               down a column with the columns to the left already updated.  On an insulated right wall
+//               the ghost node doubles the west neighbour.  LINES_ALTERNATE does both in one iteration
+// ARGUMENTS:    L: the work space
+//               G: the plate grid
+// RETURN VALUE: none
+void SweepLines(LINE_DATA* L, PLATEGRID* G)
+{
+	size_t i, j, s = L->stride;   // counters, distance between vertically adjacent nodes
+	size_t n = L->iLast;          // unknowns per row
+	size_t m = L->J - 2;          // unknowns per column
+	double d = 2.0 * (1.0 + L->lamda); // diagonal
+	double* T;                    // current row
 
-	do
+	if (L->nLines != LINES_Y) // rows, bottom to top
 	{
-		for (j = 1; j < J - 1; j++) // sweeping through the nodes vertically 
+		for (j = 1; j <= m; j++)
 		{
-			for (i = 1; i < I - 1; i++) // sweeping through the nodes horizontally 
-			{
-				// calculates value for temperature finite difference by using the formula found in 
-				//finite difference laplace.pdf
-				P[i][j].T_fd = (P[i + 1][j].T_fd + P[i - 1][j].T_fd + lamda * (P[i][j + 1].T_fd + 
-					P[i][j - 1].T_fd)) / (2.0 * (1.0 + lamda));
-			}
-			if (SD.bc[RIGHT].nType == BC_TYPE_INSULATED) // special formula used for insulated right wall
-			{
-				P[I - 1][j].T_fd = (2.0 * P[I - 2][j].T_fd + lamda * (P[I - 1][j + 1].T_fd + 
-					P[I - 1][j - 1].T_fd)) / (2.0 * (1.0 + lamda));
-			}
+			T = G->T_fd + j * s;
+			for (i = 1; i <= n; i++) L->x[i - 1] = L->lamda * (T[i - s] + T[i + s]);
+			L->x[0] += T[0];
+			if (!L->bInsulated) L->x[n - 1] += T[n + 1];
+			solveTridiagonal(L->x, L->c, n, -1.0, d, L->bInsulated ? -2.0 : -1.0);
+			memcpy(T + 1, L->x, n * sizeof(double));
 		}
-		RMS = 0.0; // resets RMS to zero
-		rmax = 0.0; // resets rmax to zero
-		for (j = 1; j < J - 1; j++) // sweeping through the nodes vertically 
+	}
+	if (L->nLines != LINES_X) // columns, left to right
+	{
+		for (i = 1; i <= n; i++)
 		{
-			for (i = 1; i < I - 1; i++) // sweeping through the nodes horizontally 
-			{
-				// calculates value for residual by using the formula found in finite difference laplace.pdf
-				P[i][j].res = fabs(P[i][j].T_fd - (P[i + 1][j].T_fd + P[i - 1][j].T_fd + lamda * 
-					(P[i][j + 1].T_fd + P[i][j - 1].T_fd)) / (2.0 * (1.0 + lamda)));
-				// if the resiudal is greater than the current rmax, replace the rmax with residual
-				if (P[i][j].res > rmax) rmax = P[i][j].res;
-				// add the calculated value onto the previous value 
-				RMS += pow(P[i][j].res, 2.0); 
-			}
-			if (SD.bc[RIGHT].nType == BC_TYPE_INSULATED) // for insulated right wall 
-			{
-				P[I - 1][j].res = fabs(P[i][j].T_fd - (2.0 * P[I - 2][j].T_fd + lamda * 
-					(P[I - 1][j + 1].T_fd + P[I - 1][j - 1].T_fd)) / (2.0 * (1.0 + lamda)));
-				if (P[i][j].res > rmax) rmax = P[i][j].res;
-				RMS += pow(P[i][j].res, 2.0);
-			}
+			T = G->T_fd + i;
+			for (j = 1; j <= m; j++)
+				L->x[j - 1] = T[j * s - 1] + (L->bInsulated && i == n ? T[j * s - 1] : T[j * s + 1]);
+			L->x[0] += L->lamda * T[0];
+			L->x[m - 1] += L->lamda * T[(m + 1) * s];
+			solveTridiagonal(L->x, L->c, m, -L->lamda, d, -L->lamda);
+			for (j = 1; j <= m; j++) T[j * s] = L->x[j - 1];
 		}
-		RMS = sqrt(RMS / (((double)I - 2) * ((double)J - 2))); // calculates RMS
-		iter++; // iter increments 
-	    // do the loop while iter is less than or equal to MAX_ITER AND rmax is 
-		//greater or eqal to MAX_RESIDUAL AND RMS greater or equal to MAX_RESIDUAL  
-		if (fConverge == 0) exit(0);
-		fprintf(fConverge, "%12.5le, %12.5le, %d\n", rmax, RMS, iter);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  One Peaceman-Rachford ADI iteration with the next shift r of the cycle:
+//                 (r + H) T* = (r - V) T + b    row by row, into Tstar
+//                 (r + V) T  = (r - H) T* + b   all columns at once, into T_fd
+//               where H T = 2 T_i - T_(i-1) - T_(i+1), V T = lamda (2 T_j - T_(j-1) - T_(j+1)) and b holds the
+//               fixed walls.  The y half runs the Thomas algorithm on whole rows: its coefficients are the
+//               same for every column, so the sweeps are contiguous
+// ARGUMENTS:    L: the work space
+//               G: the plate grid
+// RETURN VALUE: none
+void StepADI(LINE_DATA* L, PLATEGRID* G)
+{
+	size_t i, j, s = L->stride;   // counters, distance between vertically adjacent nodes
+	size_t n = L->iLast;          // unknowns per row
+	size_t m = L->J - 2;          // unknowns per column
+	double r = L->shift[L->nStep++ % L->nShifts]; // shift of this iteration
+	double lamda = L->lamda;
+	double denom;                 // Thomas pivot
+	double* T, * Ts;              // current row of T_fd and Tstar
 
-	} while (iter <= MAX_ITER && (rmax >= MAX_RESIDUAL && RMS >= MAX_RESIDUAL));
+	for (j = 1; j <= m; j++) // x half: one tridiagonal solve per row
+	{
+		T = G->T_fd + j * s;
+		Ts = L->Tstar + j * s;
+		for (i = 1; i <= n; i++) L->x[i - 1] = (r - 2.0 * lamda) * T[i] + lamda * (T[i - s] + T[i + s]);
+		L->x[0] += T[0];
+		if (!L->bInsulated) L->x[n - 1] += T[n + 1];
+		solveTridiagonal(L->x, L->c, n, -1.0, r + 2.0, L->bInsulated ? -2.0 : -1.0);
+		memcpy(Ts + 1, L->x, n * sizeof(double));
+	}
+	for (j = 1; j <= m; j++) // y half: right-hand side and forward sweep, row by row
+	{
+		T = G->T_fd + j * s;
+		Ts = L->Tstar + j * s;
+		denom = j == 1 ? r + 2.0 * lamda : r + 2.0 * lamda + lamda * L->c[j - 2];
+		L->c[j - 1] = -lamda / denom;
+		// T[i - s] is the bottom wall on the first row and the swept row below after it
+		for (i = 1; i < n; i++) T[i] = ((r - 2.0) * Ts[i] + Ts[i - 1] + Ts[i + 1] + lamda * T[i - s]) / denom;
+		T[n] = ((r - 2.0) * Ts[n] + Ts[n - 1] + (L->bInsulated ? Ts[n - 1] : Ts[n + 1]) + lamda * T[n - s]) / denom;
+		if (j == m) for (i = 1; i <= n; i++) T[i] += lamda * T[i + s] / denom; // top wall
+	}
+	for (j = m - 1; j >= 1; j--) // back substitution
+	{
+		T = G->T_fd + j * s;
+		for (i = 1; i <= n; i++) T[i] -= L->c[j - 1] * T[i + s];
+	}
+}
 
-	// prints to screen - the values of iter, rmax and RMS
-	printf("\nNumber of iterations: %d", iter);
-	printf("\nRmax = %.5le", rmax);
-	printf("\nRMS = %.5le\n\n", RMS);
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Thomas algorithm for a x_(k-1) + d x_k + a x_(k+1) = rhs_k, k = 0..n-1, except that the last
+//               row's sub-diagonal is aLast (the ghost node of an insulated wall)
+// ARGUMENTS:    x:     the right-hand side, replaced by the solution
+//               c:     n doubles of scratch
+//               n:     unknowns
+//               a, d:  off-diagonal and diagonal
+//               aLast: sub-diagonal of the last row
+// RETURN VALUE: none
+void solveTridiagonal(double* x, double* c, size_t n, double a, double d, double aLast)
+{
+	double sub, denom; // sub-diagonal and pivot of a row
+	size_t k;          // counter
 
-	fclose(fConverge);
-	printf("\nPrinted data to file \"%s\n", strConvergenceFile);
+	c[0] = a / d;
+	x[0] /= d;
+	for (k = 1; k < n; k++)
+	{
+		sub = k == n - 1 ? aLast : a;
+		denom = d - sub * c[k - 1];
+		c[k] = a / denom;
+		x[k] = (x[k] - sub * x[k - 1]) / denom;
+	}
+	for (k = n - 1; k-- > 0; ) x[k] -= c[k] * x[k + 1];
 }
 
 //-----------------------------------------------------------------------------------------------------------
 // DESCRIPTION:  Computes the analytical solution for case A and store the temperature values into the 
-//               PLATEPOINT array.
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
-//               SD: the simulation data for case B
+//               plate grid.  Only the odd terms of the series are non-zero:
+//               T = T0 + 2 / PI * (T1 - T0) * sum (1 - cos(n PI)) / n * sin(n PI x / w) sinh(n PI y / w) / sinh(n PI h / w)
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for case A
 // RETURN VALUE: none
-void GetCaseAAnalyticalSolution(PLATEPOINT** P, const SIMULATION_DATA* SD)
+void GetCaseAAnalyticalSolution(PLATEGRID* G, const SIMULATION_DATA* SD)
 {
-	size_t i, j, n;                                       // loop counters
-	size_t I = SD->I, J = SD->J;                       // 2D array dimensions for the simulation case
-	double T, T1 = SD->bc[TOP].Ta;                     // temperature, peak temperature
-	double h = SD->h, w = SD->w, k = SD->bc[TOP].k;    // plate height/width, k factor in sine function
-	double x, y;                                       // plate coordinates for 2D array element
+	double T1 = SD->bc[TOP].Ta;  // peak temperature
+	double w = SD->w;            // plate width
+	double c[CASE_A_TERMS];      // coefficients of the odd terms
+	double a[CASE_A_TERMS];      // n PI / w of the odd terms
+	int m, n;                    // term, n of the term
 
-	for (i = 1; i < I - 1; i++) // boundaries already done!
+	//Iterate the infinite sum for the odd n below 100
+	for (m = 0; m < CASE_A_TERMS; m++)
 	{
-		for (j = 1; j < J - 1; j++)
-		{
-			// auxilary variables so Temperature calculation formula can be written on one line
-			x = P[i][j].x;
-			y = P[i][j].y;
-			//reset Tsum to 0
-			double Tsum = 0;
-			//Iterate the infinite sum for 100 times
-			for (n = 1; n < 100; n++)
-			{
-				double A;//used as auxiliary variables 
-				double B;
-				double C;
-				double D;
-				//Infinite sum formula is broken into smaller variables to add loop break condition for sinh
-				A = (1 - cos(n * PI)) / n;
-				B = sin(n * PI * x / w);
-				C = sinh(n * PI * y / w);
-				D = sinh(n * PI * h / w);
-				//if sinh gets bigger than DBL_MAX, then break loop
-				if (D > DBL_MAX) break;
-				//infinite sum formula combined
-				T = A * B * C / D;
-				//sum the temperature value
-				Tsum += T;
-			}
-			//Temperature formula for case 2: constant temperature on the upper body
-			//After iterating the infinite sum, calculate the temperature
-			T = T0 + 2 / PI * (T1 - T0) * Tsum;
-			//Store temperature value to PLATEPOINT array
-			P[i][j].T_a = T;
-		}
+		n = 2 * m + 1;
+		c[m] = 2 / PI * (T1 - T0) * 2.0 / n; // (1 - cos(n PI)) / n is 2 / n for odd n
+		a[m] = n * PI / w;
 	}
+	EvaluateSeriesSolution(G, SD, a, c, CASE_A_TERMS, SD->I - 2);
 }
 
 //-----------------------------------------------------------------------------------------------------------
 // DESCRIPTION:  Computes the analytical solution for case B and store the temperature values into the 
-//               PLATEPOINT array.
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
+//               plate grid.
+// ARGUMENTS:    G:  the plate grid
 //               SD: the simulation data for case B
 // RETURN VALUE: none
-void GetCaseBAnalyticalSolution(PLATEPOINT** P, const SIMULATION_DATA* SD)
+void GetCaseBAnalyticalSolution(PLATEGRID* G, const SIMULATION_DATA* SD)
+{
+	double T1 = SD->bc[TOP].Ta;                       // peak temperature
+	double w = SD->w, k = SD->bc[TOP].k;              // plate width, k factor in sine function
+	double a = k * PI / w;                            // wave number of the one term
+
+	//Temperature for case 1: sinusoidal distribution on the upper boundary
+	//T = T0 + T1 * sin(k * PI * x / w) * sinh(k * PI * y / w) / sinh(k * PI * h / w)
+	EvaluateSeriesSolution(G, SD, &a, &T1, 1, SD->I - 2);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Computes the analytical solution for case C and store the temperature values into the 
+//               plate grid.
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for case C
+// RETURN VALUE: none
+void GetCaseCAnalyticalSolution(PLATEGRID* G, const SIMULATION_DATA* SD)
+{
+	double T1 = SD->bc[TOP].Ta;                       // peak temperature
+	double w = SD->w, k = SD->bc[TOP].k;              // plate width, k factor in sine function
+	double a = (k - 1 / 2) * PI / w;                  // wave number of the one term
+
+	//Temperature formula for case 3, the insulated right wall column is included
+	//T = T0 + T1 * ((sin((k - 1 / 2) * PI * x / w) * sinh((k - 1 / 2) * PI * y / w)) / sinh((k - 1 / 2) * PI * h / w))
+	EvaluateSeriesSolution(G, SD, &a, &T1, 1, SD->I - 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Fills the interior of T_a with a separable series
+//                   T = T0 + sum c[m] sin(a[m] x) sinh(a[m] y) / sinh(a[m] h)
+//               The sines depend only on the column and the sinh ratios only on the row, so both are
+//               tabulated once and every row is a short sum of scaled sine rows: a (J x N) by (N x I) 
+//               matrix product instead of N transcendental calls per node.  Each row keeps only the terms 
+//               it needs: with |c| not increasing and a evenly spaced, the terms from m on add at most 
+//               |c[m]| e^(-a[m] (h - y)) / (1 - e^(-(a[1] - a[0]) (h - y))), and the sum stops once that is
+//               below ANALYTIC_TOLERANCE (the setting, default 1e-13) of |c[0]|.  Rows are split over THREADS
+//               threads
+// ARGUMENTS:    G:     the plate grid
+//               SD:    the simulation data of the case
+//               a:     wave numbers of the terms, increasing
+//               c:     coefficients of the terms
+//               nTerms: number of terms
+//               nCols: interior columns to fill from column 1 (I - 2, or I - 1 with the insulated wall)
+// RETURN VALUE: none (T_a keeps its zero interior if out of memory)
+void EvaluateSeriesSolution(PLATEGRID* G, const SIMULATION_DATA* SD, const double* a, const double* c, int nTerms, size_t nCols)
 {
-	size_t i, j;                                       // loop counters
-	size_t I = SD->I, J = SD->J;                     // 2D array dimensions for the simulation case
-	double T, T1 = SD->bc[TOP].Ta;                    // temperature, peak temperature
-	double h = SD->h, w = SD->w, k = SD->bc[TOP].k; // plate height/width, k factor in sine function
-	double x, y;                                       // plate coordinates for 2D array element
+	SERIES_JOB job = {};  // arguments of the row bands
+	THREAD_POOL* pool = NULL;
+	size_t i;             // column counter
+	int m;                // term counter
 
-	for (i = 1; i < I - 1; i++) // boundaries already done!
+	job.G = G;
+	job.a = a;
+	job.c = c;
+	job.nTerms = nTerms;
+	job.nCols = nCols;
+	job.h = SD->h;
+	job.tolerance = SD->solver.analyticTolerance > 0.0 ? SD->solver.analyticTolerance : ANALYTIC_TOLERANCE;
+	job.sines = (double*)malloc((size_t)nTerms * nCols * sizeof(double));
+	if (job.sines == NULL) return;
+	for (m = 0; m < nTerms; m++) // sin(a x) of every interior column, one row per term
 	{
-		for (j = 1; j < J - 1; j++)
-		{
-			// auxilary variables so Temperature calculation formula can be written on one line
-			x = P[i][j].x;
-			y = P[i][j].y;
-			//Temperature for case 1: sinusoidal distribution on the upper boundary
-			T = T0 + T1 * sin(k * PI * x / w) * sinh(k * PI * y / w) / sinh(k * PI * h / w); // sine formula
-			P[i][j].T_a = T;
-		}
+		for (i = 0; i < nCols; i++) job.sines[m * nCols + i] = sin(a[m] * gridX(G, i + 1));
+	}
+	if (SD->solver.nThreads > 1) pool = CreateThreadPool(SD->solver.nThreads);
+	if (pool != NULL)
+	{
+		RunThreadPool(pool, seriesRowsJob, &job);
+		FreeThreadPool(pool);
 	}
+	else seriesRowsJob(&job, 0, 1);
+	free(job.sines);
 }
 
 //-----------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  Computes the analytical solution for case C and store the temperature values into the 
-//               PLATEPOINT array.
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
-//               SD: the simulation data for case B
+// DESCRIPTION:  Pool job: the series of EvaluateSeriesSolution on this thread's band of rows
+// ARGUMENTS:    pArgs:             the SERIES_JOB
+//               iThread, nThreads: this thread and the number of threads
 // RETURN VALUE: none
-void GetCaseCAnalyticalSolution(PLATEPOINT** P, const SIMULATION_DATA* SD)
+void seriesRowsJob(void* pArgs, int iThread, int nThreads)
 {
-	size_t i, j;                                       // loop counters
-	size_t I = SD->I, J = SD->J;                     // 2D array dimensions for the simulation case
-	double T, T1 = SD->bc[TOP].Ta;                    // temperature, peak temperature
-	double h = SD->h, w = SD->w, k = SD->bc[TOP].k; // plate height/width, k factor in sine function
-	double x, y;                                       // plate coordinates for 2D array element
+	SERIES_JOB* job = (SERIES_JOB*)pArgs;
+	double da = job->nTerms > 1 ? job->a[1] - job->a[0] : 0.0; // spacing of the wave numbers
+	double d, r, y;       // distance to the top wall, sinh ratio, row position
+	double* T;            // first interior node of the row
+	const double* S;      // sine row of a term
+	size_t i, j, j0, j1;  // counters, this thread's rows
+	int m, nUsed;         // term counter, terms the row needs
 
-	for (i = 1; i < I; i++) // boundaries already done!
+	getRowRange(iThread, nThreads, job->G->J, &j0, &j1);
+	for (j = j0; j < j1; j++)
 	{
-		for (j = 1; j < J - 1; j++)
+		y = gridY(job->G, j);
+		d = job->h - y;
+		nUsed = job->nTerms;
+		for (m = 1; m < job->nTerms; m++)
+		{
+			if (fabs(job->c[m]) * exp(-job->a[m] * d) < job->tolerance * fabs(job->c[0]) * -expm1(-da * d))
+			{
+				nUsed = m;
+				break;
+			}
+		}
+		T = job->G->T_a + gridIndex(job->G, 1, j);
+		for (i = 0; i < job->nCols; i++) T[i] = T0;
+		for (m = 0; m < nUsed; m++)
 		{
-			// auxilary variables so Temperature calculation formula can be written on one line
-			x = P[i][j].x;
-			y = P[i][j].y;
-			//Temperature formula for case 3
-			T = T0 + T1 * ((sin((k - 1 / 2) * PI * x / w) * sinh((k - 1 / 2) 
-				* PI * y / w)) / sinh((k - 1 / 2) * PI * h / w));
-			P[i][j].T_a = T;
+			r = job->c[m] * sinhRatio(job->a[m], y, job->h);
+			S = job->sines + m * job->nCols;
+			for (i = 0; i < job->nCols; i++) T[i] += r * S[i]; // contiguous, the compiler vectorizes it
 		}
 	}
 }
 
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  sinh(a y) / sinh(a h) for 0 <= y <= h, written as e^(-a (h - y)) (1 - e^(-2 a y)) / 
+//               (1 - e^(-2 a h)) so the high modes neither overflow nor lose the ratio to inf / inf
+// ARGUMENTS:    a: wave number (> 0)
+//               y: position
+//               h: plate height
+// RETURN VALUE: the ratio
+double sinhRatio(double a, double y, double h)
+{
+	return exp(-a * (h - y)) * (expm1(-2.0 * a * y) / expm1(-2.0 * a * h));
+}
+
 //-----------------------------------------------------------------------------------------------------------
 // DESCRIPTION:  Prints the solution to Matlab in order to display and graph the temperature distribution 
-//               onto the steel plate
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
+//               onto the steel plate, as text .dat files, the binary solution file or both (OUTPUT setting)
+// ARGUMENTS:    G:  the plate grid
 //               SD: the simulation data for case B
-// RETURN VALUE: none
-void printSolution(PLATEPOINT** P, const SIMULATION_DATA* pSD)
+// RETURN VALUE: false if an output file cannot be written
+bool printSolution(const PLATEGRID* G, const SIMULATION_DATA* pSD)
+{
+	bool bOk = true; // every file was written
+
+	if (pSD->solver.nOutput != OUTPUT_BINARY) bOk = printTextSolution(G, pSD) && bOk;
+	if (pSD->solver.nOutput != OUTPUT_TEXT) bOk = printBinarySolution(G, pSD) && bOk;
+	return bOk;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Prints the analytical, finite-difference and residual fields as "x, y, value" text lines
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for case B
+// RETURN VALUE: false if an output file cannot be opened
+bool printTextSolution(const PLATEGRID* G, const SIMULATION_DATA* pSD)
 {
 
-	size_t i, j;                                 // loop/temp variables
+	size_t i, j, k;                              // loop/temp variables, flat node index
+	double x, y;                                 // node position on the plate
 	FILE* fa = NULL, * ffd = NULL, * fres = NULL;  // for printing solutions to file for matlab
 	char strFileNameAnalytical[MAX_BUFF_SIZE];   // buffer to hold analytical output file name
 	char strFileNameFD[MAX_BUFF_SIZE];           // buffer to hold F-D output file name
@@ -1238,8 +7674,8 @@ void printSolution(PLATEPOINT** P, const SIMULATION_DATA* pSD)
 		err = fopen_s(&fa, strFileNameAnalytical, "w");
 		if (err != 0 || fa == NULL)
 		{
-			printf("Cannot open \"%s\" for writing. Skipping printout...\n", strFileNameAnalytical);
-			return;
+			reportf("Cannot open \"%s\" for writing. Skipping printout...\n", strFileNameAnalytical);
+			return false;
 		}
 	}
 
@@ -1248,8 +7684,9 @@ void printSolution(PLATEPOINT** P, const SIMULATION_DATA* pSD)
 	err = fopen_s(&ffd, strFileNameFD, "w");
 	if (err != 0 || ffd == NULL)
 	{
-		printf("Cannot open \"%s\" for writing. Skipping printout...\n", strFileNameFD);
-		return;
+		reportf("Cannot open \"%s\" for writing. Skipping printout...\n", strFileNameFD);
+		if (fa != NULL) fclose(fa);
+		return false;
 	}
 
 	// open residual output file.  create name dynamically with sprintf_s
@@ -1257,8 +7694,10 @@ void printSolution(PLATEPOINT** P, const SIMULATION_DATA* pSD)
 	err = fopen_s(&fres, strFileNameResidual, "w");
 	if (err != 0 || fres == NULL)
 	{
-		printf("Cannot open \"%s\" for writing. Skipping printout...\n", strFileNameResidual);
-		return;
+		reportf("Cannot open \"%s\" for writing. Skipping printout...\n", strFileNameResidual);
+		if (fa != NULL) fclose(fa);
+		fclose(ffd);
+		return false;
 	}
 
 	//--------------  print outputs to dat files for matlab -------------------------
@@ -1266,12 +7705,15 @@ void printSolution(PLATEPOINT** P, const SIMULATION_DATA* pSD)
 	{
 		for (j = 0; j < pSD->J; j++)
 		{
-			fprintf(fres, "%+12.5le,%+12.5le,%+12.5le\n", P[i][j].x, P[i][j].y, P[i][j].res);
-			fprintf(ffd, "%+12.5le,%+12.5le,%+12.5le\n", P[i][j].x, P[i][j].y, P[i][j].T_fd);
+			k = gridIndex(G, i, j);
+			x = gridX(G, i);
+			y = gridY(G, j);
+			fprintf(fres, "%+12.5le,%+12.5le,%+12.5le\n", x, y, G->res[k]);
+			fprintf(ffd, "%+12.5le,%+12.5le,%+12.5le\n", x, y, G->T_fd[k]);
 
 			// don't print analytical if there isn't a solution!
 			if (pSD->nCaseType != CASE_TYPE_TEST)
-				fprintf(fa, "%+12.5le,%+12.5le,%+12.5le\n", P[i][j].x, P[i][j].y, P[i][j].T_a);
+				fprintf(fa, "%+12.5le,%+12.5le,%+12.5le\n", x, y, G->T_a[k]);
 		}
 	}
 
@@ -1281,28 +7723,505 @@ void printSolution(PLATEPOINT** P, const SIMULATION_DATA* pSD)
 	fclose(fres);
 
 	// echo success to screen
-	if (pSD->nCaseType != CASE_TYPE_TEST) printf("Printed data to \"%s\"\n", strFileNameAnalytical);
-	printf("Printed data to \"%s\"\n", strFileNameFD);
-	printf("Printed data to \"%s\"\n", strFileNameResidual);
+	if (pSD->nCaseType != CASE_TYPE_TEST) reportf("Printed data to \"%s\"\n", strFileNameAnalytical);
+	reportf("Printed data to \"%s\"\n", strFileNameFD);
+	reportf("Printed data to \"%s\"\n", strFileNameResidual);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Writes "<case> Solution.hts": a RESULT_FILE_HEADER followed by the T_fd, T_a and res planes
+//               exactly as they sit in the grid (64-byte aligned rows of stride doubles), so the whole field
+//               goes out in one write and a reader can memory-map the planes at offset headerSize
+// ARGUMENTS:    G:  the plate grid
+//               SD: the simulation data for the case
+// RETURN VALUE: false if the file cannot be opened or written
+bool printBinarySolution(const PLATEGRID* G, const SIMULATION_DATA* pSD)
+{
+	RESULT_FILE_HEADER header;             // the header
+	FILE* fout = NULL;                     // the solution file
+	char strFileName[MAX_BUFF_SIZE];       // its name
+	size_t nValues = 3 * G->stride * G->J; // doubles in the three planes
+	errno_t err;                           // check fopen
+	bool bOk;                              // both writes completed
+
+	fillResultHeader(G, pSD, &header);
+	sprintf_s(strFileName, MAX_BUFF_SIZE, "%s Solution.hts", pSD->strCase);
+	err = fopen_s(&fout, strFileName, "wb");
+	if (err != 0 || fout == NULL)
+	{
+		reportf("Cannot open \"%s\" for writing. Skipping printout...\n", strFileName);
+		return false;
+	}
+	setvbuf(fout, NULL, _IONBF, 0); // two large writes, stdio buffering would only add a copy
+	// initialize lays T_fd, T_a and res out back to back, so the planes are one contiguous run
+	bOk = fwrite(&header, sizeof(header), 1, fout) == 1;
+	bOk = bOk && fwrite(G->T_fd, sizeof(double), nValues, fout) == nValues;
+	bOk = fclose(fout) == 0 && bOk;
+	if (!bOk)
+	{
+		reportf("Cannot write \"%s\"\n", strFileName);
+		return false;
+	}
+	reportf("Printed data to \"%s\"\n", strFileName);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Fills the header of "<case> Solution.hts" (frame files use it too, with their own magic)
+// ARGUMENTS:    G:      the plate grid
+//               pSD:    the simulation data for the case
+//               header: returns the header, zeroed first so the reserved bytes are written as zero
+// RETURN VALUE: none
+void fillResultHeader(const PLATEGRID* G, const SIMULATION_DATA* pSD, RESULT_FILE_HEADER* header)
+{
+	int n; // wall counter
+
+	memset(header, 0, sizeof(RESULT_FILE_HEADER));
+	memcpy(header->magic, RESULT_FILE_MAGIC, sizeof(header->magic));
+	header->version = RESULT_FILE_VERSION;
+	header->headerSize = (uint32_t)RESULT_HEADER_SIZE;
+	header->flags = pSD->nCaseType != CASE_TYPE_TEST ? RESULT_HAS_ANALYTICAL : 0;
+	header->nPlanes = 3;
+	header->I = G->I;
+	header->J = G->J;
+	header->stride = G->stride;
+	header->dx = G->dx;
+	header->dy = G->dy;
+	header->w = pSD->w;
+	header->h = pSD->h;
+	strcpy_s(header->strCase, MAX_CASE_NAME_SIZE, pSD->strCase);
+	for (n = 0; n < NUM_WALLS; n++)
+	{
+		header->bcType[n] = pSD->bc[n].nType;
+		header->bc[n][0] = pSD->bc[n].Ta;
+		header->bc[n][1] = pSD->bc[n].Tb;
+		header->bc[n][2] = pSD->bc[n].za;
+		header->bc[n][3] = pSD->bc[n].zb;
+		header->bc[n][4] = pSD->bc[n].ma;
+		header->bc[n][5] = pSD->bc[n].mb;
+		header->bc[n][6] = pSD->bc[n].k;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Starts the output thread.  Tasks are run strictly in the order they were submitted, so
+//               the blocks of one convergence file stay in order and every file is complete once
+//               FlushOutputWriter or FreeOutputWriter returns
+// ARGUMENTS:    none
+// RETURN VALUE: the writer, NULL if out of memory or threads (the callers then write synchronously)
+OUTPUT_WRITER* CreateOutputWriter()
+{
+	OUTPUT_WRITER* W = new (std::nothrow) OUTPUT_WRITER(); // zeroed, with constructed mutex and condition variables
+
+	if (W == NULL) return NULL;
+	try
+	{
+		W->thread = std::thread(outputWriterThread, W);
+	}
+	catch (const std::system_error&)
+	{
+		delete W;
+		return NULL;
+	}
+	return W;
 }
 
 //-----------------------------------------------------------------------------------------------------------
-// DESCRIPTION:  Frees the memory that was allocated to the dynamic arrays for the platepoint and SD struc 
-// ARGUMENTS:    P:  the 2D PLATEPOINT array
+// DESCRIPTION:  Writes everything still queued, then stops and joins the output thread and frees it
+// ARGUMENTS:    W: the writer, may be NULL
+// RETURN VALUE: none
+void FreeOutputWriter(OUTPUT_WRITER* W)
+{
+	if (W == NULL) return;
+	{
+		std::lock_guard<std::mutex> guard(W->lock);
+		W->bQuit = true;
+	}
+	W->wake.notify_one();
+	W->thread.join(); // the thread drains the queue before it honours bQuit
+	delete W;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Waits until every task submitted so far has been written
+// ARGUMENTS:    W: the writer, may be NULL
+// RETURN VALUE: none
+void FlushOutputWriter(OUTPUT_WRITER* W)
+{
+	if (W == NULL) return;
+	std::unique_lock<std::mutex> guard(W->lock);
+	W->idle.wait(guard, [W] { return W->head == NULL && !W->bBusy; });
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Queues a copy of a task for the output thread.  Without a writer, or without memory for the
+//               copy, the earlier tasks are flushed and the task runs on the calling thread instead, so the
+//               order of the output never changes
+// ARGUMENTS:    W:    the writer, may be NULL
+//               task: the task, whose records and grid now belong to the output
+// RETURN VALUE: none
+void SubmitOutputTask(OUTPUT_WRITER* W, const OUTPUT_TASK* task)
+{
+	OUTPUT_TASK* pTask = W != NULL ? (OUTPUT_TASK*)malloc(sizeof(OUTPUT_TASK)) : NULL;
+	OUTPUT_TASK local;  // synchronous copy
+
+	if (pTask == NULL)
+	{
+		FlushOutputWriter(W);
+		local = *task;
+		runOutputTask(&local);
+		return;
+	}
+	*pTask = *task;
+	pTask->next = NULL;
+	{
+		std::lock_guard<std::mutex> guard(W->lock);
+		if (W->tail != NULL) W->tail->next = pTask;
+		else W->head = pTask;
+		W->tail = pTask;
+	}
+	W->wake.notify_one();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Output thread main loop: takes the tasks from the head of the queue and runs them until
+//               asked to quit with an empty queue
+// ARGUMENTS:    W: the writer
+// RETURN VALUE: none
+void outputWriterThread(OUTPUT_WRITER* W)
+{
+	OUTPUT_TASK* pTask; // task taken from the queue
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(W->lock);
+			W->wake.wait(guard, [W] { return W->bQuit || W->head != NULL; });
+			if (W->head == NULL) return; // quit, and nothing left to write
+			pTask = W->head;
+			W->head = pTask->next;
+			if (W->head == NULL) W->tail = NULL;
+			W->bBusy = true;
+		}
+		runOutputTask(pTask);
+		free(pTask);
+		{
+			std::lock_guard<std::mutex> guard(W->lock);
+			W->bBusy = false;
+			if (W->head == NULL) W->idle.notify_all();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Does the work of one task: writes a block of convergence records (closing the file after
+//               the last one), or prints the solution files of a case and frees its grid
+// ARGUMENTS:    pTask: the task
+// RETURN VALUE: none
+void runOutputTask(OUTPUT_TASK* pTask)
+{
+	size_t n; // counter
+
+	if (pTask->nType == OUTPUT_TASK_CONVERGENCE)
+	{
+		for (n = 0; n < pTask->nRecords; n++)
+			fprintf(pTask->f, "%12.5le, %12.5le, %d, %10.4lf\n", pTask->records[n].rmax, pTask->records[n].RMS,
+				pTask->records[n].iter, pTask->records[n].seconds);
+		if (pTask->bClose) fclose(pTask->f);
+		free(pTask->records);
+	}
+	else if (pTask->nType == OUTPUT_TASK_SOLUTION)
+	{
+		// the solver stored its status before submitting, and nothing else writes it until the flush
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // output timer
+		std::string* pOuter = pCaseReport; // report of the thread's own case when the task runs synchronously
+		pCaseReport = pTask->pReport;
+		if (!printSolution(pTask->G, pTask->pSD) && *pTask->pStatus == HTS_OK) *pTask->pStatus = HTS_ERROR_FILE;
+		pCaseReport = pOuter;
+		if (pTask->pSeconds != NULL) *pTask->pSeconds = secondsSince(start);
+		if (pTask->pReport != NULL)
+		{
+			printCaseReport(pTask->pSD->strCase, pTask->pReport);
+			delete pTask->pReport;
+		}
+		FreeMemory(pTask->G, NULL);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Records the residuals of one iteration.  Records are collected in blocks of 
+//               CONVERGENCE_BLOCK and formatted and written by the output thread, so the solver loop only
+//               stores four numbers.  Without a writer (or a block) the line is written straight away
+// ARGUMENTS:    log:       the convergence log
+//               rmax, RMS: residuals after the iteration
+//               seconds:   wall time since the solve started (the last column of the file)
+//               iter:      iterations done
+// RETURN VALUE: none
+void logConvergence(CONVERGENCE_LOG* log, double rmax, double RMS, double seconds, int iter)
+{
+	OUTPUT_TASK task = {}; // a full block for the output thread
+
+	if (log->W != NULL && log->records == NULL)
+	{
+		log->records = (CONVERGENCE_RECORD*)malloc(CONVERGENCE_BLOCK * sizeof(CONVERGENCE_RECORD));
+		log->n = 0;
+		if (log->records == NULL) FlushOutputWriter(log->W); // earlier blocks go first
+	}
+	if (log->records == NULL)
+	{
+		fprintf(log->f, "%12.5le, %12.5le, %d, %10.4lf\n", rmax, RMS, iter, seconds);
+		return;
+	}
+	log->records[log->n].rmax = rmax;
+	log->records[log->n].RMS = RMS;
+	log->records[log->n].seconds = seconds;
+	log->records[log->n].iter = iter;
+	if (++log->n < CONVERGENCE_BLOCK) return;
+
+	task.nType = OUTPUT_TASK_CONVERGENCE;
+	task.f = log->f;
+	task.records = log->records;
+	task.nRecords = log->n;
+	SubmitOutputTask(log->W, &task);
+	log->records = NULL;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Ends a convergence log: the partial block and the fclose go to the output thread behind
+//               the earlier blocks (on an error exit too, so the file always holds every iteration done)
+// ARGUMENTS:    log: the convergence log
+// RETURN VALUE: none
+void closeConvergenceLog(CONVERGENCE_LOG* log)
+{
+	OUTPUT_TASK task = {}; // the last block and the close
+
+	task.nType = OUTPUT_TASK_CONVERGENCE;
+	task.f = log->f;
+	task.records = log->records;
+	task.nRecords = log->records != NULL ? log->n : 0;
+	task.bClose = true;
+	SubmitOutputTask(log->W, &task);
+	log->records = NULL;
+	log->f = NULL;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees the memory that was allocated to the dynamic arrays for the plate grid and SD struc 
+// ARGUMENTS:    G:  the plate grid
 //               SD: the simulation data for case B
-//                I: total nodes in the i direction
 // RETURN VALUE: none
-void FreeMemory(PLATEPOINT** P, SIMULATION_DATA* SD, size_t I)
+void FreeMemory(PLATEGRID* G, SIMULATION_DATA* SD)
 {
-	size_t i;
 	// Freeing SD Array
 	free(SD);
 
-	// Freeing Platepoint Array
-	for (i = 0; i < I; i++)
-		free(P[i]);
-	free(P);
+	// Freeing the grid planes and the grid descriptor
+	if (G != NULL) free(G->block);
+	free(G);
+}
+
+//------------------------- C INTERFACE (HeatTransferSim.h) -------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Creates a plate for the C interface.  Every wall starts as CONST 0 and the solver as plain
+//               Gauss-Seidel
+// ARGUMENTS:    w, h:    plate width and height
+//               dx, dy:  cell sizes
+//               ppPlate: returns the plate
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT (fewer than 3 nodes in x or y), HTS_ERROR_MEMORY
+int hts_create_plate(double w, double h, double dx, double dy, HTS_PLATE** ppPlate)
+{
+	HTS_PLATE* P; // the new plate
+
+	if (ppPlate == NULL) return HTS_ERROR_ARGUMENT;
+	*ppPlate = NULL;
+	if (!(w > 0.0 && h > 0.0 && dx > 0.0 && dy > 0.0) || w / dx > (double)INT_MAX || h / dy > (double)INT_MAX)
+		return HTS_ERROR_ARGUMENT;
+	P = (HTS_PLATE*)calloc(1, sizeof(HTS_PLATE));
+	if (P == NULL) return HTS_ERROR_MEMORY;
+	P->SD.w = w;
+	P->SD.h = h;
+	P->SD.dx = dx;
+	P->SD.dy = dy;
+	strcpy_s(P->SD.strCase, MAX_CASE_NAME_SIZE, "plate");
+	P->SD.iCoarser = -1; // a plate has no family
+	P->G = initialize(0, &P->SD, NULL);
+	if (P->G == NULL)
+	{
+		bool bTooSmall = P->SD.I < 3 || P->SD.J < 3; // no interior nodes
+		free(P);
+		return bTooSmall ? HTS_ERROR_ARGUMENT : HTS_ERROR_MEMORY;
+	}
+	*ppPlate = P;
+	return HTS_OK;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees a plate of the C interface
+// ARGUMENTS:    pPlate: the plate, may be NULL
+// RETURN VALUE: none
+void hts_free_plate(HTS_PLATE* pPlate)
+{
+	if (pPlate == NULL) return;
+	FreeMemory(pPlate->G, NULL);
+	free(pPlate);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Frees the factors of the process-wide factor cache (getFactorCache), so a host that is done
+//               with the library, or main before it returns, leaves nothing allocated.  A factor a running
+//               solve still holds is kept
+// ARGUMENTS:    none
+// RETURN VALUE: none
+void hts_release_caches(void)
+{
+	FACTOR_CACHE* C = getFactorCache(); // the in-memory cache
+	size_t n;                           // counter
+
+	std::lock_guard<std::mutex> guard(C->lock);
+	for (n = C->entries.size(); n-- > 0;)
+	{
+		if (C->entries[n].nUsers > 0) continue;
+		C->bytes -= factorBytes(C->entries[n].F->N, C->entries[n].F->b);
+		FreeFactor(C->entries[n].F);
+		C->entries.erase(C->entries.begin() + n);
+	}
+	if (C->entries.empty()) std::vector<FACTOR_CACHE_ENTRY>().swap(C->entries); // and the table itself
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Returns the number of nodes of a plate
+// ARGUMENTS:    pPlate: the plate
+//               pI, pJ: return the number of nodes in x and y
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT
+int hts_get_dimensions(const HTS_PLATE* pPlate, size_t* pI, size_t* pJ)
+{
+	if (pPlate == NULL || pI == NULL || pJ == NULL) return HTS_ERROR_ARGUMENT;
+	*pI = pPlate->G->I;
+	*pJ = pPlate->G->J;
+	return HTS_OK;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Sets the boundary condition of one wall.  It is written into the grid by the next solve
+// ARGUMENTS:    pPlate: the plate
+//               nWall:  HTS_WALL_TOP, HTS_WALL_BOTTOM, HTS_WALL_LEFT, HTS_WALL_RIGHT
+//               pBC:    the boundary condition (insulated is only supported on the right wall)
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT
+int hts_set_boundary(HTS_PLATE* pPlate, int nWall, const HTS_BOUNDARY* pBC)
+{
+	BOUNDARY_CONDITION_DATA* bc; // the wall's record
+
+	if (pPlate == NULL || pBC == NULL || nWall < 0 || nWall >= NUM_WALLS) return HTS_ERROR_ARGUMENT;
+	if (pBC->nType < BC_TYPE_CONST || pBC->nType > BC_TYPE_SINE) return HTS_ERROR_ARGUMENT;
+	if (pBC->nType == BC_TYPE_INSULATED && nWall != RIGHT) return HTS_ERROR_ARGUMENT;
+	bc = &pPlate->SD.bc[nWall];
+	bc->nType = pBC->nType;
+	bc->Ta = pBC->Ta;
+	bc->Tb = pBC->Tb;
+	bc->za = pBC->za;
+	bc->zb = pBC->zb;
+	bc->ma = pBC->ma;
+	bc->mb = pBC->mb;
+	bc->k = pBC->k;
+	return HTS_OK;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Applies one solver setting, e.g. ("SOLVER", "SOR") or ("THREADS", "4")
+// ARGUMENTS:    pPlate:   the plate
+//               strKey:   setting name
+//               strValue: setting value
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT, HTS_ERROR_SETTING
+int hts_set_solver_option(HTS_PLATE* pPlate, const char* strKey, const char* strValue)
+{
+	if (pPlate == NULL || strKey == NULL || strValue == NULL) return HTS_ERROR_ARGUMENT;
+	return setSolverOption(&pPlate->SD.solver, strKey, strValue) ? HTS_OK : HTS_ERROR_SETTING;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Writes the boundary conditions into the grid and solves the plate.  The interior starts
+//               from the previous solve, which speeds up sweeps over nearby boundary conditions.  With
+//               TRANSIENT set the plate is marched in time from there first (no frames are written); with
+//               END_TIME as well the field at that time is the result and the residuals are its steady ones
+// ARGUMENTS:    pPlate: the plate
+//               pStats: NULL, or returns the iterations and final residuals
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT, HTS_ERROR_NOT_CONVERGED, HTS_ERROR_MEMORY
+int hts_solve(HTS_PLATE* pPlate, HTS_SOLVE_STATS* pStats)
+{
+	SOLVE_INFO info = {}; // solver details and convergence
+	TRANSIENT_INFO tinfo = {}; // the time march, TRANSIENT only
+	int nStatus;          // HTS return code
+
+	if (pPlate == NULL) return HTS_ERROR_ARGUMENT;
+	try // nothing may unwind into a C caller
+	{
+		SetBoundaryConditions(pPlate->G, &pPlate->SD, 0);
+		nStatus = HTS_OK;
+		if (pPlate->SD.solver.nTransient != TRANSIENT_NONE) // no frame file: the library writes no files
+		{
+			nStatus = SolveTransient(pPlate->G, &pPlate->SD, NULL, &tinfo);
+			info.rmax = tinfo.rmax;
+			info.RMS = tinfo.RMS;
+		}
+		if (nStatus == HTS_OK && !tinfo.bEndTime) nStatus = SolvePlate(pPlate->G, &pPlate->SD, NULL, NULL, &info);
+	}
+	catch (...)
+	{
+		return HTS_ERROR_MEMORY;
+	}
+	if (pStats != NULL)
+	{
+		pStats->nIterations = info.iter;
+		pStats->rmax = info.rmax;
+		pStats->RMS = info.RMS;
+	}
+	return nStatus;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Copies a field of the plate into a caller buffer, row by row without the grid padding
+// ARGUMENTS:    pPlate:  the plate
+//               nField:  HTS_FIELD_TEMPERATURE or HTS_FIELD_RESIDUAL
+//               buffer:  receives node (i, j) at buffer[j * I + i]
+//               nBuffer: number of doubles the buffer holds
+// RETURN VALUE: HTS_OK, HTS_ERROR_ARGUMENT, HTS_ERROR_BUFFER_SIZE
+int hts_get_field(const HTS_PLATE* pPlate, int nField, double* buffer, size_t nBuffer)
+{
+	const PLATEGRID* G;  // the grid
+	const double* plane; // the field's plane
+	size_t j;            // row counter
+
+	if (pPlate == NULL || buffer == NULL) return HTS_ERROR_ARGUMENT;
+	G = pPlate->G;
+	if (nField == HTS_FIELD_TEMPERATURE) plane = G->T_fd;
+	else if (nField == HTS_FIELD_RESIDUAL) plane = G->res;
+	else return HTS_ERROR_ARGUMENT;
+	if (nBuffer < G->I * G->J) return HTS_ERROR_BUFFER_SIZE;
+	for (j = 0; j < G->J; j++) memcpy(buffer + j * G->I, plane + gridIndex(G, 0, j), G->I * sizeof(double));
+	return HTS_OK;
+}
 
+//-----------------------------------------------------------------------------------------------------------
+// DESCRIPTION:  Describes a return code of the C interface
+// ARGUMENTS:    nError: the return code
+// RETURN VALUE: a constant string
+const char* hts_error_string(int nError)
+{
+	switch (nError)
+	{
+	case HTS_OK: return "no error";
+	case HTS_ERROR_ARGUMENT: return "invalid argument";
+	case HTS_ERROR_MEMORY: return "out of memory";
+	case HTS_ERROR_NOT_CONVERGED: return "not converged";
+	case HTS_ERROR_BUFFER_SIZE: return "buffer too small";
+	case HTS_ERROR_SETTING: return "unknown solver setting";
+	case HTS_ERROR_FILE: return "file error";
+	case HTS_ERROR_INTERRUPTED: return "interrupted";
+	}
+	return "unknown error";
 }
 
 
@@ -1383,6 +8302,25 @@ int caseTypetoInt(char* string)
 	return BCTYPE;
 }
 
+//--------------------------------------------------------------------------------------------
+// DESCRIPTION:  Converts a solver name from the solver settings section into the SOLVER integers
+// ARGUMENTS:    char*: solver name
+// RETURN VALUE: int SOLVER, -1 if the name is not recognised
+int solverTypetoInt(const char* string)
+{
+	int SOLVER = -1;
+	if (strcmp(string, "GS") == 0) SOLVER = SOLVER_GS;
+	else if (strcmp(string, "SOR") == 0) SOLVER = SOLVER_SOR;
+	else if (strcmp(string, "MG") == 0) SOLVER = SOLVER_MG;
+	else if (strcmp(string, "PCG") == 0) SOLVER = SOLVER_PCG;
+	else if (strcmp(string, "DST") == 0) SOLVER = SOLVER_DST;
+	else if (strcmp(string, "CHOLESKY") == 0) SOLVER = SOLVER_CHOLESKY;
+	else if (strcmp(string, "LINE") == 0) SOLVER = SOLVER_LINE;
+	else if (strcmp(string, "ADI") == 0) SOLVER = SOLVER_ADI;
+
+	return SOLVER;
+}
+
 //-----------------------------------------------------------------------------------------------------------
 // DESCRIPTION:  This function flushes the input buffer to avoid scanf issues
 //               ***** CALL THIS FUNCTION AFTER EVERY CALL TO SCANF!!! *****
@@ -0,0 +1,96 @@
+/************************************************************************************************************
+Mech 7171 Engineering Programing, Fall 2021
+Capstone Project - 2D Conductive Heat Transfer on a Uniform Flat Plate
+
+Purpose: C interface to the plate solver in HeatTransferSim.cpp, for programs that embed it instead of
+		 running the interactive executable.  Build HeatTransferSim.cpp with HTS_LIBRARY defined to leave
+		 out main().  Nothing here reads simulations.in, writes files, prints or exits the process: every
+		 call reports through its return code and all data lives in the plate handle or caller buffers.
+		 Calls on different plates may run concurrently from any number of threads; calls on the same
+		 plate must not overlap.
+
+Author(s):     Muneer Almasyabi, Nathan Binner, Alex Sung
+Student ID(s): A01061394, A01159743, A01163512
+************************************************************************************************************/
+
+#ifndef HEAT_TRANSFER_SIM_H
+#define HEAT_TRANSFER_SIM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------- RETURN CODES --------------------------------------------------------------------------------------
+#define HTS_OK                   0   // success
+#define HTS_ERROR_ARGUMENT       1   // NULL handle, bad wall, bad boundary type or bad plate dimensions
+#define HTS_ERROR_MEMORY         2   // an allocation (or a helper thread) failed
+#define HTS_ERROR_NOT_CONVERGED  3   // MAX_ITER reached before the residual fell below 1e-8
+#define HTS_ERROR_BUFFER_SIZE    4   // caller buffer smaller than I * J
+#define HTS_ERROR_SETTING        5   // unknown solver setting or value
+#define HTS_ERROR_FILE           6   // a file could not be opened, read or written (executable only)
+#define HTS_ERROR_INTERRUPTED    7   // stopped by SIGINT/SIGTERM after saving a checkpoint (executable only)
+
+//------- WALLS, BOUNDARY TYPES AND FIELDS ------------------------------------------------------------------
+#define HTS_WALL_TOP     0
+#define HTS_WALL_BOTTOM  1
+#define HTS_WALL_LEFT    2
+#define HTS_WALL_RIGHT   3
+
+#define HTS_BC_CONST      0   // Ta on za..zb
+#define HTS_BC_COSINE     1   // Ta/2 (1 - cos(2 pi (z - za)/(zb - za))) on za..zb
+#define HTS_BC_INSULATED  2   // zero heat flux (right wall only)
+#define HTS_BC_POLY       3   // cubic from Ta to Tb with end slopes ma, mb on za..zb
+#define HTS_BC_SINE       4   // Ta sin(k pi (z - za)/(zb - za)) on za..zb
+
+#define HTS_FIELD_TEMPERATURE  0  // finite-difference temperature
+#define HTS_FIELD_RESIDUAL     1  // residual of the last solve
+
+typedef struct HTS_PLATE HTS_PLATE;  // opaque plate: grid, boundary conditions and solver settings
+
+typedef struct HTS_BOUNDARY  // boundary condition of one wall, same fields as a simulations.in line
+{
+	int    nType;     // HTS_BC_CONST, HTS_BC_COSINE, HTS_BC_INSULATED, HTS_BC_POLY, HTS_BC_SINE
+	double Ta, Tb;    // if only one then Ta is used
+	double za, zb;    // range along the wall (z is x on TOP/BOTTOM, y on LEFT/RIGHT)
+	double ma, mb;    // HTS_BC_POLY only
+	double k;         // HTS_BC_SINE only
+}
+HTS_BOUNDARY;
+
+typedef struct HTS_SOLVE_STATS  // convergence of one solve
+{
+	int    nIterations;  // sweeps (or V-cycles, or CG steps) done
+	double rmax;         // largest residual at the end
+	double RMS;          // RMS residual at the end
+}
+HTS_SOLVE_STATS;
+
+//------- FUNCTIONS -----------------------------------------------------------------------------------------
+// creates a w x h plate with dx x dy cells, every wall CONST 0, Gauss-Seidel solver
+int hts_create_plate(double w, double h, double dx, double dy, HTS_PLATE** ppPlate);
+// frees a plate (NULL is ignored)
+void hts_free_plate(HTS_PLATE* pPlate);
+// frees the Cholesky factors SOLVER CHOLESKY keeps in memory for all plates; call when no solve is running,
+// e.g. after the last hts_free_plate (later solves simply factor again)
+void hts_release_caches(void);
+// number of nodes in x and y
+int hts_get_dimensions(const HTS_PLATE* pPlate, size_t* pI, size_t* pJ);
+// sets the boundary condition of one wall, applied at the next solve
+int hts_set_boundary(HTS_PLATE* pPlate, int nWall, const HTS_BOUNDARY* pBC);
+// applies one "KEY value" solver setting, same keys as the Solver Settings section of simulations.in;
+// TRANSPORT SHM starts worker processes of the program, so a library returns HTS_ERROR_SETTING for it
+int hts_set_solver_option(HTS_PLATE* pPlate, const char* strKey, const char* strValue);
+// solves the plate, starting from the previous solution (zero before the first solve); pStats may be NULL
+int hts_solve(HTS_PLATE* pPlate, HTS_SOLVE_STATS* pStats);
+// copies a field into buffer[j * I + i], which must hold at least I * J doubles
+int hts_get_field(const HTS_PLATE* pPlate, int nField, double* buffer, size_t nBuffer);
+// short description of a return code
+const char* hts_error_string(int nError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HEAT_TRANSFER_SIM_H
@@ -6,11 +6,15 @@ for i = length(Files):-1:1 % go through all files
         Files(i) = []; %remove line from matrix
     end
 end
+BinFiles = dir('*-* Solution.hts'); % binary solution files, memory-mapped by readSolution
 clc; % clear command window
 disp('Detected Files: ');
 for i = 1:length(Files) %print out remaining files 
     disp([ '   ' num2str(i) ': ' Files(i).name]);
 end
+for i = 1:length(BinFiles) %print out the binary files 
+    disp([ '   ' num2str(length(Files) + i) ': ' BinFiles(i).name]);
+end
 
 %%
 
@@ -26,7 +30,29 @@ for i = 1:length(Files)
     nR   = length(yvec); % Sets the grid size in Y
     nC   = length(xvec); % sets the grid size in X
     tgrd = reshape(Temp,[nR nC]); % Reshapes vector to size [nR nC]
-    
+
+    % pulls apart the file dir/name and stores name to fname
+    [~,fname,~] = fileparts(Files(i).name); 
+    plotField(xvec, yvec, tgrd, fname);
+end
+
+for i = 1:length(BinFiles)
+    if exist(strrep(BinFiles(i).name, 'Solution.hts', 'Finite Difference.dat'), 'file')
+        continue; % OUTPUT BOTH: already plotted from the .dat files
+    end
+    S = readSolution(BinFiles(i).name); % no parsing, the planes are mapped straight from the file
+    disp(BinFiles(i).name);
+    % same names as the .dat plots so the pictures line up
+    if S.hasAnalytical
+        plotField(S.x, S.y, S.T_a, [S.name ' Analytical']);
+    end
+    plotField(S.x, S.y, S.T_fd, [S.name ' Finite Difference']);
+    plotField(S.x, S.y, S.res, [S.name ' Residual']);
+end
+end
+
+function plotField(xvec, yvec, tgrd, fname)
+% Plots one field as a contour map and saves it to fname.png
     xMin = min(xvec);
     xMax = max(xvec);
     yMin = min(yvec);
@@ -44,7 +70,7 @@ for i = 1:length(Files)
     box on; %removes the top and right border lines
     axis xy image; %keeps the aspect ratio to 1:1
     axis([xMin xMax yMin yMax]);
-    title(strrep(Files(i).name,'.dat','')); % adds Title
+    title(fname); % adds Title
     xlabel(' x','FontSize',14); %adds x-axis label
     ylabel('y','FontSize',14); %adds y-axis label
     colormap('jet'); %sets color style 
@@ -64,9 +90,6 @@ for i = 1:length(Files)
     %set(gcf,'PaperPositionMode','manual');   
    % set(gcf,'PaperPosition',[0 0 width height]);
 
-    % pulls apart the file dir/name and stores name to fname
-    [~,fname,~] = fileparts(Files(i).name); 
     % adds _Results.png to the end of the file name and saves it
     saveas(gcf,[ fname '.png']);    
 end
-end
\ No newline at end of file
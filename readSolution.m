@@ -0,0 +1,40 @@
+function S = readSolution(fileName)
+% Memory-maps a binary "<case> Solution.hts" file written by HeatTransferSim
+% S.name, S.x, S.y             case name and node positions
+% S.dx, S.dy, S.w, S.h         cell sizes and plate size
+% S.bcType, S.bc               boundary condition type and Ta,Tb,za,zb,ma,mb,k of TOP, BOTTOM, LEFT, RIGHT
+% S.hasAnalytical              true if S.T_a holds an analytical solution
+% S.T_fd, S.T_a, S.res         [J x I] fields, ready for imagesc(S.x, S.y, ...)
+fid = fopen(fileName, 'r', 'ieee-le'); % header is read directly, it is only 512 bytes
+if fid < 0
+    error('Cannot open %s', fileName);
+end
+magic   = fread(fid, [1 8], '*char');
+version = fread(fid, 1, 'uint32');
+if ~strcmp(magic, 'HTSPLATE') || version ~= 1
+    fclose(fid);
+    error('%s is not a version 1 solution file', fileName);
+end
+headerSize = fread(fid, 1, 'uint32'); % byte offset of the first plane
+flags      = fread(fid, 1, 'uint32');
+nPlanes    = fread(fid, 1, 'uint32');
+dims       = fread(fid, 3, 'uint64'); % I, J, stride
+geom       = fread(fid, 4, 'double'); % dx, dy, w, h
+name       = fread(fid, [1 40], '*char');
+S.bcType   = fread(fid, [1 4], 'int32');
+S.bc       = fread(fid, [7 4], 'double')';
+fclose(fid);
+
+I = dims(1); J = dims(2); stride = dims(3);
+S.name = deblank(strtok(name, char(0)));
+S.dx = geom(1); S.dy = geom(2); S.w = geom(3); S.h = geom(4);
+S.x = (0:I-1) * S.dx;
+S.y = (0:J-1) * S.dy;
+S.hasAnalytical = bitand(flags, 1) ~= 0;
+
+% the planes are stored row by row (x fastest) with each row padded to stride doubles
+m = memmapfile(fileName, 'Offset', headerSize, 'Format', {'double', [stride J nPlanes], 'planes'}, 'Repeat', 1);
+S.T_fd = m.Data.planes(1:I, :, 1)'; % transpose to [J x I], rows are y like the .dat plots
+S.T_a  = m.Data.planes(1:I, :, 2)';
+S.res  = m.Data.planes(1:I, :, 3)';
+end
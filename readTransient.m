@@ -0,0 +1,47 @@
+function S = readTransient(fileName)
+% Memory-maps a binary "<case> Transient.hts" frame file written by HeatTransferSim (TRANSIENT, FRAME_TIME)
+% S.name, S.x, S.y             case name and node positions
+% S.dx, S.dy, S.w, S.h         cell sizes and plate size
+% S.bcType, S.bc               boundary condition type and Ta,Tb,za,zb,ma,mb,k of TOP, BOTTOM, LEFT, RIGHT
+% S.t, S.dt, S.step            time of every frame, the step that reached it and the steps taken
+% S.rmax, S.RMS                steady-state residual of every frame
+% S.T                          [J x I x nFrames] temperatures, S.T(:,:,k) is ready for imagesc(S.x, S.y, ...)
+fid = fopen(fileName, 'r', 'ieee-le'); % header is read directly, it is only 512 bytes
+if fid < 0
+    error('Cannot open %s', fileName);
+end
+magic   = fread(fid, [1 8], '*char');
+version = fread(fid, 1, 'uint32');
+if ~strcmp(magic, 'HTSFRAME') || version ~= 1
+    fclose(fid);
+    error('%s is not a version 1 frame file', fileName);
+end
+headerSize = fread(fid, 1, 'uint32'); % byte offset of the first frame
+fread(fid, 2, 'uint32');              % flags, planes per frame
+dims       = fread(fid, 3, 'uint64'); % I, J, stride
+geom       = fread(fid, 4, 'double'); % dx, dy, w, h
+name       = fread(fid, [1 40], '*char');
+S.bcType   = fread(fid, [1 4], 'int32');
+S.bc       = fread(fid, [7 4], 'double')';
+fseek(fid, 0, 'eof');
+fileSize = ftell(fid);
+fclose(fid);
+
+I = dims(1); J = dims(2); stride = dims(3);
+S.name = deblank(strtok(name, char(0)));
+S.dx = geom(1); S.dy = geom(2); S.w = geom(3); S.h = geom(4);
+S.x = (0:I-1) * S.dx;
+S.y = (0:J-1) * S.dy;
+
+% every frame is one row of stride doubles (t, dt, step, rmax, RMS) and then the T plane; frames are appended
+% while the march runs, so a partly written last frame is left out
+nFrames = floor((fileSize - headerSize) / (8 * stride * (J + 1)));
+m = memmapfile(fileName, 'Offset', headerSize, 'Format', {'double', [stride J+1], 'frame'}, 'Repeat', nFrames);
+S.t = zeros(1, nFrames); S.dt = S.t; S.step = S.t; S.rmax = S.t; S.RMS = S.t;
+S.T = zeros(J, I, nFrames);
+for k = 1:nFrames
+    f = m.Data(k).frame;
+    S.t(k) = f(1, 1); S.dt(k) = f(2, 1); S.step(k) = f(3, 1); S.rmax(k) = f(4, 1); S.RMS(k) = f(5, 1);
+    S.T(:, :, k) = f(1:I, 2:J+1)'; % transpose to [J x I], rows are y like the .dat plots
+end
+end